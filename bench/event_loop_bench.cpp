@@ -0,0 +1,224 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+// Compares the epoll and io_uring event loop backends: requests per second and the system calls made by the client.
+// Usage: cnet-bench-event-loop [requests] [connections] [body size]
+//
+// A keep-alive server answering every request with a fixed body is forked first, so neither side shares a process
+// with the other. Each backend then runs the requests twice in a forked client, once untimed under ptrace to count
+// its system calls, and once alone for the requests per second.
+//
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ptrace.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "async_http_client.h"
+#include "uri.h"
+
+using namespace cnet;
+
+static void serve_connection(const int fd, const std::string &response)
+{
+    std::string request;
+    char buffer[4096];
+    while (true)
+    {
+        const ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) break;
+        request.append(buffer, received);
+        // answer every complete request head, several may arrive at once
+        for (size_t end; (end = request.find("\r\n\r\n")) != std::string::npos;)
+        {
+            request.erase(0, end + 4);
+            if (::send(fd, response.data(), response.size(), MSG_NOSIGNAL) < 0) break;
+        }
+    }
+    ::close(fd);
+}
+
+static int start_server(const size_t body_size, pid_t &server)
+{
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    constexpr int enable = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listener, 1024) < 0)
+    {
+        perror("listen");
+        exit(1);
+    }
+    socklen_t length = sizeof(address);
+    getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length);
+
+    server = fork();
+    if (server == 0)
+    {
+        const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body_size) + "\r\n\r\n" + std::string(body_size, 'x');
+        while (true)
+        {
+            const int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) continue;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            std::thread(serve_connection, fd, response).detach();
+        }
+    }
+    ::close(listener);
+    return ntohs(address.sin_port);
+}
+
+static void run_client(const loop_backend backend, const int port, const size_t requests, const size_t connections, const bool report)
+{
+    event_loop loop(backend);
+    async_http_client_options options;
+    options.max_connections_per_host = connections;
+    options.max_idle_per_host = connections;
+    async_http_client client(loop, options);
+
+    uri url("http://127.0.0.1/bench");
+    url.set_port(port);
+    size_t failed = 0;
+    // keep a fixed number of requests outstanding, each completion starts the next one
+    size_t started = 0;
+    std::function<void()> next;
+    const response_handler handler = [&](http_message &, const std::exception_ptr &error)
+    {
+        if (error != nullptr) failed++;
+        if (started < requests) next();
+    };
+    next = [&]
+    {
+        started++;
+        client.make_request(http_message(url), handler);
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < connections && i < requests; i++)
+    {
+        next();
+    }
+    loop.run();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (report)
+    {
+        printf("  %-10s %8.0f req/s  %6.2fs  failed %zu\n", backend == loop_backend::io_uring ? "io_uring" : "epoll", static_cast<double>(requests) / seconds, seconds, failed);
+        fflush(stdout);
+    }
+}
+
+static const char *syscall_name(const unsigned long long number)
+{
+    switch (number)
+    {
+        case SYS_read: return "read";
+        case SYS_write: return "write";
+        case SYS_close: return "close";
+        case SYS_socket: return "socket";
+        case SYS_connect: return "connect";
+        case SYS_sendto: return "sendto";
+        case SYS_recvfrom: return "recvfrom";
+        case SYS_setsockopt: return "setsockopt";
+        case SYS_getsockopt: return "getsockopt";
+        case SYS_epoll_wait: return "epoll_wait";
+        case SYS_epoll_ctl: return "epoll_ctl";
+        case SYS_io_uring_enter: return "io_uring_enter";
+        case SYS_poll: return "poll";
+        case SYS_futex: return "futex";
+        default: return nullptr;
+    }
+}
+
+static void count_syscalls(const loop_backend backend, const int port, const size_t requests, const size_t connections)
+{
+    const pid_t child = fork();
+    if (child == 0)
+    {
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        raise(SIGSTOP);
+        run_client(backend, port, requests, connections, false);
+        _exit(0);
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    ptrace(PTRACE_SETOPTIONS, child, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+    std::map<unsigned long long, unsigned long long> counts;
+    unsigned long long total = 0;
+    int signal = 0;
+    while (true)
+    {
+        ptrace(PTRACE_SYSCALL, child, nullptr, signal);
+        if (waitpid(child, &status, 0) < 0 || WIFEXITED(status) || WIFSIGNALED(status)) break;
+        signal = 0;
+        if (!WIFSTOPPED(status)) continue;
+        if (WSTOPSIG(status) != (SIGTRAP | 0x80))
+        {
+            signal = WSTOPSIG(status);
+            continue;
+        }
+        __ptrace_syscall_info info{};
+        if (ptrace(PTRACE_GET_SYSCALL_INFO, child, sizeof(info), &info) > 0 && info.op == PTRACE_SYSCALL_INFO_ENTRY)
+        {
+            counts[info.entry.nr]++;
+            total++;
+        }
+    }
+
+    printf("  %-10s %8llu syscalls  %6.2f per request:", backend == loop_backend::io_uring ? "io_uring" : "epoll", total, static_cast<double>(total) / static_cast<double>(requests));
+    for (const auto &[number, count]: counts)
+    {
+        if (count * 100 < total) continue;
+        const char *name = syscall_name(number);
+        if (name != nullptr) printf(" %s=%llu", name, count);
+        else printf(" #%llu=%llu", number, count);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(const int argc, char **argv)
+{
+    const size_t requests = argc > 1 ? std::stoul(argv[1]) : 20000;
+    const size_t connections = argc > 2 ? std::stoul(argv[2]) : 64;
+    const size_t body_size = argc > 3 ? std::stoul(argv[3]) : 1024;
+
+    {
+        event_loop probe(loop_backend::io_uring);
+        if (probe.get_backend() != loop_backend::io_uring) printf("io_uring is unavailable, both runs use epoll\n");
+    }
+
+    pid_t server = 0;
+    const int port = start_server(body_size, server);
+    printf("%zu requests over %zu connections, %zu byte bodies\n", requests, connections, body_size);
+    for (const loop_backend backend: {loop_backend::epoll, loop_backend::io_uring})
+    {
+        count_syscalls(backend, port, requests, connections);
+        const pid_t child = fork();
+        if (child == 0)
+        {
+            run_client(backend, port, requests, connections, true);
+            _exit(0);
+        }
+        waitpid(child, nullptr, 0);
+    }
+
+    kill(server, SIGKILL);
+    waitpid(server, nullptr, 0);
+    return 0;
+}
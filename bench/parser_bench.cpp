@@ -0,0 +1,94 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+// Measures how fast http_response_parser takes apart header-heavy responses with each byte scanning kernel.
+// Usage: cnet-bench-parser [responses] [headers] [read size]
+//
+// Every response has the given number of header fields, with values as long as those a proxy tier adds, and a
+// chunked body of small chunks. The responses are fed to the parser in pieces of the read size, like a socket would
+// hand them over, and the parser is reused between them.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "byte_scan.h"
+#include "http_message.h"
+#include "http_response_parser.h"
+
+using namespace cnet;
+
+static std::string make_response(const size_t headers)
+{
+    std::string response = "HTTP/1.1 200 OK\r\n";
+    response += "Content-Type: application/json; charset=utf-8\r\n";
+    response += "Transfer-Encoding: chunked\r\n";
+    for (size_t i = 0; i < headers; i++)
+    {
+        switch (i % 4)
+        {
+            case 0:
+                response += "X-Upstream-Trace-" + std::to_string(i) + ": 00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01\r\n";
+                break;
+            case 1:
+                response += "Set-Cookie: session_" + std::to_string(i) + "=eyJhbGciOiJIUzI1NiJ9.eyJzdWIiOiIxMjM0NTY3ODkwIn0; Path=/; HttpOnly; Secure; SameSite=Lax\r\n";
+                break;
+            case 2:
+                response += "Via: 1.1 edge-" + std::to_string(i) + ".proxy.example.net (cache/4.2), 1.1 shield-02.proxy.example.net (cache/4.2)\r\n";
+                break;
+            default:
+                response += "X-Cache-Status-" + std::to_string(i) + ": HIT from edge, MISS from shield, age=1732, ttl=3600\r\n";
+        }
+    }
+    response += "\r\n";
+    const std::string chunk = R"({"id": 1234567, "name": "configuration"})";
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", chunk.size());
+    for (int i = 0; i < 16; i++)
+    {
+        response += size + chunk + "\r\n";
+    }
+    response += "0\r\n\r\n";
+    return response;
+}
+
+int main(const int argc, char **argv)
+{
+    const size_t responses = argc > 1 ? std::stoul(argv[1]) : 200000;
+    const size_t headers = argc > 2 ? std::stoul(argv[2]) : 60;
+    const size_t read_size = argc > 3 ? std::stoul(argv[3]) : 4096;
+    const std::string response = make_response(headers);
+    printf("%zu responses of %zu bytes, %zu header fields, read %zu bytes at a time\n", responses, response.size(), headers + 2, read_size);
+
+    constexpr scan_kernel kernels[] = {scan_kernel::scalar, scan_kernel::sse42, scan_kernel::avx2};
+    constexpr const char *names[] = {"scalar", "sse4.2", "avx2"};
+    for (const scan_kernel wanted: kernels)
+    {
+        if (set_scan_kernel(wanted) != wanted)
+        {
+            printf("  %-7s unsupported\n", names[static_cast<int>(wanted)]);
+            continue;
+        }
+        http_response_parser parser;
+        http_message message;
+        // the checksum keeps the results from being optimized away
+        size_t checksum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < responses; i++)
+        {
+            parser.reset();
+            for (size_t offset = 0; offset < response.size(); offset += read_size)
+            {
+                parser.feed(std::string_view(response).substr(offset, read_size));
+                for (std::string_view chunk; parser.next_body(chunk);) checksum += chunk.size();
+            }
+            parser.copy_headers(message);
+            checksum += message.headers.size();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("  %-7s %9.0f responses/s %8.1f MB/s | checksum %zu\n", names[static_cast<int>(wanted)], static_cast<double>(responses) / seconds,
+               static_cast<double>(responses * response.size()) / seconds / 1e6, checksum);
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+// Measures how fast cnet::uri parses: URLs and megabytes per second over a corpus, and the same for a copy of each
+// URL alone, the floor of the owned buffer the parser moves the URL into.
+// Usage: cnet-bench-uri [urls] [corpus file]
+//
+// Without a corpus file the URLs are generated with a fixed seed, a mix of short links, long paths, IPv6 literals,
+// userinfo, percent-encoding and query strings with repeated keys. A corpus file has one URL per line.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "uri.h"
+
+using namespace cnet;
+
+static std::vector<std::string> generate(const size_t count)
+{
+    static const char *schemes[] = {"http", "https", "HTTPS", "ftp"};
+    static const char *hosts[] = {"example.com", "www.example.org", "cdn-04.static.example.net", "localhost", "[::1]", "[2001:db8::8a2e:370:7334]", "192.168.0.10", "API.Example.COM"};
+    static const char *segments[] = {"api", "v2", "users", "12345", "images", "thumbnail.png", "search", "a%20b", "index.html", "2026", "10", "report-final_v3.pdf"};
+    static const char *keys[] = {"q", "page", "sort", "id", "utm_source", "filter", "lang"};
+    static const char *values[] = {"1", "asc", "uri+parser", "en-US", "%E2%9C%93", "", "newsletter", "created_at:desc"};
+
+    std::mt19937 random(2026);
+    const auto pick = [&random](const auto &list) { return list[random() % (sizeof(list) / sizeof(list[0]))]; };
+    std::vector<std::string> urls;
+    urls.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string url = pick(schemes);
+        url += "://";
+        if (random() % 16 == 0) url += "user:secret@";
+        url += pick(hosts);
+        if (random() % 4 == 0) url += ":" + std::to_string(1024 + random() % 60000);
+        for (unsigned int depth = random() % 7; depth > 0; depth--)
+        {
+            url += '/';
+            url += pick(segments);
+        }
+        if (const unsigned int parameters = random() % 6; parameters > 0)
+        {
+            url += '?';
+            for (unsigned int p = 0; p < parameters; p++)
+            {
+                if (p > 0) url += '&';
+                url += pick(keys);
+                url += '=';
+                url += pick(values);
+            }
+        }
+        if (random() % 8 == 0) url += "#section-2";
+        urls.push_back(std::move(url));
+    }
+    return urls;
+}
+
+int main(const int argc, char **argv)
+{
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::vector<std::string> urls;
+    if (argc > 2)
+    {
+        std::ifstream file(argv[2]);
+        for (std::string line; std::getline(file, line) && urls.size() < count;)
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) urls.push_back(std::move(line));
+        }
+    } else urls = generate(count);
+
+    size_t bytes = 0;
+    for (const std::string &url: urls) bytes += url.size();
+    printf("%zu urls, %.1f bytes on average\n", urls.size(), static_cast<double>(bytes) / static_cast<double>(urls.size()));
+
+    // the checksum keeps the results from being optimized away
+    for (int run = 0; run < 3; run++)
+    {
+        size_t checksum = 0, invalid = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string &url: urls)
+        {
+            const std::string copy = url;
+            checksum += copy.size();
+        }
+        const double copy_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (const std::string &url: urls)
+        {
+            if (uri parsed; uri::try_create(url, parsed)) checksum += parsed.get_host().size() + parsed.get_path().size() + parsed.get_port() + parsed.get_parameters().size();
+            else invalid++;
+        }
+        const double parse_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        printf("  parse %10.0f urls/s %8.1f MB/s %6.1f ns/url | copy %10.0f urls/s | invalid %zu checksum %zu\n", static_cast<double>(urls.size()) / parse_seconds,
+               static_cast<double>(bytes) / parse_seconds / 1e6, parse_seconds * 1e9 / static_cast<double>(urls.size()), static_cast<double>(urls.size()) / copy_seconds, invalid, checksum);
+    }
+    return 0;
+}
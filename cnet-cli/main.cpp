@@ -4,7 +4,14 @@
 
 
 #include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
 
+#include "batch_downloader.h"
+#include "downloader.h"
 #include "http_client.h"
 #include "ANSIConsoleColors/ANSIConsoleColors.h"
 #include "cclip/cclip.hpp"
@@ -24,6 +31,7 @@ int main(const int argc, char *argv[])
     options_manager.add_option("v", "verbose", "Enables verbose output", false, false);
     options_manager.add_option("m", "method", "Sets the method of the request, (GET, POST, HEAD, etc)", false, true);
     options_manager.add_option("b", "body", "Sets the body of the request", false, true);
+    options_manager.add_option("uf", "upload-file", "Sends a file as the body of the request, PUT unless a method is set", false, true);
     options_manager.add_option("hd", "header", R"(Sets the header of the request in a json format. Ex {Accept: "application/json", Content-Type: "application/json"})", false, true);
     options_manager.add_option("a", "preallocate", "Preallocates the file size before downloading", false, false);
     options_manager.add_option("r", "retry", "Sets the number of times to retry the download", false, true);
@@ -33,6 +41,7 @@ int main(const int argc, char *argv[])
     options_manager.add_option("t", "timeout", "Sets the timeout of the request", false, true);
     options_manager.add_option("p", "parts", "Sets the number of parts to download the file in, this can increase the speed of the download", false, true);
     options_manager.add_option("f", "force", "Forces the download to start even if the file already exists", false, false);
+    options_manager.add_option("h2", "http2", "Offers HTTP/2 to https servers for requests that aren't downloads", false, false);
 
     options_manager.parse(argc, argv);
 
@@ -63,14 +72,33 @@ int main(const int argc, char *argv[])
     const char *method = options_manager.is_present("m") ? options_manager.get_option("m")->argument : nullptr;
     const char *body = options_manager.is_present("b") ? options_manager.get_option("b")->argument : nullptr;
     const char *header = options_manager.is_present("hd") ? options_manager.get_option("hd")->argument : nullptr;
+    const char *output = options_manager.is_present("o") ? options_manager.get_option("o")->argument : nullptr;
+    const char *upload = options_manager.is_present("uf") ? options_manager.get_option("uf")->argument : nullptr;
+
+    cnet::download_options download_options;
+    try
+    {
+        if (options_manager.is_present("p")) download_options.parts = std::stoul(options_manager.get_option("p")->argument);
+        if (options_manager.is_present("mt")) download_options.max_threads = std::stoul(options_manager.get_option("mt")->argument);
+        if (options_manager.is_present("r")) download_options.retries = std::stoul(options_manager.get_option("r")->argument);
+        if (options_manager.is_present("t")) download_options.client.timeout = std::stoul(options_manager.get_option("t")->argument);
+    } catch (std::exception &)
+    {
+        fprintf(stderr, "%sThe parts, max-threads, retry and timeout options must be numbers.%s\n", ConsoleColors::GetColorCode(ColorCodes::Red).c_str(), ConsoleColors::GetColorCode(ColorCodes::Default).c_str());
+        return 1;
+    }
+    download_options.preallocate = options_manager.is_present("a");
+    download_options.in_memory = options_manager.is_present("im");
+    download_options.resume = options_manager.is_present("c");
+    download_options.client.http2 = options_manager.is_present("h2");
     if (options_manager.is_present("u"))
     {
         if (options_manager.is_present("i"))
         {
             fprintf(stderr, "%s-i and -u cannot be used together, the input file will be ignored.%s\n", ConsoleColors::GetColorCode(ColorCodes::Red).c_str(), ConsoleColors::GetColorCode(ColorCodes::Default).c_str());
         }
-        cnet::http_client client;
         cnet::http_message message(options_manager.get_option("u")->argument);
+        if (upload != nullptr) message.method = cnet::http_method::PUT;
         if (method != nullptr)
         {
             try
@@ -82,7 +110,105 @@ int main(const int argc, char *argv[])
                 return 1;
             }
         }
-        client.make_request(message);
+        if (output != nullptr)
+        {
+            try
+            {
+                cnet::downloader downloader(download_options);
+                const cnet::download_result result = downloader.download(message, output);
+                if (!options_manager.is_present("s"))
+                {
+                    printf("%sDownloaded%s %llu bytes to %s in %.2fs (%u ranges, %u splits", ConsoleColors::GetColorCode(ColorCodes::Green).c_str(), ConsoleColors::GetColorCode(ColorCodes::Default).c_str(), result.size, output, result.seconds, result.ranges, result.splits);
+                    if (result.resumed > 0) printf(", %llu bytes resumed", result.resumed);
+                    printf(")\n");
+                }
+            } catch (std::runtime_error &e)
+            {
+                fprintf(stderr, "%s%s%s\n", ConsoleColors::GetColorCode(ColorCodes::Red).c_str(), e.what(), ConsoleColors::GetColorCode(ColorCodes::Default).c_str());
+                return 1;
+            }
+            return 0;
+        }
+        cnet::http_client client(download_options.client);
+        if (upload != nullptr)
+        {
+            try
+            {
+                const cnet::file_body file(upload);
+                client.upload(message, file);
+            } catch (std::runtime_error &e)
+            {
+                fprintf(stderr, "%s%s%s\n", ConsoleColors::GetColorCode(ColorCodes::Red).c_str(), e.what(), ConsoleColors::GetColorCode(ColorCodes::Default).c_str());
+                return 1;
+            }
+        } else client.make_request(message);
         printf(message.body.c_str());
+    } else if (options_manager.is_present("i"))
+    {
+        const char *input = options_manager.get_option("i")->argument;
+        std::ifstream file(input);
+        if (!file.is_open())
+        {
+            fprintf(stderr, "%sFailed to open %s%s\n", ConsoleColors::GetColorCode(ColorCodes::Red).c_str(), input, ConsoleColors::GetColorCode(ColorCodes::Default).c_str());
+            return 1;
+        }
+
+        // one url per line, blank lines and lines starting with # are skipped
+        std::vector<cnet::batch_request> requests;
+        std::set<std::string> names;
+        for (std::string line; std::getline(file, line);)
+        {
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#') continue;
+            try
+            {
+                cnet::http_message message(line);
+                if (method != nullptr) message.method = cnet::strto_http_method(method);
+                std::string path;
+                if (output != nullptr)
+                {
+                    // the files are named after the last segment of their path, prefixed with their position, or a later
+                    // number, while that name is taken
+                    std::string name(message.url.get_path());
+                    name = name.substr(name.find_last_of('/') + 1);
+                    if (name.empty()) name = "index.html";
+                    std::string candidate = name;
+                    for (size_t prefix = requests.size(); !names.insert(candidate).second; prefix++) candidate = std::to_string(prefix) + "-" + name;
+                    path = (std::filesystem::path(output) / candidate).string();
+                }
+                requests.push_back({std::move(message), std::move(path)});
+            } catch (std::exception &e)
+            {
+                fprintf(stderr, "%sSkipping %s: %s%s\n", ConsoleColors::GetColorCode(ColorCodes::Red).c_str(), line.c_str(), e.what(), ConsoleColors::GetColorCode(ColorCodes::Default).c_str());
+            }
+        }
+        if (output != nullptr) std::filesystem::create_directories(output);
+
+        cnet::batch_options batch_options;
+        batch_options.max_threads = download_options.max_threads;
+        batch_options.client = download_options.client;
+        cnet::batch_downloader batch(batch_options);
+        const cnet::batch_result result = batch.run(requests);
+
+        if (!options_manager.is_present("s"))
+        {
+            for (const cnet::batch_entry &entry: result.entries)
+            {
+                if (!entry.is_sucess())
+                {
+                    fprintf(stderr, "%sFailed%s %s: %s\n", ConsoleColors::GetColorCode(ColorCodes::Red).c_str(), ConsoleColors::GetColorCode(ColorCodes::Default).c_str(), entry.url.c_str(),
+                            entry.error.empty() ? ("status " + std::to_string(entry.status_code)).c_str() : entry.error.c_str());
+                } else if (options_manager.is_present("v"))
+                {
+                    printf("%d %llu bytes %.1fms %s\n", entry.status_code, entry.size, entry.seconds * 1000, entry.url.c_str());
+                }
+            }
+            const double seconds = result.seconds > 0 ? result.seconds : 1;
+            printf("%sFetched%s %zu urls (%zu failed), %llu bytes in %.2fs, %.1f requests/s, %.2f MB/s\n", ConsoleColors::GetColorCode(ColorCodes::Green).c_str(), ConsoleColors::GetColorCode(ColorCodes::Default).c_str(),
+                   result.entries.size(), result.failed, result.bytes, result.seconds, static_cast<double>(result.entries.size()) / seconds, static_cast<double>(result.bytes) / seconds / 1e6);
+            printf("Latency p50 %.1fms, p95 %.1fms, p99 %.1fms, max %.1fms\n", result.latency(50) * 1000, result.latency(95) * 1000, result.latency(99) * 1000, result.latency(100) * 1000);
+        }
+        return result.failed == 0 ? 0 : 1;
     }
 }
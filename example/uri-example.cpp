@@ -27,22 +27,22 @@ static void test_uri()
     // set the host
     url.set_host("www.example.com");
     // get the host
-    const std::string host = url.get_host();
+    const std::string_view host = url.get_host();
 
     // set the path
     url.set_path("/search");
     // get the path
-    const std::string path = url.get_path();
+    const std::string_view path = url.get_path();
 
     //set the scheme
     url.set_scheme("http");
     // get the scheme
-    const std::string scheme = url.get_scheme();
+    const std::string_view scheme = url.get_scheme();
 
     // set the fragement
     url.set_fragment("fragment"); // this is the part of the url after the #
     // get the fragment
-    const std::string fragment = url.get_fragment();
+    const std::string_view fragment = url.get_fragment();
 
     // clear existing parameters
     url.clear_parameters();
@@ -51,7 +51,9 @@ static void test_uri()
     url.add_parameter("other", false); // this will add &other=false to the url
     url.add_parameter("number", 5); // this will add &number=5 to the url
     // get a parameter
-    const std::map<std::string, std::string> parameters = url.get_parameters();
+    const std::optional<std::string_view> query = url.get_parameter("query");
+    // get every parameter, in the order of the query string
+    const std::vector<std::pair<std::string_view, std::string_view>> parameters = url.get_parameters();
 
     // convert a uri object to a string
     const std::string url_string = url.to_string();
@@ -0,0 +1,231 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef ASYNC_HTTP_CLIENT_H
+#define ASYNC_HTTP_CLIENT_H
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "body_sink.h"
+#include "event_loop.h"
+#include "http_message.h"
+#include "resolver.h"
+#include "tcp_client.h"
+
+namespace cnet
+{
+    /**
+     * @brief Options controlling how an async_http_client makes its requests.
+     */
+    struct async_http_client_options
+    {
+        /**
+         * @brief The time in milliseconds a request may go without any progress before it fails.
+         */
+        unsigned int timeout = CNET_DEFAULT_TIMEOUT;
+        /**
+         * @brief The maximum number of connections open to a single host at once, further requests wait for one.
+         */
+        size_t max_connections_per_host = 32;
+        /**
+         * @brief The maximum number of idle keep-alive connections kept open per host.
+         */
+        size_t max_idle_per_host = 8;
+        /**
+         * @brief The TLS settings of https connections.
+         */
+        tls_options tls;
+        /**
+         * @brief Looks up the hosts, without blocking the loop when it runs lookups on its own threads. The
+         * process-wide default, a cache in front of getaddrinfo(), if null.
+         */
+        std::shared_ptr<resolver> host_resolver;
+        /**
+         * @brief Whether the registered content codings are sent in Accept-Encoding and responses using them are decoded
+         * as they arrive, see http_client_options::decode_content.
+         */
+        bool decode_content = true;
+    };
+
+    /**
+     * @brief Called once a request completes, with the response or the reason it failed.
+     *
+     * @param response The request message with the status, headers and, unless a sink was given, the body of the response.
+     * @param error Null on success, otherwise the exception that failed the request, which std::rethrow_exception raises.
+     */
+    using response_handler = std::function<void(http_message &response, std::exception_ptr error)>;
+
+    class async_http_client;
+
+    /**
+     * @brief What co_await on async_http_client::request() waits on, resuming with the response.
+     *
+     * It only needs C++17 to compile, the coroutine handle is taken as a template parameter.
+     */
+    class request_awaiter
+    {
+    private:
+        async_http_client &client;
+        http_message message;
+        std::exception_ptr error;
+
+        void start(std::function<void()> resume);
+
+    public:
+        request_awaiter(async_http_client &client, http_message message): client(client), message(std::move(message)) {}
+
+        [[nodiscard]] bool await_ready() const { return false; }
+
+        template<typename handle_type>
+        void await_suspend(handle_type handle) { start([handle]() mutable { handle.resume(); }); }
+
+        /**
+         * @brief Returns the response.
+         * @throws std::exception Whatever failed the request.
+         */
+        http_message await_resume();
+    };
+
+    /**
+     * @brief An http client that runs any number of requests concurrently on an event_loop, without a thread per request.
+     *
+     * Every request is a small state machine driven by socket readiness: connect, TLS handshake, send, and receive into
+     * the incremental response parser. On a loop that supports io_uring completions, plain http requests are driven by
+     * completions instead: a linked fixed file registration and connect, a send, and a multishot receive into the
+     * loop's provided buffers. Connections are kept alive and reused per host. The handlers run on the loop's thread,
+     * and the client must outlive the requests it has started.
+     * @code{.cpp}
+     * cnet::event_loop loop;
+     * cnet::async_http_client client(loop);
+     * for (const std::string &url: urls)
+     * {
+     *     client.make_request(cnet::http_message(url), [](cnet::http_message &response, std::exception_ptr error)
+     *     {
+     *         if (error == nullptr) printf("%d %s\n", response.status_code, response.url.to_string().c_str());
+     *     });
+     * }
+     * loop.run();
+     * @endcode
+     */
+    class async_http_client
+    {
+    private:
+        struct request_state;
+
+        struct idle_connection
+        {
+            tcp_client connection;
+            // the fixed file slot of a connection driven by io_uring completions, -1 otherwise
+            int slot;
+        };
+
+        struct host_state
+        {
+            std::vector<idle_connection> idle;
+            std::deque<std::shared_ptr<request_state>> waiting;
+            size_t open = 0;
+        };
+
+        event_loop &loop;
+        async_http_client_options options;
+        std::shared_ptr<tls_context> tls;
+        std::shared_ptr<resolver> host_resolver;
+        std::unordered_map<std::string, host_state> hosts;
+        std::atomic<size_t> in_flight = 0;
+
+        void start(const std::shared_ptr<request_state> &state);
+
+        void lookup(const std::shared_ptr<request_state> &state);
+
+        void start_connect(const std::shared_ptr<request_state> &state, const std::vector<endpoint> &addresses);
+
+        void watch_attempts(const std::shared_ptr<request_state> &state);
+
+        void advance(const std::shared_ptr<request_state> &state);
+
+        void watch(const std::shared_ptr<request_state> &state, io_wait wait);
+
+        bool deliver(const std::shared_ptr<request_state> &state);
+#ifdef CNET_IO_URING
+        void connect_ring(const std::shared_ptr<request_state> &state);
+
+        void send_ring(const std::shared_ptr<request_state> &state);
+
+        void receive_ring(const std::shared_ptr<request_state> &state);
+#endif
+
+        void arm_timer(const std::shared_ptr<request_state> &state, unsigned int delay);
+
+        void complete(const std::shared_ptr<request_state> &state);
+
+        void fail(const std::shared_ptr<request_state> &state, std::exception_ptr error);
+
+        void detach(const std::shared_ptr<request_state> &state, bool reusable);
+
+        void submit(http_message &&message, body_sink *sink, response_handler &&handler);
+
+    public:
+        /**
+         * @brief Constructs a client whose requests run on the given loop.
+         *
+         * @param loop The loop, which must outlive the client.
+         * @param options The options to use for every request.
+         */
+        explicit async_http_client(event_loop &loop, async_http_client_options options = {});
+
+        /**
+         * @brief Closes the idle connections, on the loop's thread or once the loop has stopped.
+         */
+        ~async_http_client();
+
+        async_http_client(const async_http_client &) = delete;
+
+        async_http_client &operator=(const async_http_client &) = delete;
+
+        /**
+         * @brief Starts a request, the handler is called on the loop's thread once it completes. Thread safe.
+         *
+         * @param message The request to send.
+         * @param handler Receives the response, with its body, or the error.
+         */
+        void make_request(http_message message, response_handler handler);
+
+        /**
+         * @brief Starts a request that streams the response body to a sink. Thread safe.
+         *
+         * @param message The request to send.
+         * @param sink Receives the body on the loop's thread, it must stay alive until the handler is called.
+         * @param handler Receives the response, without its body, or the error.
+         */
+        void make_request(http_message message, body_sink &sink, response_handler handler);
+
+        /**
+         * @brief Starts a request from a coroutine, which resumes on the loop's thread with the response.
+         *
+         * @code{.cpp}
+         * cnet::task<void> fetch(cnet::async_http_client &client)
+         * {
+         *     cnet::http_message response = co_await client.request(cnet::http_message("http://example.com/"));
+         *     printf("%d\n", response.status_code);
+         * }
+         * @endcode
+         *
+         * @param message The request to send.
+         * @return An awaitable that resumes with the response, or throws the error.
+         */
+        [[nodiscard]] request_awaiter request(http_message message) { return {*this, std::move(message)}; }
+
+        /**
+         * @brief Returns the number of requests started whose handler hasn't been called yet.
+         */
+        [[nodiscard]] size_t get_in_flight() const { return in_flight; }
+    };
+} // cnet
+
+#endif //ASYNC_HTTP_CLIENT_H
@@ -0,0 +1,155 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef ASYNC_SOCKET_H
+#define ASYNC_SOCKET_H
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+#include "event_loop.h"
+#include "tcp_client.h"
+
+namespace cnet
+{
+    class async_socket;
+
+    /**
+     * @brief What co_await on an async_socket operation waits on, resuming with the number of bytes transferred.
+     *
+     * The operation is tried once without suspending, so data that is already available doesn't cost a trip through
+     * the loop. It only needs C++17 to compile, the coroutine handle is taken as a template parameter.
+     */
+    class socket_awaiter
+    {
+    private:
+        friend class async_socket;
+
+        async_socket &socket;
+        // makes as much progress as possible without blocking, returns true once done
+        std::function<bool(io_wait &wait, size_t &result)> operation;
+        io_wait wait = io_wait::none;
+        size_t result = 0;
+        std::exception_ptr error;
+
+        void start(std::function<void()> resume);
+
+    public:
+        socket_awaiter(async_socket &socket, std::function<bool(io_wait &, size_t &)> operation): socket(socket), operation(std::move(operation)) {}
+
+        bool await_ready();
+
+        template<typename handle_type>
+        void await_suspend(handle_type handle) { start([handle]() mutable { handle.resume(); }); }
+
+        /**
+         * @brief Returns the number of bytes transferred, 0 for a connect or when the peer closed the connection.
+         * @throws std::runtime_error If the operation failed or timed out.
+         */
+        size_t await_resume();
+    };
+
+    /**
+     * @brief A tcp_client whose connect, reads and writes are awaited from coroutines running on an event_loop.
+     *
+     * Only one operation may be awaited at a time, and only on the loop's thread. The socket must outlive the
+     * operation it is awaiting.
+     * @code{.cpp}
+     * cnet::task<void> echo(cnet::event_loop &loop)
+     * {
+     *     cnet::async_socket socket(loop);
+     *     co_await socket.connect("localhost", 7);
+     *     co_await socket.write("ping", 4);
+     *     char buffer[4];
+     *     const size_t received = co_await socket.read(buffer, sizeof(buffer));
+     * }
+     * @endcode
+     */
+    class async_socket
+    {
+    private:
+        friend class socket_awaiter;
+
+        event_loop &loop;
+        tcp_client connection;
+        unsigned int timeout;
+        std::shared_ptr<tls_context> tls;
+
+        int fd = -1;
+        uint32_t events = 0;
+        socket_awaiter *pending = nullptr;
+        std::function<void()> resume;
+        unsigned long long timer = 0;
+        // the sockets racing to connect, and the timer starting the next address
+        std::vector<int> racing;
+        unsigned long long attempt_timer = 0;
+
+        void suspend(socket_awaiter &awaiter, std::function<void()> resume);
+
+        void run();
+
+        void advance();
+
+        void finish();
+
+    public:
+        /**
+         * @brief Constructs a socket that isn't connected yet.
+         *
+         * @param loop The loop the operations wait on, which must outlive the socket.
+         * @param timeout The time in milliseconds an operation may wait before it fails.
+         * @param tls The TLS settings used by a secure connect().
+         */
+        explicit async_socket(event_loop &loop, unsigned int timeout = CNET_DEFAULT_TIMEOUT, const tls_options &tls = {});
+
+        /**
+         * @brief Closes the connection.
+         */
+        ~async_socket();
+
+        async_socket(const async_socket &) = delete;
+
+        async_socket &operator=(const async_socket &) = delete;
+
+        /**
+         * @brief Connects to a host, then performs the TLS handshake if secure.
+         *
+         * @param host The hostname or IP address of the server to connect to.
+         * @param port The port number to connect to on the server.
+         * @param secure Whether to secure the connection with TLS.
+         * @return An awaitable that resumes once connected.
+         */
+        [[nodiscard]] socket_awaiter connect(const std::string &host, unsigned int port, bool secure = false);
+
+        /**
+         * @brief Receives whatever data arrives first, through TLS if the connection is secure.
+         *
+         * @param buffer The buffer to receive into, which must stay valid until the operation resumes.
+         * @param size The size of the buffer.
+         * @return An awaitable that resumes with the number of bytes received, 0 if the peer closed the connection.
+         */
+        [[nodiscard]] socket_awaiter read(char *buffer, size_t size);
+
+        /**
+         * @brief Sends all of the data, through TLS if the connection is secure.
+         *
+         * @param data The data to send, which must stay valid until the operation resumes.
+         * @param size The number of bytes to send.
+         * @return An awaitable that resumes with the number of bytes sent once all of them are.
+         */
+        [[nodiscard]] socket_awaiter write(const char *data, size_t size);
+
+        /**
+         * @brief Closes the connection, it can't be called while an operation is awaited.
+         */
+        void close();
+
+        /**
+         * @brief Returns the underlying connection.
+         */
+        [[nodiscard]] tcp_client &get_connection() { return connection; }
+    };
+} // cnet
+
+#endif //ASYNC_SOCKET_H
@@ -0,0 +1,146 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef BATCH_DOWNLOADER_H
+#define BATCH_DOWNLOADER_H
+#include <string>
+#include <vector>
+#include "http_client.h"
+
+namespace cnet
+{
+    /**
+     * @brief Options controlling how a batch_downloader fetches a list of requests.
+     */
+    struct batch_options
+    {
+        /**
+         * @brief The maximum number of requests in flight at once.
+         */
+        unsigned int max_threads = 4;
+        /**
+         * @brief The maximum number of requests in flight to a single host at once.
+         */
+        unsigned int max_per_host = 6;
+        /**
+         * @brief The options of the http clients used for each request, a connection pool is created if none is set.
+         */
+        http_client_options client;
+    };
+
+    /**
+     * @brief One request of a batch.
+     */
+    struct batch_request
+    {
+        /**
+         * @brief The request to send.
+         */
+        http_message message;
+        /**
+         * @brief The file the response body is written to, the body is discarded if this is empty.
+         */
+        std::string path;
+    };
+
+    /**
+     * @brief The outcome of one request of a batch.
+     */
+    struct batch_entry
+    {
+        /**
+         * @brief The url of the request.
+         */
+        std::string url;
+        /**
+         * @brief The status code of the response, 0 if no response was received.
+         */
+        int status_code = 0;
+        /**
+         * @brief The size of the response body in bytes.
+         */
+        unsigned long long size = 0;
+        /**
+         * @brief The time from sending the request to receiving the whole body, in seconds.
+         */
+        double seconds = 0;
+        /**
+         * @brief Why the request failed, empty if a response was received.
+         */
+        std::string error;
+
+        /**
+         * @brief Returns true if a successful response was received.
+         */
+        [[nodiscard]] bool is_sucess() const { return error.empty() && status_code >= 200 && status_code < 400; }
+    };
+
+    /**
+     * @brief The outcome of a batch.
+     */
+    struct batch_result
+    {
+        /**
+         * @brief The outcome of every request, in the order they were given.
+         */
+        std::vector<batch_entry> entries;
+        /**
+         * @brief The total size of the response bodies in bytes.
+         */
+        unsigned long long bytes = 0;
+        /**
+         * @brief The number of requests that failed or got an error status.
+         */
+        size_t failed = 0;
+        /**
+         * @brief The time the whole batch took in seconds.
+         */
+        double seconds = 0;
+
+        /**
+         * @brief Returns the latency below which the given share of the successful requests completed.
+         *
+         * @param percentile The share, between 0 and 100, e.g. 50 for the median or 95.
+         * @return The latency in seconds, 0 if no request succeeded.
+         */
+        [[nodiscard]] double latency(double percentile) const;
+    };
+
+    /**
+     * @brief Fetches a list of requests concurrently over shared keep-alive connections.
+     *
+     * Requests are grouped by host. A worker keeps taking requests for the host it last talked to, so it reuses the
+     * pooled connection it just released, and only moves to another host once that host has no requests left.
+     * Concurrency is bounded overall by max_threads and per host by max_per_host.
+     * @code{.cpp}
+     * cnet::batch_downloader batch;
+     * const cnet::batch_result result = batch.run({{cnet::http_message("https://example.com/a.txt"), "a.txt"}});
+     * @endcode
+     */
+    class batch_downloader
+    {
+    private:
+        batch_options options;
+
+    public:
+        /**
+         * @brief Constructs a batch downloader with the given options.
+         *
+         * @param options The options to use for every batch.
+         */
+        explicit batch_downloader(batch_options options = {});
+
+        /**
+         * @brief Sends every request and waits for all of them to complete.
+         *
+         * A failing request doesn't stop the batch, its error is recorded in its entry of the result.
+         *
+         * @param requests The requests to send.
+         * @return The outcome of every request.
+         */
+        batch_result run(const std::vector<batch_request> &requests);
+    };
+} // cnet
+
+#endif //BATCH_DOWNLOADER_H
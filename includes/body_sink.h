@@ -0,0 +1,159 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef BODY_SINK_H
+#define BODY_SINK_H
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "http_message.h"
+
+namespace cnet
+{
+    /**
+     * @brief A destination for a response body that is delivered in pieces as it arrives.
+     *
+     * Streaming the body into a sink keeps memory use bounded by the receive buffer, however large the body is.
+     * @code{.cpp}
+     * cnet::file_sink file("artifact.zip");
+     * client.make_request(message, file);
+     * @endcode
+     */
+    class body_sink
+    {
+    public:
+        virtual ~body_sink() = default;
+
+        /**
+         * @brief Called once the status line and headers of the response have arrived, before any of the body.
+         *
+         * @param response The response, with its status code and headers filled in.
+         * @throws std::runtime_error To reject the response, e.g. when a range request is answered with the whole resource.
+         */
+        virtual void start([[maybe_unused]] const http_message &response) {}
+
+        /**
+         * @brief Receives the next piece of the body.
+         *
+         * @param chunk The body data, only valid for the duration of the call.
+         */
+        virtual void write(std::string_view chunk) = 0;
+
+        /**
+         * @brief Called once the whole body has been received.
+         */
+        virtual void finish() {}
+    };
+
+    /**
+     * @brief Writes the body to a file.
+     */
+    class file_sink : public body_sink
+    {
+    private:
+        std::ofstream stream;
+        unsigned long long written = 0;
+
+    public:
+        /**
+         * @brief Opens the file, replacing its contents.
+         *
+         * @param path The path of the file.
+         * @throws std::runtime_error If the file can't be opened.
+         */
+        explicit file_sink(const std::string &path);
+
+        /**
+         * @brief Opens an existing file and writes the body starting at the given offset, leaving the rest of the file as is.
+         *
+         * This is used to fill in one part of a file that is downloaded in several ranges.
+         *
+         * @param path The path of the file, which must exist.
+         * @param offset The byte offset the body is written at.
+         * @throws std::runtime_error If the file can't be opened.
+         */
+        file_sink(const std::string &path, unsigned long long offset);
+
+        void write(std::string_view chunk) override;
+
+        void finish() override;
+
+        /**
+         * @brief Returns the number of bytes written so far.
+         */
+        [[nodiscard]] unsigned long long get_written() const { return written; }
+    };
+
+    /**
+     * @brief Collects the body in memory.
+     */
+    class memory_sink : public body_sink
+    {
+    private:
+        std::string data;
+        size_t max_size;
+
+    public:
+        /**
+         * @brief Constructs a memory sink.
+         *
+         * @param max_size The largest body accepted, a larger body fails the request instead of exhausting memory.
+         */
+        explicit memory_sink(const size_t max_size = static_cast<size_t>(-1)): max_size(max_size) {}
+
+        /**
+         * @throws std::runtime_error If the body grows past max_size.
+         */
+        void write(std::string_view chunk) override;
+
+        /**
+         * @brief Returns the body received so far.
+         */
+        [[nodiscard]] const std::string &get_data() const { return data; }
+
+        /**
+         * @brief Moves the body out of the sink, leaving it empty.
+         */
+        std::string take() { return std::move(data); }
+    };
+
+    /**
+     * @brief Throws the body away, only counting its size.
+     */
+    class discard_sink : public body_sink
+    {
+    private:
+        unsigned long long size = 0;
+
+    public:
+        void write(const std::string_view chunk) override { size += chunk.size(); }
+
+        /**
+         * @brief Returns the number of bytes discarded.
+         */
+        [[nodiscard]] unsigned long long get_size() const { return size; }
+    };
+
+    /**
+     * @brief Hands every piece of the body to a callback.
+     */
+    class callback_sink : public body_sink
+    {
+    private:
+        std::function<void(std::string_view)> callback;
+
+    public:
+        /**
+         * @brief Constructs a callback sink.
+         *
+         * @param callback Called with each piece of the body, the view is only valid during the call.
+         */
+        explicit callback_sink(std::function<void(std::string_view)> callback): callback(std::move(callback)) {}
+
+        void write(const std::string_view chunk) override { callback(chunk); }
+    };
+} // cnet
+
+#endif //BODY_SINK_H
@@ -0,0 +1,64 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+#include <cstddef>
+#include <cstdint>
+
+#define CNET_SCAN_AVX2_MIN_SIZE 256 // bytes the AVX2 kernel scans with 16 byte vectors before it switches to 32 byte ones, which have a fixed cost
+
+namespace cnet
+{
+    /**
+     * @brief The instruction sets the byte scanning functions can use.
+     */
+    enum class scan_kernel : uint8_t
+    {
+        /**
+         * @brief Plain C++, on every CPU.
+         */
+        scalar,
+        /**
+         * @brief 16 bytes at a time, the hexadecimal digits are matched with the SSE4.2 string instructions.
+         */
+        sse42,
+        /**
+         * @brief 32 bytes at a time with AVX2, after the first CNET_SCAN_AVX2_MIN_SIZE bytes are scanned like sse42.
+         */
+        avx2,
+    };
+
+    /**
+     * @brief Returns the kernel the scanning functions use.
+     *
+     * It is picked the first time a function is called, sse42 if the CPU supports it, unless set_scan_kernel() was called.
+     * avx2 has to be asked for, it only pays off when long stretches are scanned without a break.
+     */
+    scan_kernel get_scan_kernel();
+
+    /**
+     * @brief Changes the kernel the scanning functions use, e.g. to compare them. Thread safe.
+     *
+     * @param kernel The kernel to use, a narrower one is used instead if the CPU doesn't support it.
+     * @return The kernel used from now on.
+     */
+    scan_kernel set_scan_kernel(scan_kernel kernel);
+
+    /**
+     * @brief Finds the first occurrence of a byte, e.g. the \n ending a line or the : of a header field.
+     *
+     * @return The position of the byte, or size if it doesn't occur.
+     */
+    size_t find_byte(const char *data, size_t size, char byte);
+
+    /**
+     * @brief Finds the first byte that isn't a hexadecimal digit, the delimiter after the size of a chunk.
+     *
+     * @return The position of the byte, or size if every byte is a digit.
+     */
+    size_t find_non_hex(const char *data, size_t size);
+} // cnet
+
+#endif //BYTE_SCAN_H
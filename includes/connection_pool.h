@@ -0,0 +1,201 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "resolver.h"
+#include "tcp_client.h"
+
+#define CNET_POOL_SHARDS 16 // independently locked parts of a connection_pool, hosts are spread over them by key
+
+namespace cnet
+{
+    /**
+     * @brief Limits applied by a connection_pool to every (scheme, host, port) it serves.
+     */
+    struct connection_pool_options
+    {
+        /**
+         * @brief The maximum number of idle connections kept open per host.
+         *
+         * Connections released while this many are already idle are closed instead of being kept.
+         */
+        size_t max_idle_per_host = 8;
+        /**
+         * @brief The maximum number of connections, idle and in use, open to a single host at once.
+         *
+         * When the limit is reached acquire() waits for a connection to be released.
+         */
+        size_t max_connections_per_host = 32;
+        /**
+         * @brief The time in milliseconds an idle connection is kept before it is evicted.
+         */
+        unsigned int idle_timeout = 60000;
+        /**
+         * @brief Looks up the hosts new connections are opened to, the process-wide default if null.
+         */
+        std::shared_ptr<resolver> host_resolver;
+    };
+
+    /**
+     * @brief Counters describing how a connection_pool has been used.
+     */
+    struct connection_pool_stats
+    {
+        /**
+         * @brief The number of acquisitions served by an idle connection.
+         */
+        unsigned long long hits = 0;
+        /**
+         * @brief The number of acquisitions that had to open a new connection.
+         */
+        unsigned long long misses = 0;
+        /**
+         * @brief The number of idle connections closed because they timed out or were closed by the peer.
+         */
+        unsigned long long evictions = 0;
+    };
+
+    /**
+     * @brief A pool of persistent keep-alive connections keyed by scheme, host and port.
+     *
+     * The pool is safe to share between several http_client objects and threads. Hosts are spread over
+     * CNET_POOL_SHARDS shards with a lock each, so threads talking to different hosts rarely wait for one another.
+     * @code{.cpp}
+     * auto pool = std::make_shared<cnet::connection_pool>();
+     * cnet::http_client client({pool});
+     * @endcode
+     */
+    class connection_pool
+    {
+    private:
+        struct idle_connection
+        {
+            tcp_client client;
+            std::chrono::steady_clock::time_point since;
+        };
+
+        struct host_entry
+        {
+            std::deque<idle_connection> idle;
+            size_t active = 0;
+        };
+
+        struct shard
+        {
+            std::map<std::string, host_entry> hosts;
+            std::mutex mutex;
+            std::condition_variable released;
+        };
+
+        connection_pool_options options;
+        std::array<shard, CNET_POOL_SHARDS> shards;
+
+        std::atomic<unsigned long long> hits = 0;
+        std::atomic<unsigned long long> misses = 0;
+        std::atomic<unsigned long long> evictions = 0;
+
+        /**
+         * @brief Closes the idle connections of an entry that have been idle longer than the idle timeout.
+         *
+         * The caller must hold the mutex of the entry's shard.
+         */
+        void evict_expired(host_entry &entry, std::chrono::steady_clock::time_point now);
+
+        /**
+         * @brief Returns the shard the hosts with the given key live in.
+         */
+        shard &get_shard(const std::string &key);
+
+    public:
+        /**
+         * @brief Constructs a connection pool with the given limits.
+         *
+         * @param options The limits applied to every host.
+         */
+        explicit connection_pool(connection_pool_options options = {});
+
+        ~connection_pool();
+
+        connection_pool(const connection_pool &) = delete;
+        connection_pool &operator=(const connection_pool &) = delete;
+
+        /**
+         * @brief Builds the key used to group connections.
+         *
+         * @param scheme The scheme of the connection, e.g. "https".
+         * @param host The host of the connection.
+         * @param port The port of the connection.
+         * @return The key in the format {scheme}://{host}:{port}.
+         */
+        static std::string make_key(std::string_view scheme, std::string_view host, unsigned int port);
+
+        /**
+         * @brief Gets an open connection to the given host.
+         *
+         * The most recently released idle connection is reused if it is still alive. Otherwise a new connection is
+         * opened, performing the SSL handshake when secure is true. If the host already has the maximum number of
+         * connections, this waits up to the timeout for one to be released.
+         *
+         * Every acquired connection must be handed back with release().
+         *
+         * @param scheme The scheme of the connection.
+         * @param host The host to connect to.
+         * @param port The port to connect to.
+         * @param secure Whether the connection uses SSL.
+         * @param timeout The timeout in milliseconds for waiting and connecting.
+         * @param reused Set to true if an idle connection was reused.
+         * @return The connection.
+         * @throws std::runtime_error If no connection can be made available in time or the connect fails.
+         */
+        tcp_client acquire(const std::string &scheme, const std::string &host, unsigned int port, bool secure, unsigned int timeout, bool &reused);
+
+        /**
+         * @brief Hands a connection acquired with acquire() back to the pool.
+         *
+         * @param scheme The scheme the connection was acquired with.
+         * @param host The host the connection was acquired with.
+         * @param port The port the connection was acquired with.
+         * @param client The connection.
+         * @param reusable Whether the connection may be reused, false closes it.
+         */
+        void release(const std::string &scheme, const std::string &host, unsigned int port, tcp_client client, bool reusable);
+
+        /**
+         * @brief Closes every idle connection that has exceeded the idle timeout.
+         */
+        void evict_idle();
+
+        /**
+         * @brief Closes every idle connection.
+         */
+        void clear();
+
+        /**
+         * @brief Returns the usage counters of the pool.
+         *
+         * @return A snapshot of the counters.
+         */
+        [[nodiscard]] connection_pool_stats get_stats() const;
+
+        /**
+         * @brief Returns the limits of the pool.
+         *
+         * @return The options the pool was constructed with.
+         */
+        [[nodiscard]] const connection_pool_options &get_options() const { return options; }
+    };
+} // cnet
+
+#endif //CONNECTION_POOL_H
@@ -0,0 +1,21 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef CONST_BUFFER_H
+#define CONST_BUFFER_H
+#include <cstddef>
+
+namespace cnet
+{
+    /**
+     * @brief A view of bytes to send, one segment of a scatter-gather write. It doesn't own the bytes.
+     */
+    struct const_buffer
+    {
+        const char *data;
+        size_t size;
+    };
+} // cnet
+
+#endif //CONST_BUFFER_H
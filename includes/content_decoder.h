@@ -0,0 +1,153 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef CONTENT_DECODER_H
+#define CONTENT_DECODER_H
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "body_sink.h"
+#include "http_message.h"
+
+#define CNET_DECODE_BUFFER_SIZE 16384 // bytes a decoder inflates into before handing them on
+
+namespace cnet
+{
+    /**
+     * @brief Undoes one content coding of a response body (RFC 9110 section 8.4), e.g. gzip, as the body arrives.
+     *
+     * A decoder only keeps its own state and a buffer of CNET_DECODE_BUFFER_SIZE, never the whole body.
+     */
+    class content_decoder
+    {
+    public:
+        virtual ~content_decoder() = default;
+
+        /**
+         * @brief Decodes the next piece of the encoded body.
+         *
+         * @param chunk The encoded data, only valid for the duration of the call.
+         * @param output Receives the decoded data.
+         * @throws std::runtime_error If the data is corrupt.
+         */
+        virtual void write(std::string_view chunk, body_sink &output) = 0;
+
+        /**
+         * @brief Hands on what is left once the whole encoded body was written.
+         *
+         * @param output Receives the decoded data.
+         * @throws std::runtime_error If the encoded body was cut short.
+         */
+        virtual void finish(body_sink &output) = 0;
+
+        /**
+         * @brief Creates a decoder for each new response with the coding.
+         */
+        using factory = std::function<std::unique_ptr<content_decoder>()>;
+
+        /**
+         * @brief Adds a coding, or replaces the decoder of one, for every client of the process. Thread safe.
+         *
+         * The codings are listed in Accept-Encoding in the order they were first registered, gzip, deflate and those of
+         * the optional libraries built in (br with CNET_BROTLI, zstd with CNET_ZSTD) coming first.
+         * @code{.cpp}
+         * cnet::content_decoder::register_coding("x-custom", [] { return std::make_unique<custom_decoder>(); });
+         * @endcode
+         *
+         * @param name The lowercase name of the coding, as it appears in Content-Encoding.
+         * @param create Creates the decoder, null removes the coding.
+         */
+        static void register_coding(const std::string &name, factory create);
+
+        /**
+         * @brief Creates a decoder for a coding. Thread safe.
+         *
+         * @param name The name of the coding, in any case.
+         * @return The decoder, or null if the coding isn't registered.
+         */
+        static std::unique_ptr<content_decoder> create(std::string_view name);
+
+        /**
+         * @brief Returns the registered codings as an Accept-Encoding value, e.g. "gzip, deflate, br". Thread safe.
+         */
+        static std::string get_accept_encoding();
+    };
+
+    /**
+     * @brief A sink that decodes the body of a response before handing it to another sink or a string.
+     *
+     * start() picks the decoders from the Content-Encoding of the response and undoes the codings in the reverse order
+     * they were applied. A coding that isn't registered leaves the body as it was received.
+     */
+    class decoding_sink : public body_sink
+    {
+    private:
+        // feeds the output of one decoder to the next
+        struct stage : body_sink
+        {
+            decoding_sink *owner = nullptr;
+            size_t index = 0;
+
+            void write(const std::string_view chunk) override { owner->forward(index, chunk); }
+        };
+
+        body_sink *next;
+        std::string *body;
+        std::vector<std::unique_ptr<content_decoder>> decoders;
+        std::vector<stage> stages;
+        unsigned long long decoded = 0;
+
+        void forward(size_t index, std::string_view chunk);
+
+    public:
+        /**
+         * @brief Constructs a decoding sink.
+         *
+         * @param next Receives the decoded body, if null it is appended to body instead.
+         * @param body Receives the decoded body when there is no next sink.
+         */
+        decoding_sink(body_sink *next, std::string *body): next(next), body(body) {}
+
+        decoding_sink(const decoding_sink &) = delete;
+
+        decoding_sink &operator=(const decoding_sink &) = delete;
+
+        /**
+         * @brief Picks the decoders, the next sink is started with the headers the decoded body has.
+         *
+         * A 1xx, 204 or 304 response has no body, so it isn't decoded and its Content-Length is left alone.
+         */
+        void start(const http_message &response) override;
+
+        /**
+         * @throws std::runtime_error If the body is corrupt.
+         */
+        void write(std::string_view chunk) override;
+
+        /**
+         * @throws std::runtime_error If the body was cut short.
+         */
+        void finish() override;
+
+        /**
+         * @brief Describes the decoded body in the response, dropping its Content-Encoding and Content-Length and
+         * setting the content length to the decoded size. Nothing changes if the body wasn't decoded.
+         */
+        void apply(http_message &response) const;
+
+        /**
+         * @brief Returns whether the body is being decoded.
+         */
+        [[nodiscard]] bool is_decoding() const { return !decoders.empty(); }
+
+        /**
+         * @brief Returns the number of decoded bytes handed on so far.
+         */
+        [[nodiscard]] unsigned long long get_decoded() const { return decoded; }
+    };
+} // cnet
+
+#endif //CONTENT_DECODER_H
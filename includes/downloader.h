@@ -0,0 +1,133 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef DOWNLOADER_H
+#define DOWNLOADER_H
+#include <string>
+#include "http_client.h"
+
+namespace cnet
+{
+    /**
+     * @brief Options controlling how a downloader fetches a file.
+     */
+    struct download_options
+    {
+        /**
+         * @brief The number of byte ranges the file is split into up front.
+         */
+        unsigned int parts = 1;
+        /**
+         * @brief The maximum number of ranges fetched at once, each over its own connection.
+         */
+        unsigned int max_threads = 4;
+        /**
+         * @brief Whether the whole output file is allocated on disk before any data is written.
+         */
+        bool preallocate = false;
+        /**
+         * @brief Whether the file is assembled in memory and written out once complete.
+         */
+        bool in_memory = false;
+        /**
+         * @brief Whether an interrupted download is continued instead of started over.
+         *
+         * The missing ranges are read from the journal left next to the output file, or, without a journal, the
+         * download continues from the end of the existing file. Continuing requires the server to support byte ranges
+         * and is ignored for in-memory downloads.
+         */
+        bool resume = false;
+        /**
+         * @brief The number of times a failed range is retried, continuing from the last byte received.
+         */
+        unsigned int retries = 3;
+        /**
+         * @brief The smallest range an idle connection will split off a slow one.
+         */
+        unsigned long long min_split_size = 1024 * 1024;
+        /**
+         * @brief The options of the http clients used for each connection, a connection pool is created if none is set.
+         */
+        http_client_options client;
+    };
+
+    /**
+     * @brief The outcome of a download.
+     */
+    struct download_result
+    {
+        /**
+         * @brief The size of the file in bytes.
+         */
+        unsigned long long size = 0;
+        /**
+         * @brief Whether the file was fetched in byte ranges, false if the server doesn't support them.
+         */
+        bool ranged = false;
+        /**
+         * @brief The number of ranges fetched, including those split off slow ranges.
+         */
+        unsigned int ranges = 0;
+        /**
+         * @brief The number of bytes that were already on disk from an earlier attempt and weren't fetched again.
+         */
+        unsigned long long resumed = 0;
+        /**
+         * @brief The number of times an idle connection split a range off a slow one.
+         */
+        unsigned int splits = 0;
+        /**
+         * @brief The time the download took in seconds.
+         */
+        double seconds = 0;
+    };
+
+    /**
+     * @brief Downloads a file over several concurrent connections.
+     *
+     * The size and Accept-Ranges of the file are probed with a HEAD request. If the server supports byte ranges the
+     * file is split into ranges that are fetched concurrently, each written straight to its offset in the output file.
+     * Once no unstarted range is left, a connection that becomes idle splits the remaining bytes of the slowest range
+     * in two and takes over the second half, so one slow connection doesn't hold up the whole download. A server that
+     * doesn't support ranges, or answers a range request with the whole resource, is downloaded over one connection.
+     *
+     * While a ranged download runs, the bytes still missing are recorded in a journal next to the output file, named
+     * after it with a .cnet extension, which is removed once the download completes. Range requests carry the ETag (or
+     * Last-Modified date) of the resource in an If-Range header, so a resource that changes between attempts is
+     * downloaded again in full instead of being stitched together from two versions.
+     * @code{.cpp}
+     * cnet::download_options options;
+     * options.parts = 8;
+     * cnet::downloader downloader(options);
+     * downloader.download(cnet::http_message("https://example.com/file.zip"), "file.zip");
+     * @endcode
+     */
+    class downloader
+    {
+    private:
+        download_options options;
+
+        download_result download_single(const http_message &request, const std::string &path);
+
+    public:
+        /**
+         * @brief Constructs a downloader with the given options.
+         *
+         * @param options The options to use for every download.
+         */
+        explicit downloader(download_options options = {});
+
+        /**
+         * @brief Downloads the resource described by the request to a file.
+         *
+         * @param request The request, usually a GET, extra headers are sent with every range request.
+         * @param path The path of the output file, which is replaced.
+         * @return The outcome of the download.
+         * @throws std::runtime_error If a range still fails after the retries, or the file can't be written.
+         */
+        download_result download(const http_message &request, const std::string &path);
+    };
+} // cnet
+
+#endif //DOWNLOADER_H
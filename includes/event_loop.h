@@ -0,0 +1,378 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "const_buffer.h"
+
+#ifdef CNET_IO_URING
+#include <sys/socket.h>
+#endif
+
+#define CNET_IO_URING_ENTRIES 1024 // submission queue size of the io_uring backend
+#define CNET_IO_URING_FILES 4096 // fixed file slots, the sockets the completion API can have open at once
+#define CNET_IO_URING_BUFFERS 1024 // provided receive buffers, a power of two
+#define CNET_IO_URING_BUFFER_SIZE 4096 // bytes per provided receive buffer
+
+namespace cnet
+{
+    class io_ring;
+
+    /**
+     * @brief The kernel interface an event_loop waits on.
+     */
+    enum class loop_backend
+    {
+        /**
+         * @brief io_uring when it was compiled in and the kernel allows it, epoll otherwise.
+         */
+        automatic,
+        /**
+         * @brief epoll, with one system call per readiness change.
+         */
+        epoll,
+        /**
+         * @brief io_uring, which batches every submission of an iteration into the call that waits, and also offers
+         * the completion API. Falls back to epoll if unavailable.
+         */
+        io_uring,
+    };
+
+    /**
+     * @brief A single-threaded reactor that dispatches socket readiness, timers and posted tasks, built on epoll or
+     * io_uring.
+     *
+     * Every handler runs on the thread calling run(), so the sockets and state they touch need no locking. Only post()
+     * and stop() may be called from other threads. Linux only.
+     *
+     * With the io_uring backend, readiness is a one-shot poll re-armed after each dispatch, and supports_completions()
+     * tells if sockets can also be driven by completions: connect, send and a multishot receive into buffers shared
+     * with the kernel, on sockets registered as fixed files.
+     * @code{.cpp}
+     * cnet::event_loop loop;
+     * loop.add_timer(100, [] { puts("100ms later"); });
+     * loop.run(); // returns once nothing is left to wait for
+     * @endcode
+     */
+    class event_loop
+    {
+    public:
+        /**
+         * @brief Called with the epoll events (EPOLLIN, EPOLLOUT, EPOLLERR, EPOLLHUP) a watched socket is ready for.
+         */
+        using event_handler = std::function<void(uint32_t events)>;
+
+        /**
+         * @brief Called with the result of an io_uring operation, a negative errno on failure, and the completion flags.
+         */
+        using completion_handler = std::function<void(int result, uint32_t flags)>;
+
+    private:
+        struct watch_entry
+        {
+            event_handler handler;
+            uint32_t generation;
+            uint32_t events;
+            bool armed;
+        };
+
+        loop_backend backend = loop_backend::epoll;
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        std::unordered_map<int, std::shared_ptr<watch_entry>> watches;
+        uint32_t generation = 0;
+
+        std::map<std::pair<std::chrono::steady_clock::time_point, unsigned long long>, std::function<void()>> timers;
+        std::unordered_map<unsigned long long, std::chrono::steady_clock::time_point> timer_deadlines;
+        unsigned long long next_timer = 1;
+
+        std::mutex tasks_mutex;
+        std::vector<std::function<void()>> tasks;
+        std::atomic<bool> stopped = false;
+        std::atomic<size_t> pending_tasks = 0;
+        // written by run() while other threads read it in post()
+        std::atomic<std::thread::id> thread;
+
+        void run_tasks();
+
+        void run_timers();
+
+        [[nodiscard]] bool is_idle() const;
+
+        [[nodiscard]] int next_timeout() const;
+
+        void wait_epoll();
+
+#ifdef CNET_IO_URING
+        struct operation
+        {
+            completion_handler handler;
+            int file = -1;
+            sockaddr_storage address{};
+            // what a sendmsg reads until it completes
+            std::vector<iovec> vectors;
+            msghdr header{};
+        };
+
+        std::unique_ptr<io_ring> ring;
+        std::unordered_map<unsigned long long, std::unique_ptr<operation>> operations;
+        unsigned long long next_operation = 1;
+        std::vector<int> free_files;
+        bool completions = false;
+
+        bool setup_ring();
+
+        void arm_poll(int fd, watch_entry &entry);
+
+        void arm_wake();
+
+        unsigned long long add_operation(std::unique_ptr<operation> op);
+
+        void wait_ring();
+#endif
+
+    public:
+        /**
+         * @brief Creates the epoll or io_uring instance of the loop.
+         *
+         * @param backend The kernel interface to use, io_uring if possible by default.
+         * @throws std::runtime_error If neither epoll nor io_uring, or the wake-up eventfd, can be created.
+         */
+        explicit event_loop(loop_backend backend = loop_backend::automatic);
+
+        ~event_loop();
+
+        event_loop(const event_loop &) = delete;
+
+        event_loop &operator=(const event_loop &) = delete;
+
+        /**
+         * @brief Starts watching a socket, the handler is called whenever it is ready for one of the events.
+         *
+         * Watching is level-triggered, the handler is called again as long as the socket stays ready.
+         *
+         * @param fd The socket.
+         * @param events The epoll events to watch, EPOLLIN and/or EPOLLOUT.
+         * @param handler Called with the ready events.
+         * @throws std::runtime_error If epoll refuses the socket.
+         */
+        void watch(int fd, uint32_t events, event_handler handler);
+
+        /**
+         * @brief Changes the events a watched socket is waited for.
+         *
+         * @param fd The socket, which must be watched.
+         * @param events The epoll events to watch.
+         * @throws std::runtime_error If epoll refuses the change.
+         */
+        void modify(int fd, uint32_t events);
+
+        /**
+         * @brief Stops watching a socket, its handler isn't called anymore, even for events already reported.
+         *
+         * This must be called before the socket is closed.
+         *
+         * @param fd The socket.
+         */
+        void unwatch(int fd);
+
+        /**
+         * @brief Makes a set of watched sockets match a list, e.g. the attempts of a connect racing several addresses.
+         *
+         * Every socket is watched anew, even when the list looks unchanged, as a socket closed since may have been
+         * replaced by a new one with the same descriptor. Meant for the few events of a connect, not for a busy socket.
+         *
+         * @param watched The sockets watched so far, replaced by the list.
+         * @param fds The sockets to watch.
+         * @param events The epoll events to watch.
+         * @param handler Called with the ready events of any of the sockets.
+         */
+        void watch_all(std::vector<int> &watched, const std::vector<int> &fds, uint32_t events, const event_handler &handler);
+
+        /**
+         * @brief Calls a function once after a delay.
+         *
+         * @param delay The delay in milliseconds.
+         * @param callback The function to call.
+         * @return An id that cancels the timer when passed to cancel_timer().
+         */
+        unsigned long long add_timer(unsigned int delay, std::function<void()> callback);
+
+        /**
+         * @brief Cancels a timer that hasn't fired yet, does nothing if it already has.
+         *
+         * @param id The id returned by add_timer().
+         */
+        void cancel_timer(unsigned long long id);
+
+        /**
+         * @brief Queues a function to run on the loop's thread, waking the loop if it is waiting. Thread safe.
+         *
+         * @param task The function to run.
+         */
+        void post(std::function<void()> task);
+
+        /**
+         * @brief Dispatches events on the calling thread until stop() is called.
+         *
+         * @param forever When false, run() also returns once no socket is watched and no timer or task is pending.
+         */
+        void run(bool forever = false);
+
+        /**
+         * @brief Makes run() return after the handlers of the current iteration. Thread safe.
+         */
+        void stop();
+
+        /**
+         * @brief Returns whether the caller is running on the loop's thread.
+         */
+        [[nodiscard]] bool in_loop_thread() const { return std::this_thread::get_id() == thread.load(); }
+
+        /**
+         * @brief Returns the backend the loop ended up with, never loop_backend::automatic.
+         */
+        [[nodiscard]] loop_backend get_backend() const { return backend; }
+
+        /**
+         * @brief Returns whether the completion API below can be used, only with the io_uring backend.
+         */
+        [[nodiscard]] bool supports_completions() const;
+
+#ifdef CNET_IO_URING
+        /**
+         * @brief Returns the number of fixed file slots left for submit_connect().
+         */
+        [[nodiscard]] size_t get_free_files() const { return free_files.size(); }
+
+        /**
+         * @brief Registers a socket as a fixed file and connects it, both in the next submission batch.
+         *
+         * @param fd The socket, non-blocking and not yet connected. It can be closed once the slot is released.
+         * @param address The address to connect to, copied.
+         * @param length The length of the address.
+         * @param handler Called with 0 once connected, or the negative errno of the failure.
+         * @return The fixed file slot the other operations take, release it with release_file() once done.
+         * @throws std::runtime_error If there are no free slots.
+         */
+        int submit_connect(int fd, const sockaddr *address, socklen_t length, completion_handler handler);
+
+        /**
+         * @brief Sends a list of segments on a connected fixed file with a single sendmsg.
+         *
+         * @param slot The slot returned by submit_connect().
+         * @param buffers The segments, the list is copied but the data they point to must stay valid until the handler
+         * is called.
+         * @param count The number of segments.
+         * @param handler Called with the number of bytes sent, which may be less than all of them, or the negative errno.
+         */
+        void submit_send(int slot, const const_buffer *buffers, size_t count, completion_handler handler);
+
+        /**
+         * @brief Starts a multishot receive, the handler is called for every piece of data until it fails or is cancelled.
+         *
+         * The data is in a provided buffer, read it with get_buffer() in the handler, the buffer is handed back to the
+         * kernel once the handler returns. Without IORING_CQE_F_MORE in the flags the receive has ended, e.g. on -ENOBUFS
+         * when every buffer is in use, and must be started again to receive more.
+         *
+         * @param slot The slot returned by submit_connect().
+         * @param handler Called with the number of bytes received, 0 when the peer closed the connection, or the
+         * negative errno.
+         * @return An id that stops the receive when passed to cancel().
+         */
+        unsigned long long submit_receive(int slot, completion_handler handler);
+
+        /**
+         * @brief Returns the data a receive completion placed in a provided buffer.
+         *
+         * @param result The result passed to the handler.
+         * @param flags The flags passed to the handler.
+         */
+        [[nodiscard]] std::string_view get_buffer(int result, uint32_t flags) const;
+
+        /**
+         * @brief Cancels an operation, its handler is still called with -ECANCELED unless it already completed.
+         *
+         * @param id The id returned by submit_receive().
+         */
+        void cancel(unsigned long long id);
+
+        /**
+         * @brief Cancels every operation on a fixed file and frees its slot, after which the socket may be closed.
+         *
+         * @param slot The slot returned by submit_connect().
+         */
+        void release_file(int slot);
+
+        /**
+         * @brief Returns the number of io_uring_enter calls made so far.
+         */
+        [[nodiscard]] unsigned long long get_enters() const;
+#endif
+    };
+
+    /**
+     * @brief A set of event loops, each running on its own thread, to spread connections over several cores.
+     *
+     * Work is distributed by handing each new connection or client to next(), which picks the loops in turn.
+     * @code{.cpp}
+     * cnet::event_loop_group group; // one loop per core
+     * cnet::async_http_client client(group.next());
+     * @endcode
+     */
+    class event_loop_group
+    {
+    private:
+        std::vector<std::unique_ptr<event_loop>> loops;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> turn = 0;
+
+    public:
+        /**
+         * @brief Creates the loops and starts their threads.
+         *
+         * @param count The number of loops, one per hardware thread if 0.
+         * @param backend The backend of every loop.
+         */
+        explicit event_loop_group(unsigned int count = 0, loop_backend backend = loop_backend::automatic);
+
+        /**
+         * @brief Stops the loops and joins their threads.
+         */
+        ~event_loop_group();
+
+        /**
+         * @brief Returns the next loop in turn.
+         */
+        event_loop &next();
+
+        /**
+         * @brief Returns the loop at the given index.
+         */
+        event_loop &get(const size_t index) { return *loops[index]; }
+
+        /**
+         * @brief Returns the number of loops.
+         */
+        [[nodiscard]] size_t size() const { return loops.size(); }
+
+        /**
+         * @brief Stops the loops and waits for their threads to exit.
+         */
+        void stop();
+    };
+} // cnet
+
+#endif //EVENT_LOOP_H
@@ -0,0 +1,71 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef FILE_BODY_H
+#define FILE_BODY_H
+#include <string>
+
+namespace cnet
+{
+    /**
+     * @brief A request body read from a file while it is sent, instead of being loaded into memory first.
+     *
+     * Plain connections hand the file to the kernel with sendfile(), TLS connections do the same through kernel TLS
+     * when OpenSSL and the kernel support it, and otherwise read it in chunks that are encrypted as they are sent.
+     * @code{.cpp}
+     * cnet::http_message message("http://example.com/upload/artifact.zip", cnet::http_method::PUT);
+     * cnet::file_body file("artifact.zip");
+     * client.upload(message, file);
+     * @endcode
+     */
+    class file_body
+    {
+    private:
+        int fd = -1;
+        unsigned long long offset = 0;
+        unsigned long long size = 0;
+
+    public:
+        /**
+         * @brief Opens the file, the whole of it is sent.
+         *
+         * @param path The path of the file.
+         * @throws std::runtime_error If the file can't be opened.
+         */
+        explicit file_body(const std::string &path);
+
+        /**
+         * @brief Opens the file, only the given range of it is sent.
+         *
+         * @param path The path of the file.
+         * @param offset The offset of the first byte sent.
+         * @param size The number of bytes sent.
+         * @throws std::runtime_error If the file can't be opened or is shorter than the range.
+         */
+        file_body(const std::string &path, unsigned long long offset, unsigned long long size);
+
+        file_body(const file_body &) = delete;
+
+        file_body &operator=(const file_body &) = delete;
+
+        ~file_body();
+
+        /**
+         * @brief Returns the file descriptor of the open file.
+         */
+        [[nodiscard]] int get_fd() const { return fd; }
+
+        /**
+         * @brief Returns the offset of the first byte sent.
+         */
+        [[nodiscard]] unsigned long long get_offset() const { return offset; }
+
+        /**
+         * @brief Returns the number of bytes sent, the Content-Length of the request.
+         */
+        [[nodiscard]] unsigned long long get_size() const { return size; }
+    };
+} // cnet
+
+#endif //FILE_BODY_H
@@ -0,0 +1,123 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef HPACK_H
+#define HPACK_H
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define CNET_HPACK_TABLE_SIZE 4096 // bytes of dynamic table both sides start with, RFC 7541 section 4.2
+
+namespace cnet
+{
+    /**
+     * @brief A header as HTTP/2 carries it, with a lowercase name.
+     */
+    struct hpack_field
+    {
+        std::string name;
+        std::string value;
+    };
+
+    /**
+     * @brief The dynamic table an HPACK encoder and its decoder keep in step, newest entry first.
+     */
+    class hpack_table
+    {
+    private:
+        std::deque<hpack_field> entries;
+        size_t size = 0;
+        size_t max_size = CNET_HPACK_TABLE_SIZE;
+
+        void evict(size_t limit);
+
+    public:
+        /**
+         * @brief Adds an entry, evicting the oldest ones to make room. An entry larger than the table empties it.
+         */
+        void add(std::string_view name, std::string_view value);
+
+        /**
+         * @brief Changes the maximum size, evicting entries that no longer fit.
+         */
+        void resize(size_t max_size);
+
+        /**
+         * @brief Returns the entry at an index of the combined address space, 1 to 61 being the static table.
+         * @return The entry, or nullptr if the index is out of range.
+         */
+        [[nodiscard]] const hpack_field *get(size_t index) const;
+
+        /**
+         * @brief Finds the index of a header in the static table and then in this table.
+         *
+         * @param name The lowercase name of the header.
+         * @param value The value of the header.
+         * @param name_only Set to true when only the name matched.
+         * @return The index, 0 if not even the name is present.
+         */
+        [[nodiscard]] size_t find(std::string_view name, std::string_view value, bool &name_only) const;
+
+        [[nodiscard]] size_t get_max_size() const { return max_size; }
+    };
+
+    /**
+     * @brief Compresses header lists into HPACK header blocks, RFC 7541.
+     *
+     * Headers repeated across requests, e.g. the authority or user agent, are added to the dynamic table and sent as a
+     * single index afterwards. Paths and lengths, which change from one request to the next, aren't indexed so they
+     * don't push the useful entries out, and credentials are marked as never indexed so intermediaries don't either.
+     */
+    class hpack_encoder
+    {
+    private:
+        hpack_table table;
+        // the smallest size the table had since the last block and its size now, both signalled at the next block
+        size_t lowest_size = CNET_HPACK_TABLE_SIZE;
+        bool size_changed = false;
+
+    public:
+        /**
+         * @brief Applies the SETTINGS_HEADER_TABLE_SIZE of the peer, capped to CNET_HPACK_TABLE_SIZE.
+         */
+        void set_max_table_size(size_t size);
+
+        /**
+         * @brief Appends the header block of a header list.
+         *
+         * @param fields The headers, pseudo headers first, with lowercase names.
+         * @param block Receives the header block.
+         */
+        void encode(const std::vector<hpack_field> &fields, std::string &block);
+    };
+
+    /**
+     * @brief Decompresses HPACK header blocks, RFC 7541.
+     */
+    class hpack_decoder
+    {
+    private:
+        hpack_table table;
+        size_t max_table_size = CNET_HPACK_TABLE_SIZE;
+
+    public:
+        /**
+         * @brief Sets the SETTINGS_HEADER_TABLE_SIZE advertised to the peer, the most its table size updates may ask for.
+         */
+        void set_max_table_size(size_t size);
+
+        /**
+         * @brief Decodes a complete header block, the fragments of a HEADERS frame and its CONTINUATION frames joined.
+         *
+         * @param block The header block.
+         * @param fields Receives the headers in the order they were sent.
+         * @throws std::runtime_error If the block is malformed, which HTTP/2 treats as a COMPRESSION_ERROR.
+         */
+        void decode(std::string_view block, std::vector<hpack_field> &fields);
+    };
+} // cnet
+
+#endif //HPACK_H
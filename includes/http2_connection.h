@@ -0,0 +1,241 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef HTTP2_CONNECTION_H
+#define HTTP2_CONNECTION_H
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "body_sink.h"
+#include "hpack.h"
+#include "http_message.h"
+#include "resolver.h"
+#include "tcp_client.h"
+
+#define CNET_HTTP2_STREAM_WINDOW (1 << 20) // bytes a stream may receive before it is given more credit
+#define CNET_HTTP2_CONNECTION_WINDOW (16 << 20) // bytes all the streams together may receive before more credit
+#define CNET_HTTP2_FRAME_SIZE 16384 // the largest frame either side may send until the peer allows more
+#define CNET_HTTP2_MAX_HEADER_BLOCK (1 << 20) // bytes a response's header block may span across its frames
+#define CNET_HTTP2_DEFAULT_URGENCY 3 // RFC 9218, from 0 the most urgent to 7 the least
+
+namespace cnet
+{
+    /**
+     * @brief Options controlling an http2_connection.
+     */
+    struct http2_options
+    {
+        /**
+         * @brief The time in milliseconds the connection may go without any progress before its streams fail.
+         */
+        unsigned int timeout = CNET_DEFAULT_TIMEOUT;
+        /**
+         * @brief The flow control window of each stream, how much of a response the server may send ahead of it
+         * being read.
+         */
+        uint32_t stream_window = CNET_HTTP2_STREAM_WINDOW;
+        /**
+         * @brief The flow control window of the connection, shared by all of its streams.
+         */
+        uint32_t connection_window = CNET_HTTP2_CONNECTION_WINDOW;
+        /**
+         * @brief The most streams open at once, further requests wait for one to finish. The server's own
+         * SETTINGS_MAX_CONCURRENT_STREAMS applies too.
+         */
+        uint32_t max_concurrent_streams = 100;
+        /**
+         * @brief The TLS settings, h2 is always offered through ALPN in addition to any protocol listed.
+         */
+        tls_options tls;
+        /**
+         * @brief Looks up the host, the process-wide default if null.
+         */
+        std::shared_ptr<resolver> host_resolver;
+    };
+
+    /**
+     * @brief An HTTP/2 connection (RFC 9113) over TLS that runs many requests at once as streams of one connection.
+     *
+     * Requests are submitted with a handler and then run together: their frames are interleaved on the connection, so
+     * a slow response doesn't hold up the others and no request pays for a connection of its own. Header lists are
+     * compressed with HPACK, each stream and the connection are flow controlled so a large download can't starve the
+     * other streams, and request bodies are sent most urgent first, the urgency also being announced to the server
+     * with the priority header of RFC 9218.
+     * @code{.cpp}
+     * cnet::http2_connection connection = cnet::http2_connection::connect("example.com");
+     * for (cnet::http_message &message: messages)
+     * {
+     *     connection.submit(message, [](cnet::http_message &response, std::exception_ptr error)
+     *     {
+     *         if (error == nullptr) printf("%d %s\n", response.status_code, response.url.to_string().c_str());
+     *     });
+     * }
+     * connection.run();
+     * @endcode
+     * A connection is driven by the thread that calls run(), it isn't safe to share between threads.
+     */
+    class http2_connection
+    {
+    public:
+        /**
+         * @brief Called once a stream completes, with the response or the reason it failed.
+         */
+        using response_handler = std::function<void(http_message &response, std::exception_ptr error)>;
+
+    private:
+        struct stream
+        {
+            uint32_t id = 0;
+            http_message *message = nullptr;
+            body_sink *sink = nullptr;
+            response_handler handler;
+            int urgency = CNET_HTTP2_DEFAULT_URGENCY;
+            // the response is built apart from the request, whose body may still be sent while it arrives
+            http_message response;
+            size_t body_sent = 0;
+            long long send_window = 0;
+            long long receive_window = 0;
+            uint32_t unacknowledged = 0;
+            bool headers_received = false;
+            bool request_done = false;
+        };
+
+        tcp_client connection;
+        http2_options options;
+        hpack_encoder encoder;
+        hpack_decoder decoder;
+        std::map<uint32_t, std::unique_ptr<stream>> streams;
+        std::deque<std::unique_ptr<stream>> waiting;
+        uint32_t next_stream_id = 1;
+
+        // the settings of the server, which apply to what is sent to it
+        uint32_t peer_max_frame_size = CNET_HTTP2_FRAME_SIZE;
+        uint32_t peer_max_streams = UINT32_MAX;
+        uint32_t peer_stream_window = 65535;
+        long long send_window = 65535;
+        long long receive_window = 65535;
+        uint32_t unacknowledged = 0;
+
+        std::string output;
+        size_t output_sent = 0;
+        std::string input;
+        size_t input_used = 0;
+        // the header block of a HEADERS frame continued by CONTINUATION frames
+        std::string header_block;
+        uint32_t header_stream = 0;
+        bool header_end_stream = false;
+
+        bool started = false;
+        bool settings_received = false;
+        // set once the server sent GOAWAY, the streams above the last one it processes are failed
+        bool going_away = false;
+        bool closed = false;
+
+        void start();
+
+        void write_frame(uint8_t type, uint8_t flags, uint32_t stream_id, std::string_view payload);
+
+        void write_window_update(uint32_t stream_id, uint32_t increment);
+
+        void open_streams();
+
+        void send_bodies();
+
+        bool flush(io_wait &wait);
+
+        bool receive(io_wait &wait);
+
+        void process_frame(uint8_t type, uint8_t flags, uint32_t stream_id, std::string_view payload);
+
+        void process_headers(uint32_t stream_id, std::string_view block, bool end_stream);
+
+        void process_data(uint32_t stream_id, std::string_view payload, uint32_t length, bool end_stream);
+
+        void process_settings(uint8_t flags, std::string_view payload);
+
+        void complete(uint32_t stream_id);
+
+        void reset(uint32_t stream_id, uint32_t error_code, const std::string &reason);
+
+        void fail_stream(std::unique_ptr<stream> failed, std::exception_ptr error);
+
+        void fail_all(std::exception_ptr error, uint32_t error_code);
+
+    public:
+        /**
+         * @brief Takes over a TLS connection on which the server picked h2 through ALPN.
+         *
+         * @param connection The connection, past its handshake.
+         * @param options The flow control windows and timeout of the connection.
+         * @throws std::runtime_error If the server didn't pick h2.
+         */
+        explicit http2_connection(tcp_client connection, http2_options options = {});
+
+        /**
+         * @brief Connects to a host and negotiates HTTP/2.
+         *
+         * @param host The host name of the server.
+         * @param port The port of the server.
+         * @param options The options of the connection.
+         * @return The connection, on which requests for the host can be submitted.
+         * @throws std::runtime_error If the connect or handshake fails, or the server doesn't speak HTTP/2.
+         */
+        static http2_connection connect(const std::string &host, unsigned int port = 443, http2_options options = {});
+
+        /**
+         * @brief Queues a request to the host of the connection, sent as a new stream once run() is called.
+         *
+         * The message must stay valid and unchanged until its handler is called, which then receives it with the
+         * status, headers and, unless a sink was given, the body of the response in place of those of the request.
+         *
+         * @param message The request.
+         * @param handler Called once the response is complete or the stream failed.
+         * @param sink Receives the body as it arrives instead of the message.
+         * @param urgency The priority of the request from 0, the most urgent, to 7.
+         * @throws std::runtime_error If the connection is closed or going away.
+         */
+        void submit(http_message &message, response_handler handler, body_sink *sink = nullptr, int urgency = CNET_HTTP2_DEFAULT_URGENCY);
+
+        /**
+         * @brief Runs the connection until every submitted request has completed or failed.
+         *
+         * A failure of the whole connection, e.g. the server going away, is handed to the handler of each stream it
+         * affects rather than thrown.
+         */
+        void run();
+
+        /**
+         * @brief Sends a single request and waits for its response.
+         *
+         * @param message The request to send, and the message that receives the response.
+         * @param sink Receives the body as it arrives instead of the message.
+         * @throws std::runtime_error If the stream or the connection fails.
+         */
+        void make_request(http_message &message, body_sink *sink = nullptr);
+
+        /**
+         * @brief Tells the server no further stream will be opened and closes the connection, like a tcp_client it
+         * isn't closed on destruction.
+         */
+        void close();
+
+        /**
+         * @brief Returns whether new requests can be submitted, false once closed or once the server sent GOAWAY.
+         */
+        [[nodiscard]] bool is_open() const { return !closed && !going_away; }
+
+        /**
+         * @brief Returns the number of requests submitted that haven't completed yet.
+         */
+        [[nodiscard]] size_t get_active_streams() const { return streams.size() + waiting.size(); }
+    };
+} // cnet
+
+#endif //HTTP2_CONNECTION_H
@@ -0,0 +1,297 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "http_headers.h"
+#include "http_message.h"
+
+#define CNET_CACHE_MAX_SIZE (64 << 20) // bytes of responses an http_cache keeps in memory
+#define CNET_CACHE_MAX_ENTRY_SIZE (8 << 20) // bytes, the largest response body an http_cache stores
+#define CNET_CACHE_HEURISTIC_FRACTION 10 // a response with only Last-Modified stays fresh for 1/10 of its age, RFC 9111 section 4.2.2
+
+namespace cnet
+{
+    /**
+     * @brief Limits and storage of an http_cache.
+     */
+    struct http_cache_options
+    {
+        /**
+         * @brief The most bytes of responses kept in memory, the least recently used are evicted beyond it.
+         */
+        size_t max_size = CNET_CACHE_MAX_SIZE;
+        /**
+         * @brief The largest response body stored, larger responses are passed through without being stored.
+         */
+        size_t max_entry_size = CNET_CACHE_MAX_ENTRY_SIZE;
+        /**
+         * @brief A directory responses are also written to, so they outlive the process, none if empty.
+         *
+         * A response missing from memory is looked up there. Files are replaced when a response is stored again and
+         * removed when it is invalidated, they aren't evicted.
+         */
+        std::string directory;
+        /**
+         * @brief Whether a response with a Last-Modified date but no explicit lifetime is fresh for a fraction of its age.
+         */
+        bool heuristic_freshness = true;
+    };
+
+    /**
+     * @brief Counters describing how an http_cache has been used.
+     */
+    struct http_cache_stats
+    {
+        /**
+         * @brief The number of requests answered from a fresh stored response, without any network round trip.
+         */
+        unsigned long long hits = 0;
+        /**
+         * @brief The number of requests answered from a stored response after the server confirmed it with a 304.
+         */
+        unsigned long long revalidations = 0;
+        /**
+         * @brief The number of requests without a usable stored response.
+         */
+        unsigned long long misses = 0;
+        /**
+         * @brief The number of responses stored.
+         */
+        unsigned long long stores = 0;
+        /**
+         * @brief The number of responses dropped from memory to stay within max_size.
+         */
+        unsigned long long evictions = 0;
+    };
+
+    /**
+     * @brief A response stored by an http_cache, along with what is needed to tell whether it is still fresh.
+     */
+    struct http_cache_entry
+    {
+        /**
+         * @brief The key of the response, its URL without the fragment.
+         */
+        std::string key;
+        int status_code = 0;
+        http_headers headers;
+        std::string body;
+        /**
+         * @brief The request headers named by Vary and their values when the response was stored, nullopt if absent.
+         */
+        std::vector<std::pair<std::string, std::optional<std::string>>> vary;
+        /**
+         * @brief When the request was sent and the response received, in seconds since the epoch.
+         */
+        long long request_time = 0;
+        long long response_time = 0;
+        /**
+         * @brief The age of the response when it was received and how long it is fresh for, in seconds, RFC 9111 section 4.2.
+         */
+        long long initial_age = 0;
+        long long lifetime = 0;
+        bool no_cache = false;
+        bool must_revalidate = false;
+
+        /**
+         * @brief Returns the age of the response at the given time, in seconds.
+         */
+        [[nodiscard]] long long get_age(const long long now) const { return initial_age + std::max(0LL, now - response_time); }
+
+        /**
+         * @brief Returns whether the response has an ETag or Last-Modified it can be revalidated with.
+         */
+        [[nodiscard]] bool has_validator() const;
+
+        /**
+         * @brief Returns the number of bytes the entry takes up, as counted against max_size.
+         */
+        [[nodiscard]] size_t get_size() const;
+    };
+
+    /**
+     * @brief A private HTTP cache following RFC 9111, which answers repeated GET requests from stored responses.
+     *
+     * A stored response is used as long as it is fresh according to its Cache-Control max-age, its Expires date or,
+     * failing both, heuristically from its Last-Modified date. A stale response with an ETag or Last-Modified is
+     * revalidated with If-None-Match or If-Modified-Since, and a 304 answer is turned into a hit. The Cache-Control
+     * directives of the request, e.g. no-cache or max-age=0, are honored too.
+     *
+     * The cache is safe to share between several http_client objects and threads.
+     * @code{.cpp}
+     * cnet::http_client_options options;
+     * options.cache = std::make_shared<cnet::http_cache>();
+     * cnet::http_client client(options);
+     * @endcode
+     */
+    class http_cache
+    {
+    private:
+        using entry_list = std::list<std::shared_ptr<const http_cache_entry>>;
+
+        http_cache_options options;
+        entry_list entries; // the most recently used first
+        std::unordered_map<std::string, entry_list::iterator> index;
+        size_t size = 0;
+        std::mutex mutex;
+
+        std::atomic<unsigned long long> hits = 0;
+        std::atomic<unsigned long long> revalidations = 0;
+        std::atomic<unsigned long long> misses = 0;
+        std::atomic<unsigned long long> stores = 0;
+        std::atomic<unsigned long long> evictions = 0;
+
+        [[nodiscard]] std::string get_path(std::string_view key) const;
+        [[nodiscard]] std::shared_ptr<const http_cache_entry> read_file(const std::string &key) const;
+        void write_file(const http_cache_entry &entry) const;
+
+        /**
+         * @brief Computes the age and lifetime of an entry from its headers and times.
+         */
+        void prepare(http_cache_entry &entry) const;
+
+        /**
+         * @brief Puts an entry in memory, replacing any with the same key, and evicts down to max_size.
+         */
+        void insert(std::shared_ptr<const http_cache_entry> entry);
+
+    public:
+        /**
+         * @brief Constructs an empty cache with the given limits.
+         *
+         * @param options The limits and the optional directory of the cache.
+         */
+        explicit http_cache(http_cache_options options = {});
+
+        http_cache(const http_cache &) = delete;
+        http_cache &operator=(const http_cache &) = delete;
+
+        /**
+         * @brief Returns the current time in seconds since the epoch, the clock every entry is measured with.
+         */
+        static long long now();
+
+        /**
+         * @brief Builds the key a response to the URL is stored under, the URL without its fragment.
+         */
+        static std::string make_key(const uri &url);
+
+        /**
+         * @brief Parses an HTTP-date in any of the formats of RFC 9110 section 5.6.7.
+         *
+         * @param text The date, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+         * @return The time in seconds since the epoch, or nullopt if the date is malformed.
+         */
+        static std::optional<long long> parse_http_date(std::string_view text);
+
+        /**
+         * @brief Returns whether the request may be answered from the cache and its response stored.
+         *
+         * That is a GET without Cache-Control: no-store and without conditional or range headers of its own.
+         */
+        static bool is_cacheable(const http_message &request);
+
+        /**
+         * @brief Returns whether a response to a cacheable request may be stored, RFC 9111 section 3.
+         */
+        static bool is_storable(const http_message &response);
+
+        /**
+         * @brief Finds the stored response for a request.
+         *
+         * A stale response is only returned if it can be revalidated.
+         *
+         * @param request The request, its Cache-Control and the headers named by Vary are taken into account.
+         * @param fresh Set to whether the response can be used without asking the server.
+         * @return The response, or null if there is none usable.
+         */
+        std::shared_ptr<const http_cache_entry> lookup(const http_message &request, bool &fresh);
+
+        /**
+         * @brief Adds If-None-Match and If-Modified-Since headers to a request so the server can confirm a stale response.
+         *
+         * @param entry The stale response.
+         * @param request The request to revalidate it with.
+         */
+        static void add_validators(const http_cache_entry &entry, http_message &request);
+
+        /**
+         * @brief Removes the headers added by add_validators().
+         */
+        static void remove_validators(http_message &request);
+
+        /**
+         * @brief Stores a response, if it is storable.
+         *
+         * @param url The URL of the request.
+         * @param request_headers The headers of the request, for those named by Vary.
+         * @param response The status and headers of the response.
+         * @param body The body of the response.
+         * @param request_time When the request was sent, from now().
+         * @param response_time When the response was received, from now().
+         * @return True if the response was stored.
+         */
+        bool store(const uri &url, const http_headers &request_headers, const http_message &response, std::string_view body,
+                   long long request_time, long long response_time);
+
+        /**
+         * @brief Updates a stored response with the headers of the 304 that confirmed it, RFC 9111 section 4.3.4.
+         *
+         * @param entry The stored response.
+         * @param not_modified The 304 response.
+         * @param request_time When the revalidation request was sent.
+         * @param response_time When the 304 was received.
+         * @return The updated response, also stored in place of the previous one.
+         */
+        std::shared_ptr<const http_cache_entry> update(const http_cache_entry &entry, const http_message &not_modified,
+                                                       long long request_time, long long response_time);
+
+        /**
+         * @brief Copies a stored response into a message, with an Age header.
+         *
+         * @param entry The stored response.
+         * @param response The message that receives the status, headers and body.
+         * @param with_body Whether the body is copied, a caller streaming it elsewhere may leave it out.
+         */
+        static void copy(const http_cache_entry &entry, http_message &response, bool with_body = true);
+
+        /**
+         * @brief Drops the response stored for a URL, e.g. once an unsafe request has changed it, RFC 9111 section 4.4.
+         */
+        void invalidate(const uri &url);
+
+        /**
+         * @brief Drops every response kept in memory, files in the directory are left alone.
+         */
+        void clear();
+
+        /**
+         * @brief Returns the usage counters of the cache.
+         *
+         * @return A snapshot of the counters.
+         */
+        [[nodiscard]] http_cache_stats get_stats() const;
+
+        /**
+         * @brief Returns the limits of the cache.
+         *
+         * @return The options the cache was constructed with.
+         */
+        [[nodiscard]] const http_cache_options &get_options() const { return options; }
+    };
+} // cnet
+
+#endif //HTTP_CACHE_H
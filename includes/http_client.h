@@ -5,25 +5,315 @@
 #ifndef HTTP_CLIENT_H
 #define HTTP_CLIENT_H
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "body_sink.h"
+#include "connection_pool.h"
+#include "content_decoder.h"
+#include "file_body.h"
+#include "http2_connection.h"
+#include "http_cache.h"
 #include "http_message.h"
+#include "http_response_parser.h"
+#include "request_coalescer.h"
+#include "resolver.h"
 #include "tcp_client.h"
 
+#define CNET_PIPELINE_DEPTH 8 // requests make_requests() sends ahead of their responses on one connection
+
 
 namespace cnet
 {
+    /**
+     * @brief Whether a HEAD request is sent ahead of each request.
+     */
+    enum class preflight_mode
+    {
+        /**
+         * @brief Send the request directly, failures surface from the request itself.
+         */
+        none,
+        /**
+         * @brief Send a HEAD request first and keep its response, e.g. to learn the size of a download before fetching it.
+         */
+        probe,
+    };
+
+    /**
+     * @brief Options controlling how an http_client makes its requests.
+     */
+    struct http_client_options
+    {
+        /**
+         * @brief The pool keep-alive connections are taken from and returned to.
+         *
+         * When this is null every request opens its own connection and closes it afterwards.
+         */
+        std::shared_ptr<connection_pool> pool;
+        /**
+         * @brief The timeout in milliseconds for connecting and for each send or receive.
+         */
+        unsigned int timeout = CNET_DEFAULT_TIMEOUT;
+        /**
+         * @brief Whether each request is preceded by a HEAD probe, none by default since the probe costs a round trip.
+         */
+        preflight_mode preflight = preflight_mode::none;
+        /**
+         * @brief Looks up the hosts connected to without a pool, the process-wide default if null. A pool uses its own.
+         */
+        std::shared_ptr<resolver> host_resolver;
+        /**
+         * @brief Whether HTTPS requests made without a pool offer HTTP/2 through ALPN.
+         *
+         * When the server picks h2 the connection is kept open, and the requests to the host that follow are sent as
+         * streams on it, a batch of make_requests() all at once. File uploads and preflight probes always use HTTP/1.1.
+         */
+        bool http2 = false;
+        /**
+         * @brief The most requests make_requests() sends on a connection ahead of their responses, 1 sends each only
+         * once the previous response arrived.
+         */
+        size_t pipeline_depth = CNET_PIPELINE_DEPTH;
+        /**
+         * @brief Whether the registered content codings are sent in Accept-Encoding and responses using them are decoded
+         * as they arrive. A decoded response has neither Content-Encoding nor Content-Length, its content length being
+         * the decoded size.
+         */
+        bool decode_content = true;
+        /**
+         * @brief The cache GET responses are answered from and stored in, none if null.
+         *
+         * A fresh stored response is returned without a round trip, a stale one is revalidated and a 304 is turned into
+         * the stored response. Successful unsafe requests, e.g. a PUT, drop what is stored for their URL.
+         */
+        std::shared_ptr<http_cache> cache;
+        /**
+         * @brief Coalesces identical GET and HEAD requests made at the same time into one upstream request, none if null.
+         *
+         * Share it between the clients of several threads so they share responses. Requests whose body is streamed to a
+         * sink or callback, and the pipelined requests of make_requests(), are sent on their own.
+         */
+        std::shared_ptr<request_coalescer> coalescer;
+    };
+
     class http_client
     {
+        // shares the request validation and serialization
+        friend class async_http_client;
+
     private:
+        http_client_options options;
         tcp_client tcp;
         http_message message;
+        // receives each response before it is handed to the caller's message, its memory is reused across requests
+        http_message received;
+        http_message last_probe;
+        http_response_parser parser;
+        // the HTTP/2 connection to each host, keyed like the pool, kept open for the requests that follow
+        std::map<std::string, std::shared_ptr<http2_connection>> http2_connections;
+
+        /**
+         * @brief What a request answered through the cache needs once its response arrives.
+         */
+        struct cache_state
+        {
+            std::shared_ptr<const http_cache_entry> stored; // the stale response being revalidated, if any
+            http_headers request_headers; // the headers as the caller set them, for those named by Vary
+            long long request_time = 0;
+        };
 
         bool preflight_check();
-        void parse_headers(std::string body);
 
-        static std::string build_http_query(http_message &message);
+        /**
+         * @brief Checks locally that the message can be sent, without any network round trip.
+         *
+         * @throws std::runtime_error If the host is empty or the scheme isn't http or https.
+         */
+        static void validate(http_message &message);
+
+        /**
+         * @brief Reads one complete response from the connection.
+         *
+         * The response is received straight into the parser's buffer and parsed as it arrives. The body is framed by
+         * the Content-Length or chunked Transfer-Encoding of the response, or read until the peer closes the
+         * connection when neither is present.
+         *
+         * @param connection The connection to read from.
+         * @param response The message that receives the status, headers and body.
+         * @param head Whether the response answers a HEAD request and so has no body.
+         * @param sink Receives the body as it arrives, if null the body is stored in the response instead.
+         * @param pipelined Whether bytes received past the previous response on the connection start this one.
+         * @return True if the connection can be reused for another request, false otherwise.
+         */
+        bool read_response(tcp_client &connection, http_message &response, bool head, body_sink *sink = nullptr, bool pipelined = false);
+
+        /**
+         * @brief Joins an identical request in flight if there is a coalescer, otherwise answers the request with fetch().
+         */
+        void perform(http_message &message, body_sink *sink, const file_body *file = nullptr);
+
+        /**
+         * @brief Answers the request from the cache if there is one, otherwise sends it with exchange().
+         */
+        void fetch(http_message &message, body_sink *sink, const file_body *file);
+
+        /**
+         * @brief Sends the request and reads the response, streaming the body to the sink if there is one.
+         */
+        void exchange(http_message &message, body_sink *sink, const file_body *file);
+
+        /**
+         * @brief Answers a cacheable request from a fresh stored response, or adds the validators of a stale one to it.
+         *
+         * @return True if the request was answered, false if it still has to be sent.
+         */
+        bool use_cache(http_message &message, body_sink *sink, cache_state &state);
+
+        /**
+         * @brief Stores the response to a cacheable request, or completes a 304 from the response being revalidated.
+         *
+         * @param body The body of the response, the message's own unless it was streamed to a sink.
+         * @param complete Whether the body is complete, false if it was too large to be kept.
+         */
+        void update_cache(http_message &message, body_sink *sink, cache_state &state, std::string_view body, bool complete);
+
+        /**
+         * @brief Pipelines requests to one host, replaying those left unanswered when a connection closes.
+         */
+        void pipeline(const std::vector<http_message *> &batch);
+
+        /**
+         * @brief Opens a connection to the host of the current message, taking it from the pool if there is one.
+         *
+         * @param reused Set to whether the connection was taken from the pool.
+         * @param offer_http2 Whether h2 is offered ahead of http/1.1 in the TLS handshake of a new connection.
+         */
+        void open_connection(bool &reused, bool offer_http2 = false);
+
+        /**
+         * @brief Returns the HTTP/2 connection to the host of the current message, offering h2 on a new connection if
+         * none is open.
+         *
+         * @param reused Set to whether the connection was kept open from an earlier request.
+         * @return The connection, or null if the server picked HTTP/1.1, in which case the new connection is in tcp.
+         */
+        std::shared_ptr<http2_connection> open_http2(bool &reused);
+
+        /**
+         * @brief Hands the current connection back to the pool, or closes it if there is no pool.
+         */
+        void release_connection(bool reusable);
 
     public:
+        http_client() = default;
+
+        /**
+         * @brief Constructs an http client with the given options.
+         *
+         * @param options The options to use for every request.
+         */
+        explicit http_client(http_client_options options): options(std::move(options)) {};
+
+        /**
+         * @brief Sends the request described by the message and stores the response in it.
+         *
+         * The status code, headers and body of the message are replaced by those of the response.
+         *
+         * @param message The request to send, and the message that receives the response.
+         * @throws std::runtime_error If the connection fails or the response is malformed.
+         */
         void make_request(http_message &message);
+
+        /**
+         * @brief Sends the request described by the message and streams the response body to a sink.
+         *
+         * The status code and headers of the message are replaced by those of the response, while the body is handed
+         * to the sink piece by piece as it arrives, so memory use stays bounded however large the body is.
+         * @code{.cpp}
+         * cnet::file_sink file("artifact.zip");
+         * client.make_request(message, file);
+         * @endcode
+         *
+         * @param message The request to send, and the message that receives the status and headers.
+         * @param sink Receives the body.
+         * @throws std::runtime_error If the connection fails, the response is malformed or the sink fails.
+         */
+        void make_request(http_message &message, body_sink &sink);
+
+        /**
+         * @brief Sends the request described by the message and hands each piece of the response body to a callback.
+         *
+         * @param message The request to send, and the message that receives the status and headers.
+         * @param callback Called with each piece of the body, the view is only valid during the call.
+         * @throws std::runtime_error If the connection fails or the response is malformed.
+         */
+        void make_request(http_message &message, const std::function<void(std::string_view)> &callback);
+
+        /**
+         * @brief Sends the request with a file as its body, streamed from disk instead of loaded into memory.
+         *
+         * The body of the message is ignored, the Content-Length is the size of the file unless the message sets one.
+         * The status code, headers and body of the message are replaced by those of the response.
+         * @code{.cpp}
+         * cnet::http_message message("http://example.com/upload/artifact.zip", cnet::http_method::PUT);
+         * cnet::file_body file("artifact.zip");
+         * client.upload(message, file);
+         * @endcode
+         *
+         * @param message The request to send, and the message that receives the response.
+         * @param file The body of the request, which is sent from its offset again if the request is retried.
+         * @throws std::runtime_error If the request fails or the file can't be read.
+         */
+        void upload(http_message &message, const file_body &file);
+
+        /**
+         * @brief Sends a batch of requests, pipelining the GET and HEAD requests to each host on keep-alive connections.
+         *
+         * Up to pipeline_depth requests are written to a connection before the first response is read, so a batch of
+         * small objects costs about one round trip per pipeline_depth requests instead of one each. The responses are
+         * matched to the requests in order. When the server closes the connection part way through, e.g. once it
+         * served its maximum number of requests, the unanswered requests are sent again on a new connection, one at a
+         * time if the server didn't answer any of them. Over HTTP/2 the requests to a host are all sent at once as streams of
+         * its connection instead. Other requests, e.g. a POST, are sent on their own, and the requests on either side of
+         * them aren't reordered across them.
+         * @code{.cpp}
+         * std::vector<cnet::http_message> messages;
+         * for (const std::string &name: names) messages.emplace_back("http://example.com/objects/" + name, cnet::http_method::GET);
+         * client.make_requests(messages);
+         * @endcode
+         *
+         * @param messages The requests to send, each receiving its response.
+         * @throws std::runtime_error If a request fails, the messages answered before it keep their responses.
+         */
+        void make_requests(std::vector<http_message> &messages);
+
+        /**
+         * @brief Sends a HEAD request for the message and returns the response, leaving the message untouched.
+         *
+         * This is useful to learn the Content-Length, Accept-Ranges or ETag of a resource before downloading it.
+         *
+         * @param message The request to probe.
+         * @return The response to the HEAD request.
+         * @throws std::runtime_error If the connection fails or the response is malformed.
+         */
+        http_message probe(const http_message &message);
+
+        /**
+         * @brief Returns the response to the last HEAD probe sent in preflight_mode::probe.
+         *
+         * @return The response, empty if no probe has been sent.
+         */
+        [[nodiscard]] const http_message &get_last_probe() const { return last_probe; }
+
+        /**
+         * @brief Returns the options of this client.
+         *
+         * @return The options, including the connection pool and its counters.
+         */
+        [[nodiscard]] const http_client_options &get_options() const { return options; }
     };
 } // cnet
 
@@ -0,0 +1,172 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef HTTP_HEADERS_H
+#define HTTP_HEADERS_H
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#define CNET_HEADER_BLOCK_SIZE 1024 // bytes of the first block the header names and values are stored in
+
+namespace cnet
+{
+    /**
+     * @brief The headers the library itself reads or writes, which an http_headers finds without searching.
+     */
+    enum class known_header : uint8_t
+    {
+        accept_encoding,
+        accept_ranges,
+        age,
+        authorization,
+        cache_control,
+        connection,
+        content_encoding,
+        content_length,
+        content_range,
+        content_type,
+        date,
+        etag,
+        expires,
+        host,
+        if_modified_since,
+        if_none_match,
+        if_range,
+        last_modified,
+        location,
+        pragma,
+        priority,
+        range,
+        transfer_encoding,
+        vary,
+        /**
+         * @brief Any other header.
+         */
+        other,
+    };
+
+    /**
+     * @brief A header as stored in an http_headers, both views pointing into the storage of the container.
+     */
+    struct http_header
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    /**
+     * @brief The headers of an http message, in the order they were added, with case-insensitive names.
+     *
+     * The names and values are copied into blocks of memory the container owns and only grows, so adding a header
+     * doesn't allocate once the blocks are large enough, and clear() keeps them for the next message. The known headers
+     * are indexed, finding one is a single lookup instead of a search.
+     * @code{.cpp}
+     * message.headers.set("Accept", "application/json");
+     * if (const auto type = response.headers.get(cnet::known_header::content_type)) printf("%.*s\n", (int) type->size(), type->data());
+     * for (const auto &[name, value]: response.headers) { ... }
+     * @endcode
+     * The views handed out are valid until the header is removed or replaced, or the container is cleared, assigned to
+     * or destroyed. Moving the container keeps them valid.
+     */
+    class http_headers
+    {
+    private:
+        struct block
+        {
+            std::unique_ptr<char[]> data;
+            size_t size = 0;
+            size_t used = 0;
+        };
+
+        std::vector<block> blocks;
+        size_t current = 0;
+        std::vector<http_header> entries;
+        // one more than the position of the first header of each known kind, 0 when absent
+        std::array<uint32_t, static_cast<size_t>(known_header::other)> known{};
+
+        std::string_view store(std::string_view text);
+
+        void index();
+
+    public:
+        using const_iterator = std::vector<http_header>::const_iterator;
+
+        http_headers() = default;
+
+        http_headers(const http_headers &other);
+
+        http_headers(http_headers &&other) noexcept;
+
+        http_headers &operator=(const http_headers &other);
+
+        http_headers &operator=(http_headers &&other) noexcept;
+
+        ~http_headers() = default;
+
+        /**
+         * @brief Returns which known header a name is, ignoring case.
+         */
+        static known_header classify(std::string_view name);
+
+        /**
+         * @brief Compares two header names, ignoring case.
+         */
+        static bool equals_ignore_case(std::string_view a, std::string_view b);
+
+        /**
+         * @brief Adds a header, after any with the same name.
+         */
+        void add(std::string_view name, std::string_view value);
+
+        /**
+         * @brief Sets a header, replacing every header with the same name.
+         */
+        void set(std::string_view name, std::string_view value);
+
+        /**
+         * @brief Removes every header with a name.
+         *
+         * @return Whether any was removed.
+         */
+        bool remove(std::string_view name);
+
+        /**
+         * @brief Returns the value of the first header with a name.
+         *
+         * @return The value, or nothing if the header is absent.
+         */
+        [[nodiscard]] std::optional<std::string_view> get(std::string_view name) const;
+
+        /**
+         * @brief Returns the value of the first header of a known kind.
+         *
+         * @return The value, or nothing if the header is absent or kind is known_header::other.
+         */
+        [[nodiscard]] std::optional<std::string_view> get(known_header kind) const;
+
+        /**
+         * @brief Returns whether a header is present.
+         */
+        [[nodiscard]] bool contains(const std::string_view name) const { return get(name).has_value(); }
+
+        /**
+         * @brief Removes every header, keeping the memory for the next ones.
+         */
+        void clear();
+
+        [[nodiscard]] size_t size() const { return entries.size(); }
+
+        [[nodiscard]] bool empty() const { return entries.empty(); }
+
+        [[nodiscard]] const_iterator begin() const { return entries.begin(); }
+
+        [[nodiscard]] const_iterator end() const { return entries.end(); }
+    };
+} // cnet
+
+#endif //HTTP_HEADERS_H
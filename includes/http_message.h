@@ -4,9 +4,11 @@
 
 #ifndef HTTP_RESPONSE_H
 #define HTTP_RESPONSE_H
-#include <map>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
+#include "http_headers.h"
 #include "http_method.h"
 #include "uri.h"
 
@@ -57,17 +59,6 @@ namespace cnet
          * @see http_message.h
          */
         std::string body;
-        /**
-         * @brief The Content-Type of an HTTP message.
-         *
-         * This variable stores the Content-Type of an HTTP message. The Content-Type
-         * specifies the media type of the data transmitted in the message body.
-
-         * The Content-Type is a string representation of the media type in the format
-         * `type/subtype`. Examples of Content-Type values include "text/plain",
-         * "application/json", "image/jpeg", etc.
-         */
-        std::string content_type;
         /**
          * @brief The length of the content in bytes.
          *
@@ -80,6 +71,8 @@ namespace cnet
          * @endcode
          *
          * The content_length variable is used to store the size of a file or the size of data being transferred over a network. It can be assigned a value using an assignment statement, just like any other variable. The value should be specified in bytes as an unsigned long long integer.
+         *
+         * For a response it is parsed from the Content-Length header, or is the size of the body received when there is none.
          */
         unsigned long long content_length = 0;
         /**
@@ -94,11 +87,11 @@ namespace cnet
         std::string accept;
 
         /**
-         * @brief A map to store HTTP headers.
+         * @brief The headers of the HTTP message.
          *
-         * This map is used to store the headers of an HTTP message. It uses string keys and string values.
+         * They are stored flat in memory the message owns, with the headers the library uses indexed, see http_headers.
          */
-        std::map<std::string, std::string> headers;
+        http_headers headers;
         /**
          * @brief The HTTP status code of a response.
          *
@@ -107,6 +100,53 @@ namespace cnet
          * encountered an error, or requires further action.
          */
         int status_code = 0;
+        /**
+         * @brief Finds a header by name, ignoring case as HTTP header names are case-insensitive.
+         *
+         * @param name The name of the header.
+         * @return The value of the first header with the name, or nothing if the header is absent.
+         */
+        [[nodiscard]] std::optional<std::string_view> find_header(const std::string_view name) const { return headers.get(name); };
+        /**
+         * @brief Returns the Content-Type of the message, the media type of its body, e.g. "application/json".
+         *
+         * @return The value of the Content-Type header, empty if there is none.
+         */
+        [[nodiscard]] std::string_view get_content_type() const { return headers.get(known_header::content_type).value_or(std::string_view()); };
+        /**
+         * @brief Prepares the message to be sent again, or to receive another response, keeping the memory of its
+         * headers and body.
+         *
+         * The headers, body, status code and content length are cleared, the url and method are kept.
+         */
+        void reset()
+        {
+            headers.clear();
+            body.clear();
+            status_code = 0;
+            content_length = 0;
+        };
+        /**
+         * @brief Prepares the message for a new request, keeping the memory of its headers and body.
+         *
+         * This lets a hot path reuse one message for many requests instead of constructing each.
+         * @code{.cpp}
+         * for (const std::string &url: urls)
+         * {
+         *     message.reset(cnet::uri(url), cnet::http_method::GET);
+         *     client.make_request(message);
+         * }
+         * @endcode
+         *
+         * @param url The URL of the next request.
+         * @param method The HTTP method of the next request.
+         */
+        void reset(uri url, const http_method method)
+        {
+            reset();
+            this->url = std::move(url);
+            this->method = method;
+        };
         /**
          * @brief Checks if the HTTP status code indicates a successful response.
          *
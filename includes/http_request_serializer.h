@@ -0,0 +1,104 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef HTTP_REQUEST_SERIALIZER_H
+#define HTTP_REQUEST_SERIALIZER_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include "const_buffer.h"
+#include "file_body.h"
+#include "http_message.h"
+
+namespace cnet
+{
+    /**
+     * @brief Lays out an http request as the segments of a scatter-gather write, without copying it into one string.
+     *
+     * The header names and values and the body are referenced where the message stores them, only the request line,
+     * the Host and Content-Length headers are formatted into a small buffer of their own. The message must outlive the
+     * serializer and stay unchanged while it is sent. As the segments point into the serializer it can't be copied.
+     * @code{.cpp}
+     * cnet::http_request_serializer request(message);
+     * connection.send(request.data(), request.count()); // one writev, or one SSL_write_ex for a small request
+     * @endcode
+     */
+    class http_request_serializer
+    {
+    private:
+        // the bytes the message doesn't store as they are sent
+        std::string formatted;
+        // every segment of the request, and the ones left to send with the first of them trimmed as it is sent
+        std::vector<const_buffer> layout;
+        std::vector<const_buffer> segments;
+        size_t first = 0;
+        size_t remaining = 0;
+
+    public:
+        http_request_serializer() = default;
+
+        /**
+         * @brief Lays out the request.
+         *
+         * @param message The request to send.
+         * @param close_connection Whether to add a Connection: close header.
+         * @param file A file sent after the head in place of the message body, only its Content-Length is laid out.
+         * @param accept_encoding Sent as the Accept-Encoding header unless empty or the message has its own.
+         */
+        explicit http_request_serializer(const http_message &message, bool close_connection = false, const file_body *file = nullptr, std::string_view accept_encoding = {});
+
+        http_request_serializer(const http_request_serializer &) = delete;
+
+        http_request_serializer &operator=(const http_request_serializer &) = delete;
+
+        /**
+         * @brief Lays out another request, replacing the current one.
+         *
+         * @param message The request to send.
+         * @param close_connection Whether to add a Connection: close header.
+         * @param file A file sent after the head in place of the message body, only its Content-Length is laid out.
+         * @param accept_encoding Sent as the Accept-Encoding header unless empty or the message has its own.
+         */
+        void reset(const http_message &message, bool close_connection = false, const file_body *file = nullptr, std::string_view accept_encoding = {});
+
+        /**
+         * @brief Returns the first segment that hasn't been sent yet.
+         */
+        [[nodiscard]] const const_buffer *data() const { return segments.data() + first; }
+
+        /**
+         * @brief Returns the number of segments that haven't been sent yet.
+         */
+        [[nodiscard]] size_t count() const { return segments.size() - first; }
+
+        /**
+         * @brief Returns the number of bytes that haven't been sent yet.
+         */
+        [[nodiscard]] size_t size() const { return remaining; }
+
+        /**
+         * @brief Returns whether the whole request has been sent.
+         */
+        [[nodiscard]] bool empty() const { return remaining == 0; }
+
+        /**
+         * @brief Marks bytes as sent, advancing data() past them.
+         *
+         * @param bytes The number of bytes sent, at most size().
+         */
+        void consume(size_t bytes);
+
+        /**
+         * @brief Marks the whole request as unsent again, e.g. to send it again on a new connection.
+         */
+        void rewind();
+
+        /**
+         * @brief Returns the unsent part of the request as one string, which copies it.
+         */
+        [[nodiscard]] std::string to_string() const;
+    };
+} // cnet
+
+#endif //HTTP_REQUEST_SERIALIZER_H
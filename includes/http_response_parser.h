@@ -0,0 +1,284 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef HTTP_RESPONSE_PARSER_H
+#define HTTP_RESPONSE_PARSER_H
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "http_message.h"
+#include "io_buffer.h"
+
+#define CNET_MAX_HEADER_SIZE 65536 // bytes, the largest status line and header block, or trailer section, accepted
+#define CNET_MAX_CHUNK_LINE_SIZE 4096 // bytes, the longest chunk size line accepted, extensions included
+
+namespace cnet
+{
+    /**
+     * @brief A resumable HTTP/1.1 response parser that works in place on its receive buffer.
+     *
+     * Bytes are read straight into the buffer with prepare() and commit(), and only the newly arrived bytes are parsed.
+     * The status line, header fields and body data are exposed as std::string_view into the buffer, so parsing a
+     * response doesn't allocate once the buffer and header table have grown to fit; both are kept across reset().
+     * The receive buffer is taken from a buffer_pool and goes back to it with the parser, so short-lived parsers reuse
+     * buffers warmed up by earlier requests. A header block larger than a pooled buffer moves to a buffer of its own.
+     * @code{.cpp}
+     * cnet::http_response_parser parser;
+     * while (!parser.is_complete())
+     * {
+     *     char *space = parser.prepare(4096);
+     *     const size_t read = connection.receive(space, parser.available());
+     *     if (read == 0) parser.finish();
+     *     else parser.commit(read);
+     *     for (std::string_view chunk; parser.next_body(chunk);) body.append(chunk);
+     * }
+     * @endcode
+     */
+    class http_response_parser
+    {
+    public:
+        /**
+         * @brief How the end of the body is found.
+         */
+        enum class body_framing
+        {
+            none,
+            content_length,
+            chunked,
+            until_close,
+        };
+
+        /**
+         * @brief A header field of the response, both views point into the receive buffer.
+         */
+        struct header_field
+        {
+            std::string_view name;
+            std::string_view value;
+        };
+
+    private:
+        enum class state
+        {
+            status_line,
+            header_line,
+            body_fixed,
+            chunk_size,
+            chunk_data,
+            chunk_data_end,
+            trailer_line,
+            body_until_close,
+            complete,
+        };
+
+        struct span
+        {
+            size_t offset;
+            size_t length;
+        };
+
+        struct header_span
+        {
+            span name;
+            span value;
+        };
+
+        buffer_pool *pool;
+        io_buffer buffer;
+        size_t filled = 0; // bytes of the buffer holding received data
+        size_t parsed = 0; // bytes of the buffer consumed by the parser
+        size_t scanned = 0; // bytes already searched for the end of the current line
+        size_t header_start = 0; // offset of the status line of the final response
+        size_t header_end = 0; // offset of the first byte after the header block, body data is compacted down to it
+
+        state current = state::status_line;
+        body_framing framing = body_framing::none;
+        bool head = false;
+        int status = 0;
+        int minor_version = 1;
+        span reason_span{};
+        std::vector<header_span> header_spans;
+        unsigned long long remaining = 0; // bytes left in the body or the current chunk
+        size_t trailer_size = 0; // bytes of the trailer section parsed so far
+        std::vector<span> body_spans;
+        size_t next_span = 0;
+
+        static std::string_view trim(std::string_view value);
+        static unsigned long long parse_content_length(std::string_view value);
+        [[nodiscard]] std::string_view view(const span &s) const { return {buffer.data() + s.offset, s.length}; }
+        [[nodiscard]] bool next_line(size_t &line_end);
+        void parse_status_line(size_t line_end);
+        void parse_header_line(size_t line_end);
+        void finish_headers();
+        void take_body(state next);
+        void parse();
+        void grow(size_t size);
+
+    public:
+        /**
+         * @brief Creates a parser that takes its receive buffer from a pool.
+         *
+         * @param pool The pool, which must outlive the parser.
+         */
+        explicit http_response_parser(buffer_pool &pool = buffer_pool::get_default()): pool(&pool) {}
+
+        http_response_parser(const http_response_parser &) = delete;
+
+        http_response_parser &operator=(const http_response_parser &) = delete;
+
+        http_response_parser(http_response_parser &&) noexcept = default;
+
+        http_response_parser &operator=(http_response_parser &&) noexcept = default;
+
+        /**
+         * @brief Prepares the parser for the next response.
+         *
+         * The capacity of the buffer and header table is kept.
+         *
+         * @param keep_leftover Whether bytes received past the end of the previous, complete response are kept and
+         * parsed as the start of the next one, as needed when responses arrive back to back on one connection.
+         * @param head_request Whether the next response answers a HEAD request, set before the leftover is parsed.
+         */
+        void reset(bool keep_leftover = false, bool head_request = false);
+
+        /**
+         * @brief Sets whether the response answers a HEAD request, in which case it has no body.
+         *
+         * @param is_head True for a HEAD request.
+         */
+        void set_head_request(const bool is_head) { head = is_head; }
+
+        /**
+         * @brief Returns space for at least size bytes at the end of the receive buffer.
+         *
+         * Consumed body data is discarded first, so views returned by next_body() are invalidated.
+         *
+         * @param size The number of bytes about to be received.
+         * @return A pointer to the space, valid until the next call to prepare() or reset().
+         */
+        char *prepare(size_t size);
+
+        /**
+         * @brief Returns the number of bytes free at the end of the receive buffer, at least the size last prepared.
+         */
+        [[nodiscard]] size_t available() const { return buffer.capacity() - filled; }
+
+        /**
+         * @brief Parses size bytes written to the space returned by prepare().
+         *
+         * @param size The number of bytes received.
+         * @throws std::runtime_error If the response is malformed or its header block is too large.
+         */
+        void commit(size_t size);
+
+        /**
+         * @brief Copies data into the receive buffer and parses it.
+         *
+         * @param data The received bytes.
+         * @throws std::runtime_error If the response is malformed or its header block is too large.
+         */
+        void feed(std::string_view data);
+
+        /**
+         * @brief Tells the parser the peer has closed the connection.
+         *
+         * This completes a body delimited by the connection closing.
+         *
+         * @throws std::runtime_error If the response was not complete.
+         */
+        void finish();
+
+        /**
+         * @brief Takes the next piece of body data parsed so far.
+         *
+         * @param chunk Set to the body data, a view into the receive buffer valid until the next prepare(), feed() or reset().
+         * @return True if there was body data, false otherwise.
+         */
+        bool next_body(std::string_view &chunk);
+
+        /**
+         * @brief Returns whether the status line and every header field have been parsed.
+         */
+        [[nodiscard]] bool headers_complete() const { return current != state::status_line && current != state::header_line; }
+
+        /**
+         * @brief Returns whether the whole response, including its body, has been parsed.
+         */
+        [[nodiscard]] bool is_complete() const { return current == state::complete; }
+
+        /**
+         * @brief Returns the status code of the response.
+         */
+        [[nodiscard]] int get_status_code() const { return status; }
+
+        /**
+         * @brief Returns the reason phrase of the response.
+         */
+        [[nodiscard]] std::string_view get_reason() const { return view(reason_span); }
+
+        /**
+         * @brief Returns the minor HTTP version of the response, 0 for HTTP/1.0 and 1 for HTTP/1.1.
+         */
+        [[nodiscard]] int get_minor_version() const { return minor_version; }
+
+        /**
+         * @brief Returns how the end of the body is found.
+         */
+        [[nodiscard]] body_framing get_framing() const { return framing; }
+
+        /**
+         * @brief Returns the number of header fields.
+         */
+        [[nodiscard]] size_t header_count() const { return header_spans.size(); }
+
+        /**
+         * @brief Returns a header field by index.
+         *
+         * @param index The index, less than header_count().
+         * @return The field, views into the receive buffer.
+         */
+        [[nodiscard]] header_field get_header(size_t index) const;
+
+        /**
+         * @brief Finds the first header field with the given name, ignoring case.
+         *
+         * @param name The name of the header.
+         * @return The value, or std::nullopt if the header is absent.
+         */
+        [[nodiscard]] std::optional<std::string_view> find_header(std::string_view name) const;
+
+        /**
+         * @brief Returns whether the connection can carry another request once this response is complete.
+         *
+         * HTTP/1.1 connections persist unless the server sends Connection: close, HTTP/1.0 ones only with Connection: keep-alive.
+         */
+        [[nodiscard]] bool keep_alive() const;
+
+        /**
+         * @brief Copies the status code and headers into a message, along with its Content-Length.
+         *
+         * @param response The message that receives them, its previous headers are replaced.
+         * @pre headers_complete() is true.
+         * @throws std::runtime_error If the Content-Length is malformed.
+         */
+        void copy_headers(http_message &response) const;
+
+        /**
+         * @brief Returns the number of received bytes past the end of the complete response.
+         */
+        [[nodiscard]] size_t leftover() const { return filled - parsed; }
+
+        /**
+         * @brief Compares two strings, ignoring ASCII case.
+         */
+        static bool equals_ignore_case(std::string_view a, std::string_view b);
+
+        /**
+         * @brief Checks whether a comma separated header value contains the given token, ignoring ASCII case.
+         */
+        static bool has_token(std::string_view value, std::string_view token);
+    };
+} // cnet
+
+#endif //HTTP_RESPONSE_PARSER_H
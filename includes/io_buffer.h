@@ -0,0 +1,199 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef IO_BUFFER_H
+#define IO_BUFFER_H
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#define CNET_IO_BUFFER_SIZE 16384 // bytes of each pooled receive buffer, one TLS record
+#define CNET_IO_BUFFER_POOL_LIMIT 256 // idle buffers a pool keeps for reuse, any more are freed
+
+namespace cnet
+{
+    class buffer_pool;
+
+    /**
+     * @brief A reference counted handle to a fixed-size block of memory that bytes are received into.
+     *
+     * Copies share the block, and when the last one goes away the block goes back to the pool it came from, or is
+     * freed if it didn't come from one. The handle tracks how many bytes of the block hold data, so a transport can
+     * receive into the free space and a parser can read the bytes in place.
+     * @code{.cpp}
+     * cnet::io_buffer buffer = cnet::buffer_pool::get_default().acquire();
+     * connection.receive(buffer);
+     * parse(buffer.view());
+     * @endcode
+     */
+    class io_buffer
+    {
+    private:
+        friend class buffer_pool;
+
+        struct block
+        {
+            std::atomic<size_t> references;
+            size_t capacity;
+            buffer_pool *pool; // where the block goes back to, nullptr for a block allocated on its own
+
+            [[nodiscard]] char *data() { return reinterpret_cast<char *>(this + 1); }
+        };
+
+        block *current = nullptr;
+        size_t used = 0; // bytes of the block holding data
+
+        explicit io_buffer(block *b): current(b) {}
+        static block *allocate(size_t capacity, buffer_pool *pool);
+
+    public:
+        io_buffer() = default;
+
+        /**
+         * @brief Allocates a buffer of any capacity that isn't part of a pool.
+         *
+         * @param capacity The size of the buffer in bytes.
+         */
+        explicit io_buffer(size_t capacity);
+
+        io_buffer(const io_buffer &other);
+
+        io_buffer(io_buffer &&other) noexcept;
+
+        io_buffer &operator=(const io_buffer &other);
+
+        io_buffer &operator=(io_buffer &&other) noexcept;
+
+        ~io_buffer();
+
+        /**
+         * @brief Drops this reference to the block, the handle is empty afterwards.
+         */
+        void release();
+
+        /**
+         * @brief Returns the start of the block, nullptr for an empty handle.
+         */
+        [[nodiscard]] char *data() { return current != nullptr ? current->data() : nullptr; }
+
+        /**
+         * @brief Returns the start of the block, nullptr for an empty handle.
+         */
+        [[nodiscard]] const char *data() const { return current != nullptr ? current->data() : nullptr; }
+
+        /**
+         * @brief Returns the size of the block in bytes, 0 for an empty handle.
+         */
+        [[nodiscard]] size_t capacity() const { return current != nullptr ? current->capacity : 0; }
+
+        /**
+         * @brief Returns the number of bytes holding data.
+         */
+        [[nodiscard]] size_t size() const { return used; }
+
+        /**
+         * @brief Sets the number of bytes holding data.
+         *
+         * @param size The new size, at most capacity().
+         */
+        void resize(const size_t size) { used = size; }
+
+        /**
+         * @brief Returns the free space after the data, where the next bytes are received.
+         */
+        [[nodiscard]] char *tail() { return data() + used; }
+
+        /**
+         * @brief Returns the number of bytes free after the data.
+         */
+        [[nodiscard]] size_t available() const { return capacity() - used; }
+
+        /**
+         * @brief Marks size bytes written to tail() as data.
+         *
+         * @param size The number of bytes written, at most available().
+         */
+        void commit(const size_t size) { used += size; }
+
+        /**
+         * @brief Returns the data as a view into the block.
+         */
+        [[nodiscard]] std::string_view view() const { return {data(), used}; }
+
+        /**
+         * @brief Returns whether the handle refers to a block.
+         */
+        explicit operator bool() const { return current != nullptr; }
+
+        /**
+         * @brief Returns whether another handle shares the block.
+         */
+        [[nodiscard]] bool is_shared() const { return current != nullptr && current->references.load(std::memory_order_acquire) > 1; }
+    };
+
+    /**
+     * @brief A thread-safe free list of fixed-size receive buffers, so buffers are reused across reads, requests and
+     * connections instead of being allocated each time.
+     *
+     * A pool must outlive the buffers it hands out. The default pool lives for the whole program.
+     */
+    class buffer_pool
+    {
+    private:
+        friend class io_buffer;
+
+        size_t buffer_size;
+        size_t limit;
+        mutable std::mutex mutex;
+        std::vector<io_buffer::block *> idle;
+
+        void recycle(io_buffer::block *b);
+
+    public:
+        /**
+         * @brief Creates an empty pool.
+         *
+         * @param buffer_size The size of every buffer handed out, in bytes.
+         * @param limit The most idle buffers kept for reuse.
+         */
+        explicit buffer_pool(size_t buffer_size = CNET_IO_BUFFER_SIZE, size_t limit = CNET_IO_BUFFER_POOL_LIMIT);
+
+        ~buffer_pool();
+
+        buffer_pool(const buffer_pool &) = delete;
+
+        buffer_pool &operator=(const buffer_pool &) = delete;
+
+        /**
+         * @brief Takes an idle buffer, or allocates one if there is none.
+         *
+         * @return An empty buffer of get_buffer_size() bytes.
+         */
+        [[nodiscard]] io_buffer acquire();
+
+        /**
+         * @brief Returns the size of the buffers handed out, in bytes.
+         */
+        [[nodiscard]] size_t get_buffer_size() const { return buffer_size; }
+
+        /**
+         * @brief Returns the number of idle buffers waiting to be reused.
+         */
+        [[nodiscard]] size_t get_idle_count() const;
+
+        /**
+         * @brief Frees every idle buffer.
+         */
+        void trim();
+
+        /**
+         * @brief Returns the pool shared by the library, of CNET_IO_BUFFER_SIZE byte buffers.
+         */
+        static buffer_pool &get_default();
+    };
+} // cnet
+
+#endif //IO_BUFFER_H
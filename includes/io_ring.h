@@ -0,0 +1,146 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef IO_RING_H
+#define IO_RING_H
+#ifdef CNET_IO_URING
+#include <string_view>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+
+namespace cnet
+{
+    /**
+     * @brief A minimal io_uring instance driven through the raw system calls, so liburing isn't needed.
+     *
+     * It maps the submission and completion queues, hands out submission entries, and optionally registers a sparse
+     * fixed file table and a ring of provided receive buffers. Only used by event_loop, on the loop's thread.
+     */
+    class io_ring
+    {
+    private:
+        int ring_fd = -1;
+        unsigned features = 0;
+
+        void *sq_memory = nullptr;
+        size_t sq_memory_size = 0;
+        void *cq_memory = nullptr;
+        size_t cq_memory_size = 0;
+        io_uring_sqe *sqes = nullptr;
+        size_t sqes_size = 0;
+
+        unsigned *sq_head = nullptr;
+        unsigned *sq_tail = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned sq_mask = 0;
+        unsigned sq_entries = 0;
+        unsigned sq_local_tail = 0;
+
+        unsigned *cq_head = nullptr;
+        unsigned *cq_tail = nullptr;
+        unsigned cq_mask = 0;
+        io_uring_cqe *cqes = nullptr;
+
+        io_uring_buf_ring *buffer_ring = nullptr;
+        char *buffers = nullptr;
+        size_t buffer_memory_size = 0;
+        unsigned buffer_count = 0;
+        unsigned buffer_size = 0;
+        unsigned short buffer_group = 0;
+
+        unsigned long long enters = 0;
+
+        [[nodiscard]] io_uring_buf &get_entry(unsigned index) const;
+
+    public:
+        /**
+         * @brief Sets up the ring.
+         *
+         * @param entries The number of submission entries, rounded up to a power of two by the kernel.
+         * @throws std::runtime_error If the kernel doesn't support io_uring or refuses it, e.g. under seccomp.
+         */
+        explicit io_ring(unsigned entries);
+
+        ~io_ring();
+
+        io_ring(const io_ring &) = delete;
+
+        io_ring &operator=(const io_ring &) = delete;
+
+        /**
+         * @brief Returns a cleared submission entry, submitting the queued ones first if the queue is full.
+         */
+        io_uring_sqe *get_sqe();
+
+        /**
+         * @brief Submits the queued entries and waits for completions, all in one io_uring_enter call.
+         *
+         * @param wait_for The number of completions to wait for, 0 to only submit.
+         * @param timeout The longest time to wait, null to wait without limit.
+         * @return The number of entries submitted, or a negative errno such as -ETIME or -EINTR.
+         */
+        int submit(unsigned wait_for = 0, const __kernel_timespec *timeout = nullptr);
+
+        /**
+         * @brief Returns the oldest completion without consuming it, null if there is none.
+         */
+        io_uring_cqe *peek();
+
+        /**
+         * @brief Consumes the completion returned by peek().
+         */
+        void advance();
+
+        /**
+         * @brief Registers an empty fixed file table that sockets are installed into with IORING_OP_FILES_UPDATE.
+         *
+         * @param count The number of slots.
+         * @return False if the kernel doesn't support sparse tables.
+         */
+        bool register_files(unsigned count);
+
+        /**
+         * @brief Registers a ring of receive buffers the kernel picks from, as used by multishot receives.
+         *
+         * @param count The number of buffers, a power of two.
+         * @param size The size of each buffer.
+         * @param group The buffer group id the receives select from.
+         * @return False if the kernel doesn't support provided buffer rings.
+         */
+        bool register_buffers(unsigned count, unsigned size, unsigned short group);
+
+        /**
+         * @brief Returns the data a completion placed in a provided buffer.
+         *
+         * @param id The buffer id, from the flags of the completion.
+         * @param length The number of bytes received.
+         */
+        [[nodiscard]] std::string_view get_buffer(unsigned id, size_t length) const { return {buffers + static_cast<size_t>(id) * buffer_size, length}; }
+
+        /**
+         * @brief Hands a provided buffer back to the kernel once its data has been consumed.
+         *
+         * @param id The buffer id.
+         */
+        void recycle_buffer(unsigned id);
+
+        /**
+         * @brief Returns the buffer group id of the registered buffers.
+         */
+        [[nodiscard]] unsigned short get_buffer_group() const { return buffer_group; }
+
+        /**
+         * @brief Returns the IORING_FEAT_ flags of the kernel.
+         */
+        [[nodiscard]] unsigned get_features() const { return features; }
+
+        /**
+         * @brief Returns the number of io_uring_enter calls made so far.
+         */
+        [[nodiscard]] unsigned long long get_enters() const { return enters; }
+    };
+} // cnet
+
+#endif
+#endif //IO_RING_H
@@ -0,0 +1,80 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+#include <atomic>
+#include <utility>
+
+namespace cnet
+{
+    /**
+     * @brief An unbounded queue many threads push to and a single thread pops from, without locks.
+     *
+     * A push swaps its node in with one atomic exchange and then links it, so producers never wait for one another or
+     * for the consumer. A node whose producer was interrupted between the two steps isn't visible yet, pop() reports
+     * the queue as empty until it is linked.
+     *
+     * @tparam value_type The type of the values, which must be default constructible and movable.
+     */
+    template<typename value_type>
+    class mpsc_queue
+    {
+    private:
+        struct node
+        {
+            std::atomic<node *> next = nullptr;
+            value_type value{};
+        };
+
+        std::atomic<node *> head; // the node pushed last, producers swap theirs in
+        node *tail; // the node before the next one popped, whose value was already taken, only the consumer touches it
+
+    public:
+        mpsc_queue(): head(new node()), tail(head.load(std::memory_order_relaxed)) {}
+
+        ~mpsc_queue()
+        {
+            while (tail != nullptr)
+            {
+                node *next = tail->next.load(std::memory_order_relaxed);
+                delete tail;
+                tail = next;
+            }
+        }
+
+        mpsc_queue(const mpsc_queue &) = delete;
+
+        mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+        /**
+         * @brief Adds a value at the end of the queue, from any thread.
+         */
+        void push(value_type value)
+        {
+            node *added = new node();
+            added->value = std::move(value);
+            node *previous = head.exchange(added, std::memory_order_acq_rel);
+            previous->next.store(added, std::memory_order_release);
+        }
+
+        /**
+         * @brief Takes the value at the front of the queue, from the consumer thread only.
+         *
+         * @param value Set to the value taken.
+         * @return True if a value was taken, false if the queue is empty.
+         */
+        bool pop(value_type &value)
+        {
+            node *next = tail->next.load(std::memory_order_acquire);
+            if (next == nullptr) return false;
+            value = std::move(next->value);
+            delete tail;
+            tail = next;
+            return true;
+        }
+    };
+} // cnet
+
+#endif //MPSC_QUEUE_H
@@ -0,0 +1,111 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef REQUEST_COALESCER_H
+#define REQUEST_COALESCER_H
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "http_message.h"
+
+namespace cnet
+{
+    /**
+     * @brief Counters describing how a request_coalescer has been used.
+     */
+    struct request_coalescer_stats
+    {
+        /**
+         * @brief The number of requests sent upstream, each on behalf of every identical request that joined it.
+         */
+        unsigned long long sent = 0;
+        /**
+         * @brief The number of requests answered by joining an identical request already in flight.
+         */
+        unsigned long long joined = 0;
+    };
+
+    /**
+     * @brief Coalesces identical requests made at the same time into one, so a burst of threads asking for the same
+     * URL, e.g. when a cached response expires, costs a single upstream request.
+     *
+     * The first caller sends the request, while the callers arriving before its response wait for it and then share
+     * the same immutable response, or the same exception. Nothing is kept once the response is handed out, a request
+     * made afterwards is sent again.
+     *
+     * The coalescer is safe to share between several http_client objects and threads.
+     * @code{.cpp}
+     * cnet::http_client_options options;
+     * options.coalescer = std::make_shared<cnet::request_coalescer>();
+     * cnet::http_client client(options); // one client per thread, all with the same options
+     * @endcode
+     */
+    class request_coalescer
+    {
+    private:
+        struct flight
+        {
+            std::condition_variable landed;
+            bool done = false;
+            size_t followers = 0;
+            std::shared_ptr<const http_message> response;
+            std::exception_ptr error;
+        };
+
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<flight>> flights;
+
+        std::atomic<unsigned long long> sent = 0;
+        std::atomic<unsigned long long> joined = 0;
+
+    public:
+        request_coalescer() = default;
+
+        request_coalescer(const request_coalescer &) = delete;
+        request_coalescer &operator=(const request_coalescer &) = delete;
+
+        /**
+         * @brief Returns whether the request may share its response, only a GET or HEAD without a body may.
+         */
+        static bool can_coalesce(const http_message &request);
+
+        /**
+         * @brief Builds the key identical requests share.
+         *
+         * The key is made of the method, the normalized URL without its fragment and the headers of the request, so
+         * requests with e.g. different credentials are never coalesced.
+         *
+         * @param request The request.
+         * @param context Anything else the response depends on, e.g. the Accept-Encoding a client adds.
+         * @return The key.
+         */
+        static std::string make_key(const http_message &request, std::string_view context = {});
+
+        /**
+         * @brief Sends a request, unless an identical one is in flight, in which case this waits for its response.
+         *
+         * @param key The key of the request, from make_key().
+         * @param send Sends the request and returns its response, only called if no identical request is in flight.
+         * @return The response of the request that was joined, or null if this call sent the request itself and so
+         * already has the response that send returned.
+         * @throws The exception thrown by send, in this call or in the one that was joined.
+         */
+        std::shared_ptr<const http_message> run(const std::string &key, const std::function<const http_message &()> &send);
+
+        /**
+         * @brief Returns the usage counters of the coalescer.
+         *
+         * @return A snapshot of the counters.
+         */
+        [[nodiscard]] request_coalescer_stats get_stats() const;
+    };
+} // cnet
+
+#endif //REQUEST_COALESCER_H
@@ -0,0 +1,300 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef RESOLVER_H
+#define RESOLVER_H
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifdef __WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
+#define CNET_RESOLVER_DEFAULT_TTL 60 // seconds, how long an answer is kept when the lookup doesn't say
+#define CNET_RESOLVER_THREADS 4 // background lookups a system_resolver runs at once
+
+namespace cnet
+{
+    /**
+     * @brief One address a host name resolved to. The port is set by whoever connects to it.
+     */
+    struct endpoint
+    {
+        sockaddr_storage address{};
+        socklen_t length = 0;
+
+        [[nodiscard]] int get_family() const { return address.ss_family; }
+
+        /**
+         * @brief Sets the port of the address.
+         */
+        void set_port(unsigned int port);
+
+        /**
+         * @brief Returns the address in its numeric text form, without the port.
+         */
+        [[nodiscard]] std::string to_string() const;
+
+        /**
+         * @brief Parses a numeric IPv4 or IPv6 address.
+         *
+         * @param text The address, e.g. "127.0.0.1" or "::1".
+         * @param result Receives the address when it is valid.
+         * @return False if the text isn't a numeric address.
+         */
+        static bool parse(const std::string &text, endpoint &result);
+    };
+
+    /**
+     * @brief The answer to a lookup, with how long it may be reused.
+     */
+    struct resolution
+    {
+        std::vector<endpoint> addresses;
+        /**
+         * @brief The time to live of the answer in seconds, 0 if it must not be cached.
+         */
+        unsigned int ttl = 0;
+    };
+
+    /**
+     * @brief Orders addresses for connecting as RFC 8305 (Happy Eyeballs) describes, alternating between the address
+     * families starting with the family of the first, most preferred, address.
+     *
+     * @param addresses The addresses in order of preference.
+     * @return The addresses in the order they should be tried.
+     */
+    std::vector<endpoint> order_for_connect(const std::vector<endpoint> &addresses);
+
+    /**
+     * @brief Turns host names into addresses. Clients take one through their options, so lookups can be cached,
+     * answered from a table in tests, or sent to another DNS implementation.
+     */
+    class resolver
+    {
+    public:
+        using resolve_handler = std::function<void(resolution result, std::exception_ptr error)>;
+
+        virtual ~resolver() = default;
+
+        /**
+         * @brief Looks up a host, blocking until the answer arrives.
+         *
+         * @param host The host name or numeric address.
+         * @return The addresses of the host, never empty.
+         * @throws std::runtime_error If the host can't be resolved.
+         */
+        virtual resolution resolve(const std::string &host) = 0;
+
+        /**
+         * @brief Looks up a host without blocking the caller. The default runs resolve() inline, which suits
+         * resolvers that never wait on the network.
+         *
+         * @param host The host name or numeric address.
+         * @param handler Called with the answer or the error, possibly on another thread.
+         */
+        virtual void resolve_async(const std::string &host, resolve_handler handler);
+
+        /**
+         * @brief Returns the resolver used when none is given, a cache in front of the system resolver shared by
+         * the whole process.
+         */
+        static std::shared_ptr<resolver> get_default();
+    };
+
+    /**
+     * @brief Resolves with getaddrinfo(), which looks up the A and AAAA records together and reads /etc/hosts.
+     *
+     * getaddrinfo() doesn't report the TTL of its answer, so every answer is given the same one. Asynchronous lookups
+     * run on a few background threads owned by the resolver.
+     */
+    class system_resolver : public resolver
+    {
+    private:
+        unsigned int ttl;
+        size_t thread_count;
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::pair<std::string, resolve_handler>> queue;
+        std::vector<std::thread> workers;
+        bool stopping = false;
+
+        void work();
+
+    public:
+        /**
+         * @brief Constructs a system resolver, its threads are only started by the first asynchronous lookup.
+         *
+         * @param ttl The time to live given to every answer, in seconds.
+         * @param threads The number of lookups run at once in the background.
+         */
+        explicit system_resolver(unsigned int ttl = CNET_RESOLVER_DEFAULT_TTL, size_t threads = CNET_RESOLVER_THREADS);
+
+        system_resolver(const system_resolver &) = delete;
+
+        system_resolver &operator=(const system_resolver &) = delete;
+
+        /**
+         * @brief Waits for the lookups that are running, the queued ones are dropped without calling their handlers.
+         */
+        ~system_resolver() override;
+
+        resolution resolve(const std::string &host) override;
+
+        void resolve_async(const std::string &host, resolve_handler handler) override;
+    };
+
+    /**
+     * @brief Resolves from a fixed table, like /etc/hosts, without any network access. Thread safe.
+     * @code{.cpp}
+     * auto hosts = std::make_shared<cnet::hosts_resolver>();
+     * hosts->add("example.com", "127.0.0.1");
+     * options.resolver = hosts;
+     * @endcode
+     */
+    class hosts_resolver : public resolver
+    {
+    private:
+        unsigned int ttl;
+        std::mutex mutex;
+        std::unordered_map<std::string, std::vector<endpoint>> table;
+
+    public:
+        /**
+         * @brief Constructs an empty table.
+         *
+         * @param ttl The time to live given to every answer, in seconds.
+         */
+        explicit hosts_resolver(unsigned int ttl = CNET_RESOLVER_DEFAULT_TTL): ttl(ttl) {}
+
+        /**
+         * @brief Adds an address to a host, a host may have several.
+         *
+         * @param host The host name, matched without regard to case.
+         * @param address A numeric IPv4 or IPv6 address.
+         * @throws std::runtime_error If the address isn't numeric.
+         */
+        void add(const std::string &host, const std::string &address);
+
+        /**
+         * @brief Adds the entries of a file in the format of /etc/hosts: an address followed by its host names on
+         * each line, with # starting a comment.
+         *
+         * @param path The path of the file.
+         * @throws std::runtime_error If the file can't be opened.
+         */
+        void load(const std::string &path);
+
+        /**
+         * @brief Resolves a host from the table, numeric addresses resolve to themselves.
+         *
+         * @throws std::runtime_error If the host isn't in the table.
+         */
+        resolution resolve(const std::string &host) override;
+    };
+
+    /**
+     * @brief How long a caching_resolver keeps answers.
+     */
+    struct resolver_cache_options
+    {
+        /**
+         * @brief The longest an answer is kept in seconds, however long its TTL.
+         */
+        unsigned int max_ttl = 300;
+        /**
+         * @brief How long a failed lookup is remembered in seconds, so a missing host isn't looked up again for every
+         * request. 0 disables negative caching.
+         */
+        unsigned int negative_ttl = 5;
+        /**
+         * @brief The most hosts kept, expired entries are dropped first once it is reached.
+         */
+        size_t max_entries = 4096;
+    };
+
+    /**
+     * @brief Counters describing the lookups made through a caching_resolver.
+     */
+    struct resolver_stats
+    {
+        /**
+         * @brief The number of lookups answered from the cache, including cached failures.
+         */
+        unsigned long long hits = 0;
+        /**
+         * @brief The number of lookups passed on to the upstream resolver.
+         */
+        unsigned long long misses = 0;
+    };
+
+    /**
+     * @brief Keeps the answers of another resolver for as long as their TTL allows, and remembers failures for a
+     * short while. Thread safe.
+     */
+    class caching_resolver : public resolver
+    {
+    private:
+        struct entry
+        {
+            resolution result;
+            std::string error;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        std::shared_ptr<resolver> upstream;
+        resolver_cache_options options;
+        std::mutex mutex;
+        std::unordered_map<std::string, entry> entries;
+        std::atomic<unsigned long long> hits = 0;
+        std::atomic<unsigned long long> misses = 0;
+
+        bool find(const std::string &host, resolution &result, std::string &error);
+
+        void store(const std::string &host, const resolution &result, const std::string &error);
+
+    public:
+        /**
+         * @brief Constructs a cache in front of a resolver.
+         *
+         * @param upstream The resolver asked on a miss.
+         * @param options How long answers are kept.
+         */
+        explicit caching_resolver(std::shared_ptr<resolver> upstream, resolver_cache_options options = {});
+
+        /**
+         * @throws std::runtime_error If the host can't be resolved, or failed to resolve a moment ago.
+         */
+        resolution resolve(const std::string &host) override;
+
+        /**
+         * @brief Calls the handler inline on a hit, otherwise asks the upstream resolver asynchronously.
+         */
+        void resolve_async(const std::string &host, resolve_handler handler) override;
+
+        /**
+         * @brief Forgets every answer.
+         */
+        void clear();
+
+        /**
+         * @brief Returns how many lookups were answered from the cache and how many were passed on.
+         */
+        [[nodiscard]] resolver_stats get_stats() const;
+    };
+} // cnet
+
+#endif //RESOLVER_H
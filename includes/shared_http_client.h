@@ -0,0 +1,137 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef SHARED_HTTP_CLIENT_H
+#define SHARED_HTTP_CLIENT_H
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+#include "async_http_client.h"
+#include "event_loop.h"
+#include "mpsc_queue.h"
+
+namespace cnet
+{
+    /**
+     * @brief Options controlling a shared_http_client.
+     */
+    struct shared_http_client_options
+    {
+        /**
+         * @brief The number of I/O worker threads, one per core if 0.
+         */
+        unsigned int workers = 0;
+        /**
+         * @brief The readiness or completion backend of the workers' event loops.
+         */
+        loop_backend backend = loop_backend::automatic;
+        /**
+         * @brief The options of each worker's client. The connection limits apply per worker, each worker keeping
+         * its own connections.
+         */
+        async_http_client_options client;
+    };
+
+    /**
+     * @brief An HTTP client any number of threads can make requests through at once.
+     *
+     * Requests are handed to a pool of I/O worker threads, one per core by default, each running an event loop with
+     * its own async_http_client. A submitting thread pushes onto a worker's lock-free queue and only wakes the worker
+     * when it isn't already due to look at the queue, spreading its requests over the workers in turn. Every worker
+     * keeps its own keep-alive connections, so the connection pool is sharded by worker and no lock is shared by all
+     * of them.
+     * @code{.cpp}
+     * cnet::shared_http_client client;
+     * // from any thread
+     * std::future<cnet::http_message> response = client.request(cnet::http_message("https://example.com/config.json"));
+     * @endcode
+     */
+    class shared_http_client
+    {
+    private:
+        struct submission
+        {
+            http_message message;
+            body_sink *sink = nullptr;
+            response_handler handler;
+        };
+
+        struct worker
+        {
+            event_loop *loop = nullptr;
+            std::unique_ptr<async_http_client> client;
+            mpsc_queue<submission> queue;
+            // set while the worker is woken or draining, so a burst of submissions writes the eventfd only once
+            std::atomic<bool> signaled = false;
+            // requests pushed onto the queue that the worker hasn't handed to its client yet
+            std::atomic<size_t> queued = 0;
+            int wake_fd = -1;
+
+            ~worker();
+        };
+
+        event_loop_group group;
+        std::vector<std::unique_ptr<worker>> workers;
+
+        void submit(submission &&request);
+
+        static void drain(worker &target);
+
+    public:
+        /**
+         * @brief Starts the worker threads.
+         *
+         * @param options The number of workers and the options of their clients.
+         * @throws std::runtime_error If a worker can't be set up.
+         */
+        explicit shared_http_client(const shared_http_client_options &options = {});
+
+        /**
+         * @brief Stops the worker threads, requests still in flight are abandoned without their handlers being called.
+         */
+        ~shared_http_client();
+
+        shared_http_client(const shared_http_client &) = delete;
+
+        shared_http_client &operator=(const shared_http_client &) = delete;
+
+        /**
+         * @brief Sends a request and calls the handler with its response, from any thread.
+         *
+         * @param message The request.
+         * @param handler Called on a worker thread with the response, or with the error if the request failed.
+         */
+        void make_request(http_message message, response_handler handler);
+
+        /**
+         * @brief Sends a request and streams the response body to a sink, from any thread.
+         *
+         * @param message The request.
+         * @param sink Receives the body on a worker thread, it must outlive the request.
+         * @param handler Called on a worker thread with the status and headers, or with the error if the request failed.
+         */
+        void make_request(http_message message, body_sink &sink, response_handler handler);
+
+        /**
+         * @brief Sends a request, from any thread.
+         *
+         * @param message The request.
+         * @return The response, or the error of the request when it is read.
+         */
+        [[nodiscard]] std::future<http_message> request(http_message message);
+
+        /**
+         * @brief Returns the number of worker threads.
+         */
+        [[nodiscard]] size_t get_worker_count() const { return workers.size(); }
+
+        /**
+         * @brief Returns the number of requests submitted to the workers that haven't completed.
+         */
+        [[nodiscard]] size_t get_in_flight() const;
+    };
+} // cnet
+
+#endif //SHARED_HTTP_CLIENT_H
@@ -0,0 +1,189 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef TASK_H
+#define TASK_H
+// the library itself is C++17, coroutines are only offered to code compiled as C++20
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "event_loop.h"
+
+namespace cnet
+{
+    template<typename value_type>
+    class task;
+
+    namespace detail
+    {
+        struct task_promise_base
+        {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+            bool detached = false;
+
+            struct final_awaiter
+            {
+                [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+                template<typename promise_type>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    task_promise_base &promise = handle.promise();
+                    if (promise.detached)
+                    {
+                        // nobody is left to rethrow it to, as with std::thread
+                        if (promise.error != nullptr) std::terminate();
+                        handle.destroy();
+                        return std::noop_coroutine();
+                    }
+                    // resume the awaiting coroutine directly, so long chains of tasks don't grow the stack
+                    return promise.continuation ? promise.continuation : std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            [[nodiscard]] std::suspend_always initial_suspend() const noexcept { return {}; }
+
+            [[nodiscard]] final_awaiter final_suspend() const noexcept { return {}; }
+
+            void unhandled_exception() { error = std::current_exception(); }
+        };
+
+        template<typename value_type>
+        struct task_promise : task_promise_base
+        {
+            std::optional<value_type> value;
+
+            task<value_type> get_return_object();
+
+            template<typename result_type>
+            void return_value(result_type &&result) { value.emplace(std::forward<result_type>(result)); }
+
+            value_type take()
+            {
+                if (error != nullptr) std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct task_promise<void> : task_promise_base
+        {
+            task<void> get_return_object();
+
+            void return_void() const {}
+
+            void take() const
+            {
+                if (error != nullptr) std::rethrow_exception(error);
+            }
+        };
+    }
+
+    /**
+     * @brief A coroutine that produces a value, started when it is awaited or handed to spawn(). Requires C++20.
+     *
+     * Awaiting one task from another runs it inline and resumes the caller as soon as it returns, so a chain of them
+     * reads like straight-line code while every wait inside goes through the event loop instead of blocking a thread.
+     * @code{.cpp}
+     * cnet::task<int> get_status(cnet::async_http_client &client, std::string url)
+     * {
+     *     cnet::http_message response = co_await client.request(cnet::http_message(url));
+     *     co_return response.status_code;
+     * }
+     *
+     * cnet::task<void> crawl(cnet::async_http_client &client)
+     * {
+     *     const int status = co_await get_status(client, "http://example.com/");
+     * }
+     *
+     * cnet::spawn(loop, crawl(client));
+     * loop.run();
+     * @endcode
+     */
+    template<typename value_type = void>
+    class task
+    {
+    public:
+        using promise_type = detail::task_promise<value_type>;
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+        friend struct detail::task_promise<value_type>;
+
+        friend void spawn(event_loop &loop, task<void> work);
+
+        explicit task(const std::coroutine_handle<promise_type> handle): handle(handle) {}
+
+    public:
+        task(task &&other) noexcept: handle(std::exchange(other.handle, nullptr)) {}
+
+        task &operator=(task &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle) handle.destroy();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        task(const task &) = delete;
+
+        task &operator=(const task &) = delete;
+
+        ~task()
+        {
+            if (handle) handle.destroy();
+        }
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        /**
+         * @brief Returns what the coroutine returned.
+         * @throws std::exception Whatever the coroutine threw.
+         */
+        value_type await_resume() { return handle.promise().take(); }
+    };
+
+    template<typename value_type>
+    task<value_type> detail::task_promise<value_type>::get_return_object()
+    {
+        return task<value_type>(std::coroutine_handle<task_promise>::from_promise(*this));
+    }
+
+    inline task<void> detail::task_promise<void>::get_return_object()
+    {
+        return task<void>(std::coroutine_handle<task_promise>::from_promise(*this));
+    }
+
+    /**
+     * @brief Starts a task on the loop's thread without waiting for it, its frame is freed once it returns.
+     *
+     * An exception escaping the task calls std::terminate(), catch it inside the task. Thread safe.
+     *
+     * @param loop The loop the task starts on.
+     * @param work The task to run.
+     */
+    inline void spawn(event_loop &loop, task<void> work)
+    {
+        const std::coroutine_handle<task<void>::promise_type> handle = std::exchange(work.handle, nullptr);
+        handle.promise().detached = true;
+        loop.post([handle] { handle.resume(); });
+    }
+} // cnet
+
+#endif
+#endif //TASK_H
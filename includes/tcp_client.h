@@ -7,11 +7,46 @@
 #ifdef CNET_TCP_THREADSAFE
 #include <mutex>
 #endif
+#include <memory>
 #include <string>
+#ifndef __WIN32
+#include <netdb.h>
+#endif
 #include "openssl/ssl3.h"
+#include <vector>
+#include "const_buffer.h"
+#include "io_buffer.h"
+#include "resolver.h"
+#include "tls_context.h"
+
+#define CNET_DEFAULT_TIMEOUT 30000 // milliseconds
+#define CNET_TLS_RECORD_SIZE 16384 // the largest TLS record, what a scatter-gather send coalesces up to over TLS
+#define CNET_MAX_SEND_SEGMENTS 256 // the most segments handed to a single sendmsg
+#define CNET_SENDFILE_CHUNK_SIZE (1 << 30) // the most bytes handed to a single sendfile, below the 2 GiB it allows
+#define CNET_FILE_CHUNK_SIZE 65536 // bytes read per chunk when a file can't be sent by the kernel
+#define CNET_CONNECTION_ATTEMPT_DELAY 250 // milliseconds before the next address races a slow connect, as RFC 8305 recommends
 
 namespace cnet
 {
+    /**
+     * @brief What a non-blocking operation is waiting for before it can make progress.
+     */
+    enum class io_wait
+    {
+        /**
+         * @brief The operation completed, or the peer closed the connection.
+         */
+        none,
+        /**
+         * @brief Retry once the socket is readable.
+         */
+        read,
+        /**
+         * @brief Retry once the socket is writable.
+         */
+        write,
+    };
+
     class tcp_client
     {
     protected:
@@ -20,24 +55,81 @@ namespace cnet
         unsigned int port = 0;
         int iResult = 0;
         unsigned long long sock = ~0; // ~0 is a common way to represent an invalid socket it equals -1 in two's complement
+        unsigned int timeout = CNET_DEFAULT_TIMEOUT; // milliseconds, applies to connect and to every send/receive call
 
 
-        SSL_CTX *ssl_context = nullptr;
+        std::shared_ptr<tls_context> ssl_context;
         SSL *ssl = nullptr;
+#ifndef __WIN32
+        // the addresses of a connect in the order they are tried, and the sockets of the attempts racing to connect
+        std::vector<endpoint> endpoints;
+        size_t next_endpoint = 0;
+        std::vector<int> attempts;
+        long long next_attempt = 0; // steady clock milliseconds at which another address joins the race
+        bool connecting = false;
+        int last_error = 0;
+
+        /**
+         * @brief Opens a non-blocking socket for an address and adds it to the attempts.
+         * @return The socket, or -1 if it couldn't be opened.
+         */
+        int open_socket(const endpoint &address);
+
+        /**
+         * @brief Opens a socket for the next address that hasn't been tried and starts connecting to it.
+         * @return False if every address has been tried.
+         */
+        bool start_attempt();
+
+        /**
+         * @brief Makes an attempt the connection, closing the others.
+         */
+        void win_attempt(int fd);
+
+        /**
+         * @brief Closes a failed attempt.
+         * @throws std::runtime_error If it was the last attempt and every address has been tried.
+         */
+        void fail_attempt(int fd, int error);
+
+        /**
+         * @brief Waits until an attempt finishes, the next attempt is due or the deadline passes.
+         * @throws std::runtime_error If the deadline passes.
+         */
+        void wait_for_connect(long long deadline_ms) const;
+#endif
 #ifdef CNET_TCP_THREADSAFE
         std::mutex mutex;
 #endif
 
+        /**
+         * @brief Waits until the socket is ready for the requested poll events.
+         *
+         * @param events The poll events to wait for (POLLIN, POLLOUT).
+         * @param deadline_ms The steady clock time in milliseconds after which the wait is abandoned.
+         * @throws std::runtime_error If the deadline passes or the poll fails.
+         */
+        void wait_for(short events, long long deadline_ms) const;
+
+        /**
+         * @brief Computes the deadline for an operation started now, based on the timeout of this client.
+         *
+         * @return The deadline as steady clock milliseconds.
+         */
+        [[nodiscard]] long long make_deadline() const;
+
         /**
          * @brief Performs the SSL handshake to secure the established TCP connection.
          *
-         * This method initializes the SSL library, creates and initializes the SSL context,
-         * and sets the socket file descriptor for the SSL object.
+         * The SSL object is created from a shared context, so the handshake resumes the last session made with the
+         * same host and port whenever the server allows it.
          *
          * If the SSL handshake fails, an error message will be printed and a std::runtime_error will be thrown.
+         *
+         * @param context The TLS context to use, the process-wide default context if omitted.
          */
        public:
-        void create_ssl_handshake();
+        void create_ssl_handshake(std::shared_ptr<tls_context> context = tls_context::get());
 
         /**
          * @brief Writes the given message to the SSL connection.
@@ -87,12 +179,144 @@ namespace cnet
          * On Unix systems this will use the socket library to establish a connection.<br>
          * <b>See</b> "https://www.linuxhowtos.org/C_C++/socket.htm" for more information.
          *
+         * On Unix the socket is non-blocking and the addresses race as RFC 8305 (Happy Eyeballs) describes: they are
+         * tried alternating between IPv6 and IPv4, the next one joining every CNET_CONNECTION_ATTEMPT_DELAY
+         * milliseconds or as soon as one fails, and the first to connect wins. All later reads and writes are driven
+         * by poll() with the same timeout.
+         *
          * @param host The hostname or IP address of the server to connect to.
          * @param port The port number to connect to on the server.
+         * @param timeout The time in milliseconds allowed for the connect and for each subsequent send or receive.
+         * @param host_resolver The resolver that looks up the host, the process-wide default if null. Unix only.
          *
          * @return A TCP client object that represents the established connection.
+         * @throws std::runtime_error If the host cannot be resolved, or no address accepts the connection in time.
+         */
+        static tcp_client connect(const std::string &host, const unsigned int port, const unsigned int timeout = CNET_DEFAULT_TIMEOUT, const std::shared_ptr<resolver> &host_resolver = nullptr);
+
+#ifndef __WIN32
+        /**
+         * @brief Resolves the host and starts a non-blocking connect, without waiting for it to complete.
+         * Each socket in get_attempts() becomes writable once its connect has finished, at which point
+         * finish_connect() completes it. This is what an event loop uses to open thousands of connections from a
+         * single thread. Unix only.
+         * @param host The hostname or IP address of the server to connect to.
+         * @param port The port number to connect to on the server.
+         * @param timeout The time in milliseconds allowed for each subsequent blocking send or receive.
+         * @param host_resolver The resolver that looks up the host, the process-wide default if null.
+         * @return A TCP client whose connect is in progress.
+         * @throws std::runtime_error If the host cannot be resolved, or no address accepts a connect.
+         */
+        static tcp_client start_connect(const std::string &host, const unsigned int port, const unsigned int timeout = CNET_DEFAULT_TIMEOUT, const std::shared_ptr<resolver> &host_resolver = nullptr);
+
+        /**
+         * @brief Starts a non-blocking connect to addresses that were already resolved. Unix only.
+         * @param host The hostname the addresses belong to.
+         * @param port The port number to connect to on the server.
+         * @param addresses The addresses of the host, in order of preference.
+         * @param timeout The time in milliseconds allowed for each subsequent blocking send or receive.
+         * @return A TCP client whose connect is in progress.
+         * @throws std::runtime_error If no address accepts a connect.
+         */
+        static tcp_client start_connect(const std::string &host, unsigned int port, const std::vector<endpoint> &addresses, unsigned int timeout = CNET_DEFAULT_TIMEOUT);
+
+        /**
+         * @brief Completes a connect started with start_connect(), without blocking.
+         * Failed attempts are closed and slow ones are joined by a connect to the next address, so callers watching
+         * the sockets must check get_attempts() again whenever this returns false, and call it again after
+         * get_attempt_delay() even when none of them became ready.
+         * @return True once connected, false while the connect is still in progress.
+         * @throws std::runtime_error If no address accepted the connection.
+         */
+        bool finish_connect();
+
+        /**
+         * @brief Returns the sockets still trying to connect.
+         */
+        [[nodiscard]] const std::vector<int> &get_attempts() const { return attempts; }
+
+        /**
+         * @brief Returns the milliseconds until the next address should join the race, -1 if none is left.
+         */
+        [[nodiscard]] int get_attempt_delay() const;
+
+        /**
+         * @brief Returns whether some address hasn't been tried yet.
+         */
+        [[nodiscard]] bool has_next_address() const { return next_endpoint < endpoints.size(); }
+
+        /**
+         * @brief Prepares a connect to resolved addresses without opening a socket, for callers that connect the
+         * sockets from open_attempt() themselves, e.g. with an io_uring connect. Unix only.
+         * @param host The hostname the addresses belong to.
+         * @param port The port number to connect to on the server.
+         * @param addresses The addresses of the host, in order of preference.
+         * @param timeout The time in milliseconds allowed for each subsequent blocking send or receive.
+         * @return A TCP client without a socket.
+         */
+        static tcp_client prepare_connect(const std::string &host, unsigned int port, const std::vector<endpoint> &addresses, unsigned int timeout = CNET_DEFAULT_TIMEOUT);
+
+        /**
+         * @brief Opens a non-blocking socket for the next address that hasn't been tried, without connecting it.
+         * The sockets opened before stay open, so several attempts can race.
+         * @param address Receives the address the socket must be connected to, with the port set.
+         * @return The socket.
+         * @throws std::runtime_error If every address has been tried.
+         */
+        int open_attempt(endpoint &address);
+
+        /**
+         * @brief Records the outcome of connecting a socket opened by open_attempt().
+         * A successful attempt becomes the connection and every other attempt is closed, a failed one is closed.
+         * @param fd The socket.
+         * @param error 0 if the connect succeeded, otherwise the errno it failed with.
+         * @return True if connected, false if it failed and the next address should be tried.
+         * @throws std::runtime_error If it failed, no other attempt is pending and every address has been tried.
+         */
+        bool complete_attempt(int fd, int error);
+#endif
+
+        /**
+         * @brief Advances the SSL handshake as far as possible without blocking, creating the SSL connection first if needed.
+         * @param wait Set to what the handshake is waiting for when it returns false.
+         * @param context The TLS context to use, the process-wide default context if omitted.
+         * @return True once the handshake is complete.
+         * @throws std::runtime_error If the handshake fails.
+         */
+        bool try_ssl_handshake(io_wait &wait, const std::shared_ptr<tls_context> &context = tls_context::get());
+
+        /**
+         * @brief Sends as much of the data as the socket accepts without blocking, through SSL if a session is active.
+         * @param data The data to send.
+         * @param size The number of bytes to send.
+         * @param wait Set to what the send is waiting for when nothing could be sent.
+         * @return The number of bytes sent, 0 if the send would block.
+         * @throws std::runtime_error If the send fails.
          */
-        static tcp_client connect(const std::string &host, const unsigned int port);
+        size_t try_send(const char *data, size_t size, io_wait &wait);
+
+        /**
+         * @brief Sends as much of a list of segments as the socket accepts without blocking, in a single system call.
+         * Plain connections send them with one sendmsg, TLS connections coalesce up to one record of them into one
+         * SSL_write_ex.
+         * @param buffers The segments to send, in order.
+         * @param count The number of segments.
+         * @param wait Set to what the send is waiting for when nothing could be sent.
+         * @return The number of bytes sent, 0 if the send would block.
+         * @throws std::runtime_error If the send fails.
+         */
+        size_t try_send(const const_buffer *buffers, size_t count, io_wait &wait);
+
+        /**
+         * @brief Receives whatever data is available without blocking, through SSL if a session is active.
+         * @param buffer The buffer to receive into.
+         * @param size The size of the buffer.
+         * @param wait Set to what the receive is waiting for when nothing was received, io_wait::none when the peer
+         * closed the connection.
+         * @return The number of bytes received, 0 if the receive would block or the peer closed the connection.
+         * @throws std::runtime_error If the receive fails.
+         */
+        size_t try_receive(char *buffer, size_t size, io_wait &wait);
 
         /**
          * @brief Sends a message over the TCP connection.
@@ -109,22 +333,84 @@ namespace cnet
          */
         void send(const std::string &message);
 
+        /**
+         * @brief Sends a list of segments over the TCP connection, as try_send() does but waiting until all are sent.
+         *
+         * @param buffers The segments to send, in order.
+         * @param count The number of segments.
+         * @throws std::runtime_error If the socket is not open, the send fails or the timeout elapses.
+         */
+        void send(const const_buffer *buffers, size_t count);
+
+        /**
+         * @brief Sends part of a file over the TCP connection without loading it into memory.
+         *
+         * Plain connections use sendfile(), TLS connections use SSL_sendfile() when kernel TLS is active for sending.
+         * Otherwise, and on Windows, the file is read with pread() in chunks of CNET_FILE_CHUNK_SIZE that are sent
+         * as they are read. The timeout applies to each wait for the socket rather than to the whole file.
+         *
+         * @param fd The file descriptor of the file, which is read from the offset without moving its position.
+         * @param offset The offset of the first byte to send.
+         * @param size The number of bytes to send.
+         * @throws std::runtime_error If the socket is not open, the file ends early, the send fails or the timeout elapses.
+         */
+        void send_file(int fd, unsigned long long offset, unsigned long long size);
+
+        /**
+         * @brief Returns whether records sent on this connection are encrypted by the kernel, which lets send_file()
+         * hand the file to the kernel as on a plain connection.
+         */
+        [[nodiscard]] bool is_kernel_tls() const;
+
+        /**
+         * @brief Returns the protocol the server picked with ALPN during the handshake, e.g. "h2".
+         * @return The protocol, empty if the connection isn't secure or none was negotiated.
+         */
+        [[nodiscard]] std::string get_alpn_protocol() const;
+
         /**
          * @brief Receives data from the TCP connection.
          *
          * This method reads the data from the TCP connection and returns it as a string.
          *
+         * On Unix this waits for data to arrive and returns whatever is available, up to buffer_size bytes.
+         * An empty string means the peer closed the connection. If an SSL session is active the data is read through it.
+         *
          * @param buffer_size The size of the receive buffer.
          * @return A string containing the received data.
-         * @throws std::runtime_error If the socket is not open.
+         * @throws std::runtime_error If the socket is not open, the read fails or the timeout elapses.
          */
         std::string receive(const unsigned long long buffer_size);
 
+        /**
+         * @brief Receives data from the TCP connection directly into a caller supplied buffer.
+         *
+         * This waits for data to arrive and copies whatever is available, up to buffer_size bytes, without any
+         * intermediate allocation. If an SSL session is active the data is read through it.
+         *
+         * @param buffer The buffer to receive into.
+         * @param buffer_size The size of the buffer.
+         * @return The number of bytes received, 0 if the peer closed the connection.
+         * @throws std::runtime_error If the socket is not open, the read fails or the timeout elapses.
+         */
+        size_t receive(char *buffer, unsigned long long buffer_size);
+
+        /**
+         * @brief Receives data from the TCP connection into the free space of a pooled buffer.
+         *
+         * The bytes received are added to the size of the buffer, so it can be handed on without copying.
+         *
+         * @param buffer The buffer to receive into, with available() bytes free.
+         * @return The number of bytes received, 0 if the peer closed the connection or the buffer is full.
+         * @throws std::runtime_error If the socket is not open, the read fails or the timeout elapses.
+         */
+        size_t receive(io_buffer &buffer);
+
         /**
          * @brief Closes the TCP connection.
          *
          * This method closes the TCP connection by performing the necessary cleanup tasks.
-         * If the connection uses SSL on port 443, it performs the SSL shutdown and frees the SSL context.
+         * If the connection uses SSL, it performs the SSL shutdown and releases its reference to the shared SSL context.
          * For Windows systems, it also closes the socket and performs the necessary cleanup.
          *
          * @note The close method will only close the connection if it is currently open.
@@ -136,6 +422,16 @@ namespace cnet
          */
         void close();
 
+        /**
+         * @brief Checks, without blocking, whether the connection is still usable.
+         *
+         * A connection is no longer usable once the peer has closed it, or when unexpected plain data is waiting on it.
+         * This is used before an idle keep-alive connection is reused.
+         *
+         * @return True if the connection is open and the peer has not closed it, false otherwise.
+         */
+        [[nodiscard]] bool is_connected() const;
+
         /**
          * @brief Returns the socket file descriptor.
          *
@@ -144,6 +440,20 @@ namespace cnet
          * @return The socket file descriptor.
          */
         [[nodiscard]] unsigned long long get_sock() const { return sock; }
+
+        /**
+         * @brief Sets the timeout used by send and receive operations.
+         *
+         * @param timeout The timeout in milliseconds.
+         */
+        void set_timeout(const unsigned int timeout) { this->timeout = timeout; }
+
+        /**
+         * @brief Returns the timeout used by send and receive operations.
+         *
+         * @return The timeout in milliseconds.
+         */
+        [[nodiscard]] unsigned int get_timeout() const { return timeout; }
     };
 } // cnet
 
@@ -0,0 +1,151 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#ifndef TLS_CONTEXT_H
+#define TLS_CONTEXT_H
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "openssl/ssl.h"
+
+namespace cnet
+{
+    /**
+     * @brief The TLS configuration shared by every connection that uses the same tls_context.
+     */
+    struct tls_options
+    {
+        /**
+         * @brief Whether the certificate of the server is verified against the trusted certificate authorities and the host name.
+         */
+        bool verify_peer = false;
+        /**
+         * @brief A PEM file of trusted certificate authorities, the system defaults are used when this is empty.
+         */
+        std::string ca_file;
+        /**
+         * @brief The maximum number of sessions kept for resumption, one per host and port.
+         */
+        size_t max_sessions = 1024;
+        /**
+         * @brief Whether records are handed to the kernel to encrypt once the handshake is done, where OpenSSL and the
+         * kernel's tls module support the negotiated cipher. This is what lets file uploads over TLS use sendfile().
+         */
+        bool kernel_tls = true;
+        /**
+         * @brief The protocols offered with ALPN in order of preference, e.g. {"h2", "http/1.1"}, none when empty.
+         */
+        std::vector<std::string> alpn;
+    };
+
+    /**
+     * @brief Counters describing the handshakes made with a tls_context.
+     */
+    struct tls_stats
+    {
+        /**
+         * @brief The number of completed handshakes.
+         */
+        unsigned long long handshakes = 0;
+        /**
+         * @brief The number of handshakes that resumed a cached session.
+         */
+        unsigned long long resumed = 0;
+
+        /**
+         * @brief Returns the fraction of handshakes that resumed a session.
+         *
+         * @return A value between 0 and 1, or 0 if no handshake has been made.
+         */
+        [[nodiscard]] double resumption_rate() const { return handshakes == 0 ? 0 : static_cast<double>(resumed) / static_cast<double>(handshakes); }
+    };
+
+    /**
+     * @brief A process-wide SSL_CTX together with a client-side session cache keyed by host and port.
+     *
+     * Creating an SSL_CTX is expensive and a context that is freed after every connection can never resume a session,
+     * so one context is shared by every connection with the same tls_options. When a connection to a host:port is made
+     * again, the last session ticket or session id received from it is offered, allowing an abbreviated handshake.
+     * @code{.cpp}
+     * auto context = cnet::tls_context::get();
+     * printf("%f\n", context->get_stats().resumption_rate());
+     * @endcode
+     */
+    class tls_context
+    {
+    private:
+        tls_options options;
+        SSL_CTX *context = nullptr;
+        std::map<std::string, SSL_SESSION *> sessions;
+        std::mutex mutex;
+
+        std::atomic<unsigned long long> handshakes = 0;
+        std::atomic<unsigned long long> resumed = 0;
+
+        static int on_new_session(SSL *ssl, SSL_SESSION *session);
+
+    public:
+        /**
+         * @brief Creates a context with the given options, use get() to share one instead.
+         *
+         * @param options The TLS configuration.
+         * @throws std::runtime_error If the SSL context can't be created.
+         */
+        explicit tls_context(tls_options options);
+
+        ~tls_context();
+
+        tls_context(const tls_context &) = delete;
+        tls_context &operator=(const tls_context &) = delete;
+
+        /**
+         * @brief Returns the process-wide context for the given options, creating it on first use.
+         *
+         * @param options The TLS configuration.
+         * @return The shared context.
+         */
+        static std::shared_ptr<tls_context> get(const tls_options &options = {});
+
+        /**
+         * @brief Creates an SSL object for a connection to host:port, offering a cached session if there is one.
+         *
+         * @param host The host name, also used for SNI and, when verify_peer is set, host name verification.
+         * @param port The port of the connection.
+         * @return The SSL object, owned by the caller.
+         * @throws std::runtime_error If the SSL object can't be created.
+         */
+        SSL *create_ssl(const std::string &host, unsigned int port);
+
+        /**
+         * @brief Records the outcome of a completed handshake.
+         *
+         * @param ssl The SSL object created by create_ssl().
+         */
+        void record_handshake(SSL *ssl);
+
+        /**
+         * @brief Drops every cached session.
+         */
+        void clear_sessions();
+
+        /**
+         * @brief Returns the handshake counters of this context.
+         *
+         * @return A snapshot of the counters.
+         */
+        [[nodiscard]] tls_stats get_stats() const;
+
+        /**
+         * @brief Returns the underlying OpenSSL context.
+         *
+         * @return The SSL_CTX, owned by this object.
+         */
+        [[nodiscard]] SSL_CTX *native() const { return context; }
+    };
+} // cnet
+
+#endif //TLS_CONTEXT_H
@@ -1,7 +1,12 @@
 ﻿#ifndef URI_H
 #define URI_H
+#include <cstdint>
 #include <map>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #define MAX_PORT 65535
 #define MIN_PORT 0
@@ -16,15 +21,48 @@
 
 namespace cnet
 {
+    /**
+     * @brief A URI as defined by RFC 3986, scheme://userinfo@host:port/path?query#fragment.
+     *
+     * The uri owns a single buffer with the whole text and only records where each component starts and ends in it, so
+     * parsing doesn't copy the components and the getters hand out views into the buffer. The views are valid until the
+     * uri is changed, assigned to or destroyed.
+     */
     class uri
     {
     private:
-        std::string host;
-        std::string path = "/";
-        std::string scheme = "http";
-        std::string fragment; // after #
-        unsigned int port = ~0;
-        std::map<std::string, std::string> parameters;
+        /**
+         * @brief Where a component is in the buffer.
+         */
+        struct span
+        {
+            uint32_t offset = 0;
+            uint32_t size = 0;
+        };
+
+        std::string text;
+        span scheme;
+        span userinfo;
+        span host; // without the brackets of an IP literal
+        span authority; // host and port, as written
+        span path;
+        span query; // after ?
+        span fragment; // after #
+        unsigned int port = HTTP_PORT;
+        // whether the port was given rather than the default of the scheme
+        bool explicit_port = false;
+        bool has_authority = false;
+        std::vector<std::pair<span, span>> parameters;
+
+        [[nodiscard]] std::string_view view(const span &component) const { return {text.data() + component.offset, component.size}; }
+
+        bool parse(std::string url);
+
+        void split_parameters();
+
+        void assemble(std::string_view new_scheme, std::string_view new_userinfo, std::string_view new_host, std::string_view new_path, std::string_view new_query, std::string_view new_fragment);
+
+        static unsigned int get_default_port(std::string_view scheme);
 
     public:
         /**
@@ -49,8 +87,8 @@ namespace cnet
         /**
          * @brief Adds a parameter to the URI.
          *
-         * This method adds a key-value parameter to the URI. The parameter will be included in the URI's query string.
-         * If the parameter key already exists, the previous value will be replaced.
+         * This method adds a key-value parameter to the end of the URI's query string. A key may be added more than once,
+         * every value is kept in the order they were added.
          *
          * @param key The key of the parameter. It should be a non-empty string.
          * @param value The value of the parameter. It can be any string.
@@ -141,7 +179,7 @@ namespace cnet
          * \param key The key of the parameter.
          * \param value The value of the parameter. Can be either a string or a C-style string.
          *
-         * \note If the parameter with the same key already exists, its value will be overwritten.
+         * \note If the parameter with the same key already exists, both values are kept.
          */
         void add_parameter(const std::string &key, const char *value);
 
@@ -248,18 +286,18 @@ namespace cnet
         void set_port(int port);
 
         /**
-         * Sets the scheme of the URI.
+         * Sets the scheme of the URI. A port that wasn't set follows the default of the new scheme.
          *
          * @param scheme The scheme to set.
          */
-        void set_scheme(std::string scheme);
+        void set_scheme(std::string_view scheme);
 
         /**
          * Sets the host of the URI.
          *
-         * @param host The host to set.
+         * @param host The host to set, an IPv6 address without brackets.
          */
-        void set_host(std::string host);
+        void set_host(std::string_view host);
 
         /**
          * @brief Sets the path of the URL.
@@ -270,14 +308,14 @@ namespace cnet
          *
          * @return None.
          */
-        void set_path(std::string path);
+        void set_path(std::string_view path);
 
         /**
          * Sets the fragment of the URI.
          *
          * @param fragment The fragment string to set.
          */
-        void set_fragment(std::string fragment);
+        void set_fragment(std::string_view fragment);
 
         /**
          * @brief Sets the parameters of the URI.
@@ -287,30 +325,43 @@ namespace cnet
          *
          * @param parameters The parameters to set. The keys and values should be of type std::string.
          */
-        void set_parameters(std::map<std::string, std::string> parameters);
+        void set_parameters(const std::map<std::string, std::string> &parameters);
 
         /**
-         * Returns the host component of the URI.
+         * Returns the host component of the URI, lowercase. An IP literal is returned without its brackets, e.g. ::1.
          *
-         * @return The host component of the URI as a string.
+         * @return The host component of the URI.
          */
-        std::string get_host();
+        [[nodiscard]] std::string_view get_host() const;
+
+        /**
+         * @brief Returns the host and the port as sent in the Host header, e.g. example.com:8080 or [::1].
+         *
+         * The port is left out when it is the default of the scheme.
+         */
+        [[nodiscard]] std::string_view get_authority() const;
+
+        /**
+         * @brief Returns the userinfo component of the URI, the part before the @ of the authority.
+         */
+        [[nodiscard]] std::string_view get_userinfo() const;
 
         /**
          * @brief Get the path component of the URI.
          *
          * The path component of a URI is the part after the hostname and before any query parameters or fragment identifier.
+         * The empty path of a URI with a host is returned as /.
          *
          * @return The path component of the URI.
          */
-        std::string get_path();
+        [[nodiscard]] std::string_view get_path() const;
 
         /**
          * Returns the scheme of the URI.
          *
-         * @return The scheme of the URI.
+         * @return The scheme of the URI, lowercase.
          */
-        std::string get_scheme();
+        [[nodiscard]] std::string_view get_scheme() const;
 
         /**
          * Returns the port number of the URI.
@@ -327,26 +378,32 @@ namespace cnet
          *
          * @return The fragment of the URI.
          */
-        std::string get_fragment();
+        [[nodiscard]] std::string_view get_fragment() const;
+
+        /**
+         * Get the parameters of the URI, in the order they appear in the query string. A key that appears more than once
+         * has an entry for each of its values. The keys and values are as written, not percent-decoded.
+         *
+         * @return The key-value pairs of the query string.
+         */
+        [[nodiscard]] std::vector<std::pair<std::string_view, std::string_view>> get_parameters() const;
 
         /**
-         * Get the parameters of the URI.
+         * @brief Returns the value of the first parameter with a key.
          *
-         * @return A map containing the parameters of the URI.
+         * @return The value, or nothing if no parameter has the key.
          */
-        std::map<std::string, std::string> get_parameters();
+        [[nodiscard]] std::optional<std::string_view> get_parameter(std::string_view key) const;
 
         /**
          * @brief Retrieves the parameter query string for the uri object.
          *
-         * This method constructs a parameter query string by concatenating the key-value pairs from the parameters map.
-         * The keys are separated from the values by an equal sign (=), and each key-value pair is separated by an ampersand (&).
-         * The order of the parameters in the query string is reversed compared to the order in the parameters map.
-         * If the parameters map is empty, an empty string is returned.
+         * The query string starts with a question mark (?), the keys are separated from the values by an equal sign (=),
+         * and each key-value pair is separated by an ampersand (&). If there are no parameters, an empty string is returned.
          *
          * @return The parameter query string for the uri object.
          */
-        std::string get_parameter_query();
+        [[nodiscard]] std::string_view get_parameter_query() const;
 
         /**
          * @brief Clear all parameters in the URI object.
@@ -359,20 +416,21 @@ namespace cnet
         /**
          * Convert the URI object to a string representation.
          *
-         * The resulting string is in the format: {scheme}://{host}:{port}{path}?{parameters}#{fragment}.
-         * If the default value of any component (e.g., scheme, port, path, etc.) is used, it will not be included in the string.
+         * The resulting string is in the format: {scheme}://{userinfo}@{host}:{port}{path}?{parameters}#{fragment}.
+         * A parsed URI is returned as it was given, with the scheme and host in lowercase. Once changed, components that
+         * are empty or the default of the scheme, like the port, are left out.
          *
          * @return The URI as a string.
          */
-        std::string to_string();
+        [[nodiscard]] const std::string &to_string() const;
 
         /**
          * @brief Validates a URL.
          *
-         * This method checks if a given URL is valid. The URL must have a scheme
-         * followed by a colon and a path. The scheme must contain at least one
-         * character and can only consist of alphanumeric characters, plus (+),
-         * minus (-), and dot (.) characters. The path must not be empty.
+         * This method checks if a given URL is a valid URI as defined by RFC 3986. The URL must have a scheme
+         * followed by a colon. The scheme must start with a letter and can only consist of alphanumeric
+         * characters, plus (+), minus (-), and dot (.) characters. Every other component may only contain the
+         * characters RFC 3986 allows in it, others must be percent-encoded. The port must be at most MAX_PORT.
          *
          * @param uri The URL to validate.
          * @return Returns true if the URL is valid, false otherwise.
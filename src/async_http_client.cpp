@@ -0,0 +1,614 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "async_http_client.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+#include <sys/epoll.h>
+#ifdef CNET_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+#include "content_decoder.h"
+#include "http_client.h"
+#include "http_request_serializer.h"
+#include "http_response_parser.h"
+
+namespace cnet
+{
+    // smaller than the blocking client's buffer, thousands of these are in use at once
+    static constexpr size_t receive_buffer_size = 8192;
+    // the least free space a read asks the parser for, the read then fills whatever is free in the buffer
+    static constexpr size_t receive_minimum = 2048;
+
+    static buffer_pool &get_receive_pool()
+    {
+        // never destroyed, like the default pool, so parsers of requests still alive at exit can give their buffers back
+        static auto *pool = new buffer_pool(receive_buffer_size);
+        return *pool;
+    }
+
+    static bool is_idempotent(const http_method method)
+    {
+        return method != http_method::POST && method != http_method::PATCH && method != http_method::CONNECT;
+    }
+
+    struct async_http_client::request_state
+    {
+        enum class phase
+        {
+            resolving,
+            connecting,
+            handshaking,
+            sending,
+            receiving,
+        };
+
+        // the request as submitted, which the serializer points into, and the message that receives the response
+        http_message request;
+        http_message message;
+        response_handler handler;
+        body_sink *sink;
+        std::string key;
+        std::string host;
+        unsigned int port = 0;
+        bool secure = false;
+        bool request_close = false;
+        http_request_serializer serializer;
+        bool prepared = false;
+        // decodes the body on its way to the sink or the message, made anew for each attempt
+        std::optional<decoding_sink> decoder;
+
+        tcp_client connection;
+        int fd = -1;
+        // the sockets racing to connect, watched on readiness or, with io_uring, each with its fixed file slot
+        std::vector<int> attempts;
+        std::vector<std::pair<int, int>> ring_attempts;
+        unsigned long long attempt_timer = 0;
+        int slot = -1;
+        unsigned long long receive = 0;
+        // bumped whenever the request lets go of its connection, completions of earlier operations are then ignored
+        unsigned long long epoch = 0;
+        uint32_t events = 0;
+        phase step = phase::connecting;
+        bool reused = false;
+        bool retried = false;
+        bool started = false;
+        unsigned long long body_size = 0;
+        http_response_parser parser{get_receive_pool()};
+
+        unsigned long long timer = 0;
+        std::chrono::steady_clock::time_point last_activity;
+    };
+
+    async_http_client::async_http_client(event_loop &loop, async_http_client_options options): loop(loop), options(std::move(options))
+    {
+        tls = tls_context::get(this->options.tls);
+        host_resolver = this->options.host_resolver != nullptr ? this->options.host_resolver : resolver::get_default();
+        if (this->options.max_connections_per_host == 0) this->options.max_connections_per_host = 1;
+    }
+
+    async_http_client::~async_http_client()
+    {
+        for (auto &[key, host]: hosts)
+        {
+            for (idle_connection &idle: host.idle)
+            {
+#ifdef CNET_IO_URING
+                if (idle.slot >= 0) loop.release_file(idle.slot);
+#endif
+                idle.connection.close();
+            }
+        }
+    }
+
+    void request_awaiter::start(std::function<void()> resume)
+    {
+        client.make_request(std::move(message), [this, resume = std::move(resume)](http_message &response, std::exception_ptr failure)
+        {
+            message = std::move(response);
+            error = std::move(failure);
+            resume();
+        });
+    }
+
+    http_message request_awaiter::await_resume()
+    {
+        if (error != nullptr) std::rethrow_exception(error);
+        return std::move(message);
+    }
+
+    void async_http_client::make_request(http_message message, response_handler handler)
+    {
+        submit(std::move(message), nullptr, std::move(handler));
+    }
+
+    void async_http_client::make_request(http_message message, body_sink &sink, response_handler handler)
+    {
+        submit(std::move(message), &sink, std::move(handler));
+    }
+
+    void async_http_client::submit(http_message &&message, body_sink *sink, response_handler &&handler)
+    {
+        auto state = std::make_shared<request_state>();
+        state->message = http_message(message.url, message.method);
+        state->request = std::move(message);
+        state->handler = std::move(handler);
+        state->sink = sink;
+        ++in_flight;
+        loop.post([this, state] { start(state); });
+    }
+
+    void async_http_client::start(const std::shared_ptr<request_state> &state)
+    {
+        try
+        {
+            if (!state->prepared)
+            {
+                http_message &message = state->request;
+                http_client::validate(message);
+                state->host = std::string(message.url.get_host());
+                state->port = message.url.get_port();
+                state->secure = message.url.get_scheme() == "https" || state->port == 443;
+                state->key = connection_pool::make_key(message.url.get_scheme(), state->host, state->port);
+                const std::optional<std::string_view> connection_header = message.find_header("Connection");
+                state->request_close = connection_header.has_value() && http_response_parser::has_token(*connection_header, "close");
+                state->serializer.reset(message, false, nullptr, options.decode_content ? content_decoder::get_accept_encoding() : std::string());
+                state->prepared = true;
+            }
+            state->parser.reset();
+            state->parser.set_head_request(state->message.method == http_method::HEAD);
+            state->serializer.rewind();
+            state->started = false;
+            state->body_size = 0;
+            state->message.body.clear();
+            state->decoder.reset();
+            if (options.decode_content && state->message.method != http_method::HEAD) state->decoder.emplace(state->sink, &state->message.body);
+
+            host_state &host = hosts[state->key];
+            state->reused = false;
+            state->slot = -1;
+            while (!host.idle.empty())
+            {
+                idle_connection idle = host.idle.back();
+                host.idle.pop_back();
+                // a connection driven by completions learns that the server closed it from its receive, which fails
+                // an idempotent request into a retry, so the poll of is_connected() is only needed for the others
+                if ((idle.slot >= 0 && is_idempotent(state->message.method)) || idle.connection.is_connected())
+                {
+                    state->connection = idle.connection;
+                    state->slot = idle.slot;
+                    state->reused = true;
+                    break;
+                }
+#ifdef CNET_IO_URING
+                if (idle.slot >= 0) loop.release_file(idle.slot);
+#endif
+                idle.connection.close();
+                host.open--;
+            }
+            if (!state->reused)
+            {
+                if (host.open >= options.max_connections_per_host)
+                {
+                    host.waiting.push_back(state);
+                    return;
+                }
+                // the lookup holds a connection of the host, so the limit also bounds the lookups running for it
+                host.open++;
+                state->step = request_state::phase::resolving;
+                state->last_activity = std::chrono::steady_clock::now();
+                arm_timer(state, options.timeout);
+                lookup(state);
+                return;
+            }
+        } catch (...)
+        {
+            state->handler(state->message, std::current_exception());
+            --in_flight;
+            return;
+        }
+
+        state->step = request_state::phase::sending;
+        state->last_activity = std::chrono::steady_clock::now();
+        arm_timer(state, options.timeout);
+#ifdef CNET_IO_URING
+        if (state->slot >= 0)
+        {
+            send_ring(state);
+            return;
+        }
+#endif
+        state->fd = static_cast<int>(state->connection.get_sock());
+        state->events = EPOLLOUT;
+        loop.watch(state->fd, state->events, [this, state](uint32_t)
+        {
+            state->last_activity = std::chrono::steady_clock::now();
+            advance(state);
+        });
+        advance(state);
+    }
+
+    void async_http_client::lookup(const std::shared_ptr<request_state> &state)
+    {
+        const unsigned long long epoch = state->epoch;
+        // answered inline from the cache or later on a resolver thread, either way the connect starts on the loop's thread
+        host_resolver->resolve_async(state->host, [this, state, epoch](resolution answer, std::exception_ptr error)
+        {
+            loop.post([this, state, epoch, answer = std::move(answer), error = std::move(error)]
+            {
+                if (state->epoch != epoch) return;
+                if (error != nullptr)
+                {
+                    fail(state, error);
+                    return;
+                }
+                start_connect(state, answer.addresses);
+            });
+        });
+    }
+
+    void async_http_client::start_connect(const std::shared_ptr<request_state> &state, const std::vector<endpoint> &addresses)
+    {
+        state->step = request_state::phase::connecting;
+        state->last_activity = std::chrono::steady_clock::now();
+        try
+        {
+#ifdef CNET_IO_URING
+            // TLS stays on readiness, OpenSSL does its own reads and writes on the socket
+            if (!state->secure && loop.supports_completions() && loop.get_free_files() > 0)
+            {
+                state->connection = tcp_client::prepare_connect(state->host, state->port, addresses, options.timeout);
+                connect_ring(state);
+                return;
+            }
+#endif
+            state->connection = tcp_client::start_connect(state->host, state->port, addresses, options.timeout);
+            watch_attempts(state);
+        } catch (...)
+        {
+            fail(state, std::current_exception());
+        }
+    }
+
+    void async_http_client::watch_attempts(const std::shared_ptr<request_state> &state)
+    {
+        loop.watch_all(state->attempts, state->connection.get_attempts(), EPOLLOUT, [this, state](uint32_t)
+        {
+            state->last_activity = std::chrono::steady_clock::now();
+            advance(state);
+        });
+        // a slow connect is joined by the next address even though none of the sockets became ready
+        if (const int delay = state->connection.get_attempt_delay(); delay >= 0 && state->attempt_timer == 0)
+        {
+            state->attempt_timer = loop.add_timer(static_cast<unsigned int>(delay), [this, state]
+            {
+                state->attempt_timer = 0;
+                advance(state);
+            });
+        }
+    }
+
+    void async_http_client::arm_timer(const std::shared_ptr<request_state> &state, const unsigned int delay)
+    {
+        state->timer = loop.add_timer(delay, [this, state]
+        {
+            state->timer = 0;
+            const auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - state->last_activity);
+            if (idle.count() < options.timeout)
+            {
+                // there was progress since the timer was armed, so only wait for what is left of the timeout
+                arm_timer(state, options.timeout - static_cast<unsigned int>(idle.count()));
+                return;
+            }
+            fail(state, std::make_exception_ptr(std::runtime_error("Timed out waiting for " + state->host + ":" + std::to_string(state->port))));
+        });
+    }
+
+    void async_http_client::watch(const std::shared_ptr<request_state> &state, const io_wait wait)
+    {
+        const uint32_t events = wait == io_wait::read ? EPOLLIN : EPOLLOUT;
+        if (events == state->events) return;
+        state->events = events;
+        loop.modify(state->fd, events);
+    }
+
+    void async_http_client::advance(const std::shared_ptr<request_state> &state)
+    {
+        try
+        {
+            while (true)
+            {
+                io_wait wait = io_wait::none;
+                switch (state->step)
+                {
+                    case request_state::phase::resolving:
+                        return;
+                    case request_state::phase::connecting:
+                    {
+                        if (!state->connection.finish_connect())
+                        {
+                            watch_attempts(state);
+                            return;
+                        }
+                        // the winning socket stays watched, the attempts that lost were closed
+                        const int fd = static_cast<int>(state->connection.get_sock());
+                        for (const int attempt: state->attempts)
+                        {
+                            if (attempt != fd) loop.unwatch(attempt);
+                        }
+                        state->attempts.clear();
+                        if (state->attempt_timer != 0) loop.cancel_timer(state->attempt_timer);
+                        state->attempt_timer = 0;
+                        state->fd = fd;
+                        state->events = EPOLLOUT;
+                        state->step = state->secure ? request_state::phase::handshaking : request_state::phase::sending;
+                        break;
+                    }
+                    case request_state::phase::handshaking:
+                        if (!state->connection.try_ssl_handshake(wait, tls))
+                        {
+                            watch(state, wait);
+                            return;
+                        }
+                        state->step = request_state::phase::sending;
+                        break;
+                    case request_state::phase::sending:
+                        state->serializer.consume(state->connection.try_send(state->serializer.data(), state->serializer.count(), wait));
+                        if (wait != io_wait::none)
+                        {
+                            watch(state, wait);
+                            return;
+                        }
+                        if (state->serializer.empty()) state->step = request_state::phase::receiving;
+                        break;
+                    case request_state::phase::receiving:
+                    {
+                        http_response_parser &parser = state->parser;
+                        char *space = parser.prepare(receive_minimum);
+                        const size_t received = state->connection.try_receive(space, parser.available(), wait);
+                        if (received == 0 && wait != io_wait::none)
+                        {
+                            watch(state, wait);
+                            return;
+                        }
+                        if (received == 0) parser.finish();
+                        else parser.commit(received);
+                        if (deliver(state)) return;
+                        break;
+                    }
+                }
+            }
+        } catch (...)
+        {
+            fail(state, std::current_exception());
+        }
+    }
+
+    bool async_http_client::deliver(const std::shared_ptr<request_state> &state)
+    {
+        http_response_parser &parser = state->parser;
+        if (!parser.headers_complete()) return false;
+
+        body_sink *sink = state->decoder.has_value() ? &*state->decoder : state->sink;
+        if (!state->started)
+        {
+            state->started = true;
+            parser.copy_headers(state->message);
+            if (sink != nullptr) sink->start(state->message);
+        }
+        for (std::string_view chunk; parser.next_body(chunk);)
+        {
+            state->body_size += chunk.size();
+            if (sink != nullptr) sink->write(chunk);
+            else state->message.body.append(chunk);
+        }
+        if (!parser.is_complete()) return false;
+        complete(state);
+        return true;
+    }
+
+#ifdef CNET_IO_URING
+    void async_http_client::connect_ring(const std::shared_ptr<request_state> &state)
+    {
+        endpoint address;
+        const int fd = state->connection.open_attempt(address);
+        const unsigned long long epoch = state->epoch;
+        const int slot = loop.submit_connect(fd, reinterpret_cast<const sockaddr *>(&address.address), address.length, [this, state, epoch, fd](const int result, uint32_t)
+        {
+            if (state->epoch != epoch) return;
+            // the attempts that lost the race were dropped when the winner connected
+            const auto attempt = std::find_if(state->ring_attempts.begin(), state->ring_attempts.end(), [fd](const std::pair<int, int> &pending) { return pending.first == fd; });
+            if (attempt == state->ring_attempts.end()) return;
+            const int slot = attempt->second;
+            state->ring_attempts.erase(attempt);
+            state->last_activity = std::chrono::steady_clock::now();
+            try
+            {
+                if (!state->connection.complete_attempt(fd, -result))
+                {
+                    // refused, the next address is tried at once on a new socket and slot
+                    loop.release_file(slot);
+                    if (state->connection.has_next_address()) connect_ring(state);
+                    return;
+                }
+                for (const auto &[loser, loser_slot]: state->ring_attempts)
+                {
+                    loop.release_file(loser_slot);
+                }
+                state->ring_attempts.clear();
+                if (state->attempt_timer != 0) loop.cancel_timer(state->attempt_timer);
+                state->attempt_timer = 0;
+                state->slot = slot;
+                state->step = request_state::phase::sending;
+                send_ring(state);
+            } catch (...)
+            {
+                fail(state, std::current_exception());
+            }
+        });
+        state->ring_attempts.emplace_back(fd, slot);
+
+        // a slow connect is joined by the next address
+        if (state->connection.has_next_address() && state->attempt_timer == 0)
+        {
+            state->attempt_timer = loop.add_timer(CNET_CONNECTION_ATTEMPT_DELAY, [this, state]
+            {
+                state->attempt_timer = 0;
+                // the attempt that armed the timer may have failed at once and been replaced by the last address
+                if (!state->connection.has_next_address()) return;
+                try
+                {
+                    connect_ring(state);
+                } catch (...)
+                {
+                    fail(state, std::current_exception());
+                }
+            });
+        }
+    }
+
+    void async_http_client::send_ring(const std::shared_ptr<request_state> &state)
+    {
+        const unsigned long long epoch = state->epoch;
+        loop.submit_send(state->slot, state->serializer.data(), state->serializer.count(), [this, state, epoch](const int result, uint32_t)
+        {
+            if (state->epoch != epoch) return;
+            state->last_activity = std::chrono::steady_clock::now();
+            if (result < 0)
+            {
+                fail(state, std::make_exception_ptr(std::runtime_error("Error at send(): " + std::string(strerror(-result)))));
+                return;
+            }
+            state->serializer.consume(static_cast<size_t>(result));
+            if (!state->serializer.empty())
+            {
+                send_ring(state);
+                return;
+            }
+            state->step = request_state::phase::receiving;
+            receive_ring(state);
+        });
+    }
+
+    void async_http_client::receive_ring(const std::shared_ptr<request_state> &state)
+    {
+        const unsigned long long epoch = state->epoch;
+        state->receive = loop.submit_receive(state->slot, [this, state, epoch](const int result, const uint32_t flags)
+        {
+            if (state->epoch != epoch) return;
+            state->last_activity = std::chrono::steady_clock::now();
+            try
+            {
+                // every provided buffer is in use, they are handed back as soon as their handlers return
+                if (result == -ENOBUFS)
+                {
+                    if ((flags & IORING_CQE_F_MORE) == 0) receive_ring(state);
+                    return;
+                }
+                if (result < 0) throw std::runtime_error("Error at recv(): " + std::string(strerror(-result)));
+
+                http_response_parser &parser = state->parser;
+                if (result == 0) parser.finish();
+                else parser.feed(loop.get_buffer(result, flags));
+                if (deliver(state)) return;
+                if (result == 0) throw std::runtime_error("Connection closed before the response was complete");
+                if ((flags & IORING_CQE_F_MORE) == 0) receive_ring(state);
+            } catch (...)
+            {
+                fail(state, std::current_exception());
+            }
+        });
+    }
+#endif
+
+    void async_http_client::complete(const std::shared_ptr<request_state> &state)
+    {
+        const http_response_parser &parser = state->parser;
+        if (!parser.find_header("Content-Length").has_value()) state->message.content_length = state->body_size;
+        if (state->decoder.has_value())
+        {
+            state->decoder->finish();
+            state->decoder->apply(state->message);
+        } else if (state->sink != nullptr) state->sink->finish();
+        // anything left over means the server sent more than one response, the connection can't be trusted anymore
+        detach(state, parser.keep_alive() && parser.leftover() == 0 && !state->request_close);
+        --in_flight;
+        state->handler(state->message, nullptr);
+    }
+
+    void async_http_client::fail(const std::shared_ptr<request_state> &state, std::exception_ptr error)
+    {
+        const bool reused = state->reused;
+        detach(state, false);
+
+        // an idle connection may have been closed by the server just before it was reused, so try once more on a new
+        // one, unless part of the response has already been handed out
+        if (reused && !state->retried && is_idempotent(state->message.method) && !state->parser.headers_complete())
+        {
+            state->retried = true;
+            start(state);
+            return;
+        }
+        --in_flight;
+        state->handler(state->message, std::move(error));
+    }
+
+    void async_http_client::detach(const std::shared_ptr<request_state> &state, const bool reusable)
+    {
+        loop.unwatch(state->fd);
+        state->fd = -1;
+        for (const int attempt: state->attempts)
+        {
+            loop.unwatch(attempt);
+        }
+        state->attempts.clear();
+        if (state->timer != 0) loop.cancel_timer(state->timer);
+        state->timer = 0;
+        if (state->attempt_timer != 0) loop.cancel_timer(state->attempt_timer);
+        state->attempt_timer = 0;
+        state->epoch++;
+#ifdef CNET_IO_URING
+        for (const auto &[attempt, slot]: state->ring_attempts)
+        {
+            loop.release_file(slot);
+        }
+        state->ring_attempts.clear();
+#endif
+
+        host_state &host = hosts[state->key];
+        if (reusable && host.idle.size() < options.max_idle_per_host)
+        {
+#ifdef CNET_IO_URING
+            // the connection keeps its slot while idle, only the receive still armed on it is stopped
+            if (state->receive != 0) loop.cancel(state->receive);
+#endif
+            host.idle.push_back({state->connection, state->slot});
+        } else
+        {
+#ifdef CNET_IO_URING
+            if (state->slot >= 0) loop.release_file(state->slot);
+#endif
+            state->connection.close();
+            host.open--;
+        }
+        state->connection = tcp_client();
+        state->slot = -1;
+        state->receive = 0;
+
+        // a connection slot or an idle connection is now free for the next request waiting on this host
+        if (!host.waiting.empty())
+        {
+            const std::shared_ptr<request_state> next = host.waiting.front();
+            host.waiting.pop_front();
+            loop.post([this, next] { start(next); });
+        }
+    }
+} // cnet
@@ -0,0 +1,190 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "async_socket.h"
+
+#include <stdexcept>
+
+#include <sys/epoll.h>
+
+namespace cnet
+{
+    bool socket_awaiter::await_ready()
+    {
+        try
+        {
+            return operation(wait, result);
+        } catch (...)
+        {
+            error = std::current_exception();
+            return true;
+        }
+    }
+
+    void socket_awaiter::start(std::function<void()> resume)
+    {
+        socket.suspend(*this, std::move(resume));
+    }
+
+    size_t socket_awaiter::await_resume()
+    {
+        if (error != nullptr) std::rethrow_exception(error);
+        return result;
+    }
+
+    async_socket::async_socket(event_loop &loop, const unsigned int timeout, const tls_options &tls): loop(loop), timeout(timeout)
+    {
+        this->tls = tls_context::get(tls);
+    }
+
+    async_socket::~async_socket()
+    {
+        close();
+    }
+
+    socket_awaiter async_socket::connect(const std::string &host, const unsigned int port, const bool secure)
+    {
+        return {*this, [this, host, port, secure, started = false, connected = false](io_wait &wait, size_t &) mutable
+        {
+            if (!started)
+            {
+                close();
+                connection = tcp_client::start_connect(host, port, timeout);
+                started = true;
+            }
+            if (!connected)
+            {
+                if (!connection.finish_connect())
+                {
+                    wait = io_wait::write;
+                    return false;
+                }
+                connected = true;
+            }
+            return !secure || connection.try_ssl_handshake(wait, tls);
+        }};
+    }
+
+    socket_awaiter async_socket::read(char *buffer, const size_t size)
+    {
+        return {*this, [this, buffer, size](io_wait &wait, size_t &result)
+        {
+            result = connection.try_receive(buffer, size, wait);
+            return result > 0 || wait == io_wait::none;
+        }};
+    }
+
+    socket_awaiter async_socket::write(const char *data, const size_t size)
+    {
+        return {*this, [this, data, size](io_wait &wait, size_t &result)
+        {
+            while (result < size)
+            {
+                const size_t sent = connection.try_send(data + result, size - result, wait);
+                if (wait != io_wait::none) return false;
+                result += sent;
+            }
+            return true;
+        }};
+    }
+
+    void async_socket::close()
+    {
+        if (fd >= 0) loop.unwatch(fd);
+        fd = -1;
+        for (const int attempt: racing)
+        {
+            loop.unwatch(attempt);
+        }
+        racing.clear();
+        if (attempt_timer != 0) loop.cancel_timer(attempt_timer);
+        attempt_timer = 0;
+        connection.close();
+    }
+
+    void async_socket::suspend(socket_awaiter &awaiter, std::function<void()> resume)
+    {
+        if (pending != nullptr) throw std::runtime_error("An operation is already awaited on this socket");
+        pending = &awaiter;
+        this->resume = std::move(resume);
+        timer = loop.add_timer(timeout, [this]
+        {
+            timer = 0;
+            pending->error = std::make_exception_ptr(std::runtime_error("Timed out waiting for the socket"));
+            finish();
+        });
+        advance();
+    }
+
+    void async_socket::run()
+    {
+        try
+        {
+            if (pending->operation(pending->wait, pending->result))
+            {
+                finish();
+                return;
+            }
+        } catch (...)
+        {
+            pending->error = std::current_exception();
+            finish();
+            return;
+        }
+        advance();
+    }
+
+    void async_socket::advance()
+    {
+        // while connecting, every address raced is watched, and the next one is started after a delay
+        loop.watch_all(racing, connection.get_attempts(), EPOLLOUT, [this](uint32_t) { run(); });
+        if (!racing.empty())
+        {
+            if (const int delay = connection.get_attempt_delay(); delay >= 0 && attempt_timer == 0)
+            {
+                attempt_timer = loop.add_timer(static_cast<unsigned int>(delay), [this]
+                {
+                    attempt_timer = 0;
+                    run();
+                });
+            }
+            return;
+        }
+        if (attempt_timer != 0) loop.cancel_timer(attempt_timer);
+        attempt_timer = 0;
+
+        const int sock = static_cast<int>(connection.get_sock());
+        const uint32_t wanted = pending->wait == io_wait::read ? EPOLLIN : EPOLLOUT;
+        if (sock != fd)
+        {
+            if (fd >= 0) loop.unwatch(fd);
+            fd = sock;
+            events = wanted;
+            loop.watch(fd, events, [this](uint32_t) { run(); });
+        } else if (wanted != events)
+        {
+            events = wanted;
+            loop.modify(fd, events);
+        }
+    }
+
+    void async_socket::finish()
+    {
+        if (timer != 0) loop.cancel_timer(timer);
+        timer = 0;
+        if (fd >= 0) loop.unwatch(fd);
+        fd = -1;
+        for (const int attempt: racing)
+        {
+            loop.unwatch(attempt);
+        }
+        racing.clear();
+        if (attempt_timer != 0) loop.cancel_timer(attempt_timer);
+        attempt_timer = 0;
+        pending = nullptr;
+        // resuming may start the next operation, or destroy this socket, so it is the last thing done
+        const std::function<void()> next = std::move(resume);
+        next();
+    }
+} // cnet
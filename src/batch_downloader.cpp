@@ -0,0 +1,145 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "batch_downloader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "body_sink.h"
+
+namespace cnet
+{
+    double batch_result::latency(const double percentile) const
+    {
+        std::vector<double> latencies;
+        for (const batch_entry &entry: entries)
+        {
+            if (entry.is_sucess()) latencies.push_back(entry.seconds);
+        }
+        if (latencies.empty()) return 0;
+        std::sort(latencies.begin(), latencies.end());
+        const double rank = std::clamp(percentile, 0.0, 100.0) / 100 * static_cast<double>(latencies.size() - 1);
+        return latencies[static_cast<size_t>(rank + 0.5)];
+    }
+
+    batch_downloader::batch_downloader(batch_options options): options(std::move(options))
+    {
+        if (this->options.client.pool == nullptr) this->options.client.pool = std::make_shared<connection_pool>();
+        if (this->options.max_threads == 0) this->options.max_threads = 1;
+        if (this->options.max_per_host == 0) this->options.max_per_host = 1;
+    }
+
+    batch_result batch_downloader::run(const std::vector<batch_request> &requests)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        batch_result result;
+        result.entries.resize(requests.size());
+
+        struct host_group
+        {
+            std::deque<size_t> queued;
+            unsigned int active = 0;
+        };
+
+        // group the requests by the connection they would use, keeping their order within a host
+        std::map<std::string, host_group> groups;
+        for (size_t i = 0; i < requests.size(); i++)
+        {
+            const uri &url = requests[i].message.url;
+            result.entries[i].url = url.to_string();
+            groups[connection_pool::make_key(url.get_scheme(), url.get_host(), url.get_port())].queued.push_back(i);
+        }
+
+        std::mutex mutex;
+        std::condition_variable available;
+        size_t remaining = requests.size();
+
+        // takes the next request for the current host, or moves to the host with the most requests left that is below
+        // its concurrency limit, waiting while every host with requests left is at its limit
+        const auto next = [&](host_group *&current, size_t &index) -> bool
+        {
+            std::unique_lock lock(mutex);
+            if (current != nullptr) current->active--;
+            available.notify_all();
+            while (true)
+            {
+                if (current != nullptr && !current->queued.empty() && current->active < options.max_per_host)
+                {
+                    break;
+                }
+                current = nullptr;
+                for (auto &[key, group]: groups)
+                {
+                    if (group.queued.empty() || group.active >= options.max_per_host) continue;
+                    if (current == nullptr || group.queued.size() > current->queued.size()) current = &group;
+                }
+                if (current != nullptr) break;
+                if (remaining == 0) return false;
+                available.wait(lock);
+            }
+            index = current->queued.front();
+            current->queued.pop_front();
+            current->active++;
+            remaining--;
+            return true;
+        };
+
+        const auto worker = [&]
+        {
+            http_client client(options.client);
+            host_group *current = nullptr;
+            for (size_t index; next(current, index);)
+            {
+                const batch_request &request = requests[index];
+                batch_entry &entry = result.entries[index];
+                http_message message = request.message;
+                const auto sent = std::chrono::steady_clock::now();
+                try
+                {
+                    if (request.path.empty())
+                    {
+                        discard_sink sink;
+                        client.make_request(message, sink);
+                        entry.size = sink.get_size();
+                    } else
+                    {
+                        file_sink sink(request.path);
+                        client.make_request(message, sink);
+                        entry.size = sink.get_written();
+                    }
+                    entry.status_code = message.status_code;
+                } catch (std::exception &e)
+                {
+                    entry.error = e.what();
+                }
+                entry.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sent).count();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        const size_t count = std::min<size_t>(options.max_threads, requests.size());
+        for (size_t i = 0; i < count; i++)
+        {
+            threads.emplace_back(worker);
+        }
+        for (std::thread &thread: threads)
+        {
+            thread.join();
+        }
+
+        for (const batch_entry &entry: result.entries)
+        {
+            result.bytes += entry.size;
+            if (!entry.is_sucess()) result.failed++;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+} // cnet
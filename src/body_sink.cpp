@@ -0,0 +1,40 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "body_sink.h"
+
+#include <stdexcept>
+
+namespace cnet
+{
+    file_sink::file_sink(const std::string &path): stream(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!stream.is_open()) throw std::runtime_error("Failed to open " + path);
+    }
+
+    file_sink::file_sink(const std::string &path, const unsigned long long offset): stream(path, std::ios::binary | std::ios::in | std::ios::out)
+    {
+        if (!stream.is_open()) throw std::runtime_error("Failed to open " + path);
+        stream.seekp(static_cast<std::streamoff>(offset));
+    }
+
+    void file_sink::write(const std::string_view chunk)
+    {
+        stream.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        if (!stream) throw std::runtime_error("Failed to write to file");
+        written += chunk.size();
+    }
+
+    void file_sink::finish()
+    {
+        stream.flush();
+        if (!stream) throw std::runtime_error("Failed to write to file");
+    }
+
+    void memory_sink::write(const std::string_view chunk)
+    {
+        if (chunk.size() > max_size - data.size()) throw std::runtime_error("Response body is larger than " + std::to_string(max_size) + " bytes");
+        data.append(chunk);
+    }
+} // cnet
@@ -0,0 +1,156 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "byte_scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CNET_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace cnet
+{
+    static bool is_hex(const char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    }
+
+    static size_t find_byte_scalar(const char *data, const size_t size, const char byte)
+    {
+        const void *found = memchr(data, byte, size);
+        return found == nullptr ? size : static_cast<const char *>(found) - data;
+    }
+
+    static size_t find_non_hex_scalar(const char *data, const size_t size, const size_t from = 0)
+    {
+        size_t i = from;
+        while (i < size && is_hex(data[i])) i++;
+        return i;
+    }
+
+#ifdef CNET_SCAN_X86
+    // the vector loops stop before the last partial vector, the rest is scanned a byte at a time so nothing past the end
+    // of the data is read
+
+    __attribute__((target("sse4.2"))) static size_t find_byte_sse42(const char *data, const size_t size, const char byte)
+    {
+        const __m128i needle = _mm_set1_epi8(byte);
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            if (const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)); mask != 0) return i + __builtin_ctz(mask);
+        }
+        for (; i < size; i++)
+        {
+            if (data[i] == byte) return i;
+        }
+        return size;
+    }
+
+    __attribute__((target("sse4.2"))) static size_t find_non_hex_sse42(const char *data, const size_t size)
+    {
+        // pairs of inclusive ranges, a byte outside all of them is reported
+        const __m128i ranges = _mm_setr_epi8('0', '9', 'A', 'F', 'a', 'f', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            if (const int index = _mm_cmpestri(ranges, 6, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT); index != 16) return i + index;
+        }
+        return find_non_hex_scalar(data, size, i);
+    }
+
+    __attribute__((target("avx2"))) static size_t find_byte_avx2(const char *data, const size_t size, const char byte)
+    {
+        // most lines end within the first bytes, those are found without touching the 32 byte registers
+        size_t i = std::min(size, static_cast<size_t>(CNET_SCAN_AVX2_MIN_SIZE));
+        if (const size_t found = find_byte_sse42(data, i, byte); found < i) return found;
+        const __m256i needle = _mm256_set1_epi8(byte);
+        for (; i + 32 <= size; i += 32)
+        {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            if (const unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)); mask != 0) return i + __builtin_ctz(mask);
+        }
+        return i + find_byte_sse42(data + i, size - i, byte);
+    }
+
+    __attribute__((target("avx2"))) static __m256i in_range(const __m256i block, const char low, const char high)
+    {
+        // block - low wraps below low, so a byte is in the range when that is at most high - low unsigned
+        const __m256i offset = _mm256_sub_epi8(block, _mm256_set1_epi8(low));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(static_cast<char>(high - low))), offset);
+    }
+
+    __attribute__((target("avx2"))) static size_t find_non_hex_avx2(const char *data, const size_t size)
+    {
+        size_t i = std::min(size, static_cast<size_t>(CNET_SCAN_AVX2_MIN_SIZE));
+        if (const size_t found = find_non_hex_sse42(data, i); found < i) return found;
+        for (; i + 32 <= size; i += 32)
+        {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            const __m256i hex = _mm256_or_si256(in_range(block, '0', '9'), _mm256_or_si256(in_range(block, 'a', 'f'), in_range(block, 'A', 'F')));
+            if (const unsigned int mask = ~static_cast<unsigned int>(_mm256_movemask_epi8(hex)); mask != 0) return i + __builtin_ctz(mask);
+        }
+        return i + find_non_hex_sse42(data + i, size - i);
+    }
+#endif
+
+    struct scan_functions
+    {
+        scan_kernel kernel;
+        size_t (*find_byte)(const char *, size_t, char);
+        size_t (*find_non_hex)(const char *, size_t);
+    };
+
+    static constexpr scan_functions scalar_functions{scan_kernel::scalar, find_byte_scalar, [](const char *data, const size_t size) { return find_non_hex_scalar(data, size); }};
+#ifdef CNET_SCAN_X86
+    static constexpr scan_functions sse42_functions{scan_kernel::sse42, find_byte_sse42, find_non_hex_sse42};
+    static constexpr scan_functions avx2_functions{scan_kernel::avx2, find_byte_avx2, find_non_hex_avx2};
+#endif
+
+    static const scan_functions *select_functions(const scan_kernel wanted)
+    {
+#ifdef CNET_SCAN_X86
+        __builtin_cpu_init();
+        if (wanted >= scan_kernel::avx2 && __builtin_cpu_supports("avx2")) return &avx2_functions;
+        if (wanted >= scan_kernel::sse42 && __builtin_cpu_supports("sse4.2")) return &sse42_functions;
+#endif
+        return &scalar_functions;
+    }
+
+    static std::atomic<const scan_functions *> &get_functions()
+    {
+        // AVX2 isn't the default, the parser only scans now and then and the 32 byte registers take microseconds to power
+        // up each time, more than the header lines in between gain from them
+        static std::atomic<const scan_functions *> functions{select_functions(scan_kernel::sse42)};
+        return functions;
+    }
+
+    scan_kernel get_scan_kernel()
+    {
+        return get_functions().load(std::memory_order_relaxed)->kernel;
+    }
+
+    scan_kernel set_scan_kernel(const scan_kernel kernel)
+    {
+        const scan_functions *functions = select_functions(kernel);
+        get_functions().store(functions, std::memory_order_relaxed);
+        return functions->kernel;
+    }
+
+    size_t find_byte(const char *data, const size_t size, const char byte)
+    {
+        return get_functions().load(std::memory_order_relaxed)->find_byte(data, size, byte);
+    }
+
+    size_t find_non_hex(const char *data, const size_t size)
+    {
+        return get_functions().load(std::memory_order_relaxed)->find_non_hex(data, size);
+    }
+} // cnet
@@ -0,0 +1,168 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "connection_pool.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace cnet
+{
+    connection_pool::connection_pool(connection_pool_options options): options(std::move(options))
+    {
+    }
+
+    connection_pool::~connection_pool()
+    {
+        clear();
+    }
+
+    std::string connection_pool::make_key(const std::string_view scheme, const std::string_view host, const unsigned int port)
+    {
+        std::string key;
+        key.reserve(scheme.size() + host.size() + 9);
+        key += scheme;
+        key += "://";
+        key += host;
+        key += ':';
+        key += std::to_string(port);
+        return key;
+    }
+
+    connection_pool::shard &connection_pool::get_shard(const std::string &key)
+    {
+        return shards[std::hash<std::string>()(key) % shards.size()];
+    }
+
+    tcp_client connection_pool::acquire(const std::string &scheme, const std::string &host, const unsigned int port, const bool secure, const unsigned int timeout, bool &reused)
+    {
+        const std::string key = make_key(scheme, host, port);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        shard &part = get_shard(key);
+        {
+            std::unique_lock lock(part.mutex);
+            host_entry &entry = part.hosts[key];
+            while (true)
+            {
+                evict_expired(entry, std::chrono::steady_clock::now());
+
+                // reuse the most recently released connection first, it is the least likely to have been closed by the peer
+                while (!entry.idle.empty())
+                {
+                    tcp_client client = std::move(entry.idle.back().client);
+                    entry.idle.pop_back();
+                    if (!client.is_connected())
+                    {
+                        client.close();
+                        ++evictions;
+                        continue;
+                    }
+                    ++entry.active;
+                    ++hits;
+                    reused = true;
+                    client.set_timeout(timeout);
+                    return client;
+                }
+
+                if (entry.active < options.max_connections_per_host) break;
+                if (part.released.wait_until(lock, deadline) == std::cv_status::timeout && entry.active >= options.max_connections_per_host && entry.idle.empty())
+                {
+                    throw std::runtime_error("Timed out waiting for a pooled connection to " + key);
+                }
+            }
+            ++entry.active;
+            ++misses;
+        }
+
+        // connect outside the lock so a slow host doesn't hold up the other hosts
+        reused = false;
+        try
+        {
+            tcp_client client = tcp_client::connect(host, port, timeout, options.host_resolver);
+            if (secure)
+            {
+                try
+                {
+                    client.create_ssl_handshake();
+                } catch (...)
+                {
+                    client.close();
+                    throw;
+                }
+            }
+            return client;
+        } catch (...)
+        {
+            std::lock_guard lock(part.mutex);
+            --part.hosts[key].active;
+            part.released.notify_one();
+            throw;
+        }
+    }
+
+    void connection_pool::release(const std::string &scheme, const std::string &host, const unsigned int port, tcp_client client, const bool reusable)
+    {
+        const std::string key = make_key(scheme, host, port);
+        shard &part = get_shard(key);
+        {
+            std::lock_guard lock(part.mutex);
+            host_entry &entry = part.hosts[key];
+            if (entry.active > 0) --entry.active;
+            if (reusable && entry.idle.size() < options.max_idle_per_host)
+            {
+                entry.idle.push_back({std::move(client), std::chrono::steady_clock::now()});
+                part.released.notify_one();
+                return;
+            }
+            part.released.notify_one();
+        }
+        client.close();
+    }
+
+    void connection_pool::evict_expired(host_entry &entry, const std::chrono::steady_clock::time_point now)
+    {
+        const auto timeout = std::chrono::milliseconds(options.idle_timeout);
+        // the oldest connections are at the front
+        while (!entry.idle.empty() && now - entry.idle.front().since >= timeout)
+        {
+            entry.idle.front().client.close();
+            entry.idle.pop_front();
+            ++evictions;
+        }
+    }
+
+    void connection_pool::evict_idle()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        for (shard &part: shards)
+        {
+            std::lock_guard lock(part.mutex);
+            for (auto &[key, entry]: part.hosts)
+            {
+                evict_expired(entry, now);
+            }
+        }
+    }
+
+    void connection_pool::clear()
+    {
+        for (shard &part: shards)
+        {
+            std::lock_guard lock(part.mutex);
+            for (auto &[key, entry]: part.hosts)
+            {
+                for (auto &[client, since]: entry.idle)
+                {
+                    client.close();
+                }
+                entry.idle.clear();
+            }
+        }
+    }
+
+    connection_pool_stats connection_pool::get_stats() const
+    {
+        return {hits.load(), misses.load(), evictions.load()};
+    }
+} // cnet
@@ -0,0 +1,369 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "content_decoder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#ifdef CNET_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CNET_BROTLI
+#include <brotli/decode.h>
+#endif
+#ifdef CNET_ZSTD
+#include <zstd.h>
+#endif
+
+namespace cnet
+{
+#ifdef CNET_ZLIB
+    /**
+     * @brief Inflates gzip (RFC 1952) and deflate, which is meant to be zlib (RFC 1950) but is raw deflate from some servers.
+     */
+    class zlib_decoder : public content_decoder
+    {
+    private:
+        z_stream stream{};
+        std::string buffer;
+        bool gzip;
+        bool initialized = false;
+        bool ended = false;
+
+        void initialize(const std::string_view chunk)
+        {
+            int window_bits = 16 + MAX_WBITS;
+            if (!gzip)
+            {
+                // a zlib header has deflate as its method and a check value making it a multiple of 31
+                const auto method = static_cast<unsigned char>(chunk[0]);
+                const bool zlib = (method & 0x0f) == 8 && (method >> 4) <= 7 && (chunk.size() < 2 || (method << 8 | static_cast<unsigned char>(chunk[1])) % 31 == 0);
+                window_bits = zlib ? MAX_WBITS : -MAX_WBITS;
+            }
+            if (inflateInit2(&stream, window_bits) != Z_OK) throw std::runtime_error("Error at inflateInit2()");
+            initialized = true;
+        }
+
+    public:
+        explicit zlib_decoder(const bool gzip): buffer(CNET_DECODE_BUFFER_SIZE, '\0'), gzip(gzip) {}
+
+        ~zlib_decoder() override
+        {
+            if (initialized) inflateEnd(&stream);
+        }
+
+        zlib_decoder(const zlib_decoder &) = delete;
+
+        zlib_decoder &operator=(const zlib_decoder &) = delete;
+
+        void write(const std::string_view chunk, body_sink &output) override
+        {
+            if (chunk.empty()) return;
+            if (!initialized) initialize(chunk);
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(chunk.data()));
+            stream.avail_in = static_cast<uInt>(chunk.size());
+            do
+            {
+                if (ended)
+                {
+                    // another gzip member may follow, anything else after the end of the stream is ignored
+                    if (!gzip || stream.avail_in == 0 || *stream.next_in != 0x1f) return;
+                    inflateReset(&stream);
+                    ended = false;
+                }
+                stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+                stream.avail_out = static_cast<uInt>(buffer.size());
+                const int result = inflate(&stream, Z_NO_FLUSH);
+                if (result == Z_STREAM_END) ended = true;
+                else if (result != Z_OK && result != Z_BUF_ERROR)
+                {
+                    throw std::runtime_error(std::string("Corrupt ") + (gzip ? "gzip" : "deflate") + " body: " + (stream.msg != nullptr ? stream.msg : "error " + std::to_string(result)));
+                }
+                if (const size_t produced = buffer.size() - stream.avail_out; produced > 0) output.write(std::string_view(buffer.data(), produced));
+            } while (stream.avail_in > 0 || stream.avail_out == 0);
+        }
+
+        void finish(body_sink &) override
+        {
+            if (initialized && !ended) throw std::runtime_error(std::string("The ") + (gzip ? "gzip" : "deflate") + " body was cut short");
+        }
+    };
+#endif
+
+#ifdef CNET_BROTLI
+    /**
+     * @brief Decodes br, RFC 7932.
+     */
+    class brotli_decoder : public content_decoder
+    {
+    private:
+        BrotliDecoderState *state;
+        std::string buffer;
+        bool received = false;
+        bool ended = false;
+
+    public:
+        brotli_decoder(): state(BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)), buffer(CNET_DECODE_BUFFER_SIZE, '\0')
+        {
+            if (state == nullptr) throw std::runtime_error("Error at BrotliDecoderCreateInstance()");
+        }
+
+        ~brotli_decoder() override
+        {
+            BrotliDecoderDestroyInstance(state);
+        }
+
+        brotli_decoder(const brotli_decoder &) = delete;
+
+        brotli_decoder &operator=(const brotli_decoder &) = delete;
+
+        void write(const std::string_view chunk, body_sink &output) override
+        {
+            if (chunk.empty() || ended) return;
+            received = true;
+            auto next_in = reinterpret_cast<const uint8_t *>(chunk.data());
+            size_t available_in = chunk.size();
+            while (true)
+            {
+                auto next_out = reinterpret_cast<uint8_t *>(buffer.data());
+                size_t available_out = buffer.size();
+                const BrotliDecoderResult result = BrotliDecoderDecompressStream(state, &available_in, &next_in, &available_out, &next_out, nullptr);
+                if (result == BROTLI_DECODER_RESULT_ERROR)
+                {
+                    throw std::runtime_error(std::string("Corrupt br body: ") + BrotliDecoderErrorString(BrotliDecoderGetErrorCode(state)));
+                }
+                if (const size_t produced = buffer.size() - available_out; produced > 0) output.write(std::string_view(buffer.data(), produced));
+                if (result == BROTLI_DECODER_RESULT_SUCCESS) ended = true;
+                if (result != BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) return;
+            }
+        }
+
+        void finish(body_sink &) override
+        {
+            if (received && !ended) throw std::runtime_error("The br body was cut short");
+        }
+    };
+#endif
+
+#ifdef CNET_ZSTD
+    /**
+     * @brief Decodes zstd, RFC 8878, the frames of which may follow one another.
+     */
+    class zstd_decoder : public content_decoder
+    {
+    private:
+        ZSTD_DStream *stream;
+        std::string buffer;
+        bool received = false;
+        // whether the last frame decoded was complete
+        bool ended = false;
+
+    public:
+        zstd_decoder(): stream(ZSTD_createDStream()), buffer(CNET_DECODE_BUFFER_SIZE, '\0')
+        {
+            if (stream == nullptr || ZSTD_isError(ZSTD_initDStream(stream))) throw std::runtime_error("Error at ZSTD_initDStream()");
+        }
+
+        ~zstd_decoder() override
+        {
+            ZSTD_freeDStream(stream);
+        }
+
+        zstd_decoder(const zstd_decoder &) = delete;
+
+        zstd_decoder &operator=(const zstd_decoder &) = delete;
+
+        void write(const std::string_view chunk, body_sink &output) override
+        {
+            if (chunk.empty()) return;
+            received = true;
+            ZSTD_inBuffer in{chunk.data(), chunk.size(), 0};
+            while (true)
+            {
+                ZSTD_outBuffer out{buffer.data(), buffer.size(), 0};
+                const size_t result = ZSTD_decompressStream(stream, &out, &in);
+                if (ZSTD_isError(result)) throw std::runtime_error(std::string("Corrupt zstd body: ") + ZSTD_getErrorName(result));
+                if (out.pos > 0) output.write(std::string_view(buffer.data(), out.pos));
+                ended = result == 0;
+                if (in.pos == in.size && out.pos < out.size) return;
+            }
+        }
+
+        void finish(body_sink &) override
+        {
+            if (received && !ended) throw std::runtime_error("The zstd body was cut short");
+        }
+    };
+#endif
+
+    static std::string to_lower(std::string_view text)
+    {
+        std::string lower(text);
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](const unsigned char c) { return static_cast<char>(tolower(c)); });
+        return lower;
+    }
+
+    /**
+     * @brief The registered codings, in the order they are listed in Accept-Encoding.
+     */
+    struct coding_registry
+    {
+        std::mutex mutex;
+        std::vector<std::pair<std::string, content_decoder::factory>> codings;
+        std::string accept_encoding;
+
+        coding_registry()
+        {
+#ifdef CNET_ZLIB
+            codings.emplace_back("gzip", [] { return std::make_unique<zlib_decoder>(true); });
+            codings.emplace_back("deflate", [] { return std::make_unique<zlib_decoder>(false); });
+#endif
+#ifdef CNET_BROTLI
+            codings.emplace_back("br", [] { return std::make_unique<brotli_decoder>(); });
+#endif
+#ifdef CNET_ZSTD
+            codings.emplace_back("zstd", [] { return std::make_unique<zstd_decoder>(); });
+#endif
+            update();
+        }
+
+        void update()
+        {
+            accept_encoding.clear();
+            for (const auto &[name, create]: codings)
+            {
+                if (!accept_encoding.empty()) accept_encoding += ", ";
+                accept_encoding += name;
+            }
+        }
+    };
+
+    static coding_registry &get_registry()
+    {
+        static coding_registry registry;
+        return registry;
+    }
+
+    void content_decoder::register_coding(const std::string &name, factory create)
+    {
+        coding_registry &registry = get_registry();
+        const std::string key = to_lower(name);
+        std::lock_guard lock(registry.mutex);
+        const auto it = std::find_if(registry.codings.begin(), registry.codings.end(), [&key](const auto &coding) { return coding.first == key; });
+        if (create == nullptr)
+        {
+            if (it != registry.codings.end()) registry.codings.erase(it);
+        } else if (it != registry.codings.end()) it->second = std::move(create);
+        else registry.codings.emplace_back(key, std::move(create));
+        registry.update();
+    }
+
+    std::unique_ptr<content_decoder> content_decoder::create(const std::string_view name)
+    {
+        std::string key = to_lower(name);
+        // RFC 9110 section 8.4.1.3, x-gzip is an alias of gzip
+        if (key == "x-gzip") key = "gzip";
+        factory create;
+        {
+            coding_registry &registry = get_registry();
+            std::lock_guard lock(registry.mutex);
+            const auto it = std::find_if(registry.codings.begin(), registry.codings.end(), [&key](const auto &coding) { return coding.first == key; });
+            if (it == registry.codings.end()) return nullptr;
+            create = it->second;
+        }
+        return create();
+    }
+
+    std::string content_decoder::get_accept_encoding()
+    {
+        coding_registry &registry = get_registry();
+        std::lock_guard lock(registry.mutex);
+        return registry.accept_encoding;
+    }
+
+    void decoding_sink::start(const http_message &response)
+    {
+        decoders.clear();
+        stages.clear();
+        decoded = 0;
+        // 1xx, 204 and 304 responses have no body, their Content-Length is kept as sent
+        const bool has_body = response.status_code >= 200 && response.status_code != 204 && response.status_code != 304;
+        if (const std::optional<std::string_view> encoding = response.headers.get(known_header::content_encoding); has_body && encoding.has_value())
+        {
+            // the codings are listed in the order they were applied, so they are undone from the last
+            std::string_view list = *encoding;
+            while (!list.empty())
+            {
+                const size_t comma = list.find(',');
+                std::string_view name = list.substr(0, comma);
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+                while (!name.empty() && (name.front() == ' ' || name.front() == '\t')) name.remove_prefix(1);
+                while (!name.empty() && (name.back() == ' ' || name.back() == '\t')) name.remove_suffix(1);
+                if (name.empty() || to_lower(name) == "identity") continue;
+                std::unique_ptr<content_decoder> decoder = content_decoder::create(name);
+                if (decoder == nullptr)
+                {
+                    // a body that can't be fully decoded is handed on as it was received
+                    decoders.clear();
+                    break;
+                }
+                decoders.insert(decoders.begin(), std::move(decoder));
+            }
+        }
+        stages.resize(decoders.size());
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            stages[i].owner = this;
+            stages[i].index = i + 1;
+        }
+
+        if (next == nullptr) return;
+        if (!is_decoding())
+        {
+            next->start(response);
+            return;
+        }
+        http_message decoded_response = response;
+        apply(decoded_response);
+        next->start(decoded_response);
+    }
+
+    void decoding_sink::forward(const size_t index, const std::string_view chunk)
+    {
+        if (index < decoders.size())
+        {
+            decoders[index]->write(chunk, stages[index]);
+            return;
+        }
+        decoded += chunk.size();
+        if (next != nullptr) next->write(chunk);
+        else body->append(chunk);
+    }
+
+    void decoding_sink::write(const std::string_view chunk)
+    {
+        forward(0, chunk);
+    }
+
+    void decoding_sink::finish()
+    {
+        for (size_t i = 0; i < decoders.size(); i++)
+        {
+            decoders[i]->finish(stages[i]);
+        }
+        if (next != nullptr) next->finish();
+    }
+
+    void decoding_sink::apply(http_message &response) const
+    {
+        if (!is_decoding()) return;
+        response.headers.remove("Content-Encoding");
+        response.headers.remove("Content-Length");
+        response.content_length = decoded;
+    }
+} // cnet
@@ -0,0 +1,487 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "downloader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef __WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// the number of bytes a connection writes between two updates of the journal
+#define CNET_JOURNAL_INTERVAL (4 * 1024 * 1024)
+
+namespace cnet
+{
+    namespace
+    {
+        // thrown by range_sink once the last byte of a range has arrived, which happens before the end of the
+        // response when the range has been shortened by a split
+        struct range_end final : std::exception
+        {
+        };
+
+        // thrown by range_sink when a range request is answered with the whole resource, despite the HEAD response
+        // advertising byte ranges or because the If-Range validator no longer matches
+        struct range_unsupported final : std::exception
+        {
+        };
+
+        struct range
+        {
+            std::mutex mutex;
+            unsigned long long position; // the next byte to write
+            unsigned long long committed; // the bytes before this are flushed to the file
+            unsigned long long end; // one past the last byte of the range
+            bool active = false;
+
+            range(const unsigned long long start, const unsigned long long end): position(start), committed(start), end(end) {}
+        };
+
+        // writes the body of a range response at its offset, in the output file or the in-memory copy of it
+        class range_sink : public body_sink
+        {
+        private:
+            range &part;
+            unsigned long long requested;
+            std::fstream *file;
+            char *memory;
+            const std::function<void()> &save_journal;
+            unsigned long long written; // one past the last byte this sink wrote
+            unsigned long long unsaved = 0;
+
+        public:
+            range_sink(range &part, const unsigned long long requested, std::fstream *file, char *memory, const std::function<void()> &save_journal)
+                : part(part), requested(requested), file(file), memory(memory), save_journal(save_journal), written(requested) {}
+
+            void start(const http_message &response) override
+            {
+                if (response.is_ok()) throw range_unsupported();
+                if (!response.is_partial_content())
+                {
+                    throw std::runtime_error("Server answered a range request with status " + std::to_string(response.status_code));
+                }
+                const std::optional<std::string_view> content_range = response.headers.get(known_header::content_range);
+                if (content_range.has_value() && content_range->compare(0, 6, "bytes ") == 0 && std::stoull(std::string(content_range->substr(6))) != requested)
+                {
+                    throw std::runtime_error("Server returned a different range than requested: " + std::string(*content_range));
+                }
+            }
+
+            void write(std::string_view chunk) override
+            {
+                while (!chunk.empty())
+                {
+                    // claim the bytes under the lock, so a concurrent split never ends the range before them
+                    unsigned long long offset;
+                    size_t take;
+                    {
+                        std::lock_guard lock(part.mutex);
+                        if (part.position >= part.end) throw range_end();
+                        offset = part.position;
+                        take = static_cast<size_t>(std::min<unsigned long long>(chunk.size(), part.end - part.position));
+                        part.position += take;
+                    }
+                    if (memory != nullptr)
+                    {
+                        memcpy(memory + offset, chunk.data(), take);
+                    } else
+                    {
+                        file->seekp(static_cast<std::streamoff>(offset));
+                        file->write(chunk.data(), static_cast<std::streamsize>(take));
+                        if (!*file)
+                        {
+                            // give the bytes back, so a retry writes them again
+                            std::lock_guard lock(part.mutex);
+                            part.position = offset;
+                            throw std::runtime_error("Failed to write to file");
+                        }
+                    }
+                    written = offset + take;
+                    unsaved += take;
+                    chunk.remove_prefix(take);
+                }
+                if (unsaved >= CNET_JOURNAL_INTERVAL) checkpoint();
+            }
+
+            // flushes the bytes written so far and records them in the journal
+            void checkpoint()
+            {
+                if (file == nullptr || unsaved == 0) return;
+                file->flush();
+                {
+                    std::lock_guard lock(part.mutex);
+                    part.committed = std::max(part.committed, written);
+                }
+                unsaved = 0;
+                save_journal();
+            }
+        };
+
+        void allocate(const std::string &path, const unsigned long long size)
+        {
+#ifndef __WIN32
+            const int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+            if (fd >= 0)
+            {
+                const int result = posix_fallocate(fd, 0, static_cast<off_t>(size));
+                ::close(fd);
+                if (result == 0) return;
+            }
+#endif
+            // the file system can't reserve blocks up front, so at least set its final size
+            std::filesystem::resize_file(path, size);
+        }
+
+        std::string journal_path(const std::string &path)
+        {
+            return path + ".cnet";
+        }
+
+        // the journal is a small text file listing the byte ranges still missing from the output file:
+        //
+        //   cnet-journal 1
+        //   size 20000000
+        //   validator "v1"
+        //   missing 4194304 5000000
+        //   missing 9437184 10000000
+        //
+        // it is replaced atomically, so a crash leaves either the previous or the new version behind
+        void write_journal(const std::string &path, const unsigned long long size, const std::string &validator,
+                           const std::vector<std::pair<unsigned long long, unsigned long long>> &missing)
+        {
+            const std::string journal = journal_path(path);
+            const std::string temporary = journal + ".tmp";
+            bool written;
+            {
+                std::ofstream file(temporary, std::ios::trunc);
+                file << "cnet-journal 1\nsize " << size << "\nvalidator " << validator << "\n";
+                for (const auto &[start, end]: missing)
+                {
+                    file << "missing " << start << " " << end << "\n";
+                }
+                file.flush();
+                written = static_cast<bool>(file);
+            }
+            std::error_code error;
+            // a journal that can't be written only costs the ability to resume
+            if (written) std::filesystem::rename(temporary, journal, error);
+            if (!written || error) std::filesystem::remove(temporary, error);
+        }
+
+        bool read_journal(const std::string &path, const unsigned long long size, const std::string &validator,
+                          std::vector<std::pair<unsigned long long, unsigned long long>> &missing)
+        {
+            std::ifstream file(journal_path(path));
+            if (!file.is_open()) return false;
+
+            std::string line;
+            if (!std::getline(file, line) || line != "cnet-journal 1") return false;
+            if (!std::getline(file, line) || line != "size " + std::to_string(size)) return false;
+            if (!std::getline(file, line) || line != "validator " + validator) return false;
+            missing.clear();
+            while (std::getline(file, line))
+            {
+                unsigned long long start, end;
+                if (sscanf(line.c_str(), "missing %llu %llu", &start, &end) != 2 || start >= end || end > size) return false;
+                missing.emplace_back(start, end);
+            }
+            return true;
+        }
+
+        void remove_journal(const std::string &path)
+        {
+            std::error_code error;
+            std::filesystem::remove(journal_path(path), error);
+        }
+    }
+
+    downloader::downloader(download_options options): options(std::move(options))
+    {
+        if (this->options.client.pool == nullptr) this->options.client.pool = std::make_shared<connection_pool>();
+        // files are saved as the server stores them, and byte ranges address the encoded representation anyway
+        this->options.client.decode_content = false;
+        if (this->options.parts == 0) this->options.parts = 1;
+        if (this->options.max_threads == 0) this->options.max_threads = 1;
+    }
+
+    download_result downloader::download_single(const http_message &request, const std::string &path)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        remove_journal(path);
+        http_client client(options.client);
+        http_message message = request;
+        download_result result;
+        if (options.in_memory)
+        {
+            memory_sink sink;
+            client.make_request(message, sink);
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(sink.get_data().data(), static_cast<std::streamsize>(sink.get_data().size()));
+            if (!file) throw std::runtime_error("Failed to write " + path);
+            result.size = sink.get_data().size();
+        } else
+        {
+            file_sink sink(path);
+            client.make_request(message, sink);
+            result.size = sink.get_written();
+        }
+        if (!message.is_sucess()) throw std::runtime_error("Download failed with status " + std::to_string(message.status_code));
+        result.ranges = 1;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+    download_result downloader::download(const http_message &request, const std::string &path)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        http_client probe_client(options.client);
+        const http_message head = probe_client.probe(request);
+
+        const std::optional<std::string_view> accept_ranges = head.headers.get(known_header::accept_ranges);
+        const bool ranged = head.is_ok() && head.headers.get(known_header::content_length).has_value() && head.content_length > 0 &&
+                            accept_ranges.has_value() && http_response_parser::has_token(*accept_ranges, "bytes");
+        const bool resume = options.resume && !options.in_memory;
+        if (!ranged || (options.parts == 1 && options.max_threads == 1 && !resume))
+        {
+            return download_single(request, path);
+        }
+
+        // If-Range only accepts a strong ETag, otherwise fall back to the Last-Modified date
+        std::string validator;
+        if (const std::optional<std::string_view> etag = head.headers.get(known_header::etag); etag.has_value() && etag->compare(0, 2, "W/") != 0)
+        {
+            validator = *etag;
+        } else if (const std::optional<std::string_view> last_modified = head.headers.get(known_header::last_modified); last_modified.has_value())
+        {
+            validator = *last_modified;
+        }
+
+        const unsigned long long size = head.content_length;
+        std::vector<std::pair<unsigned long long, unsigned long long>> missing;
+        bool resuming = false;
+        if (resume && std::filesystem::exists(path))
+        {
+            if (read_journal(path, size, validator, missing))
+            {
+                resuming = true;
+            } else if (const unsigned long long existing = std::filesystem::file_size(path); !std::filesystem::exists(journal_path(path)) && existing < size)
+            {
+                // without a journal the file was written front to back, so only its tail is missing. A file that is
+                // already complete in size may be preallocated or unrelated, so it's downloaded again instead of trusted
+                missing.clear();
+                missing.emplace_back(existing, size);
+                resuming = true;
+            }
+        }
+
+        std::string memory;
+        if (options.in_memory)
+        {
+            memory.resize(size);
+        } else
+        {
+            if (!resuming) std::ofstream(path, std::ios::binary | std::ios::trunc).close();
+            if (options.preallocate) allocate(path, size);
+        }
+
+        // the initial ranges, either those the journal lists as missing or an even split where the last takes the remainder
+        std::vector<std::unique_ptr<range>> ranges;
+        std::deque<range *> pending;
+        if (resuming)
+        {
+            for (const auto &[start, end]: missing)
+            {
+                ranges.push_back(std::make_unique<range>(start, end));
+                pending.push_back(ranges.back().get());
+            }
+        } else
+        {
+            const unsigned long long parts = std::min<unsigned long long>(options.parts, size);
+            for (unsigned long long i = 0; i < parts; i++)
+            {
+                const unsigned long long start = size / parts * i;
+                const unsigned long long end = i + 1 == parts ? size : size / parts * (i + 1);
+                ranges.push_back(std::make_unique<range>(start, end));
+                pending.push_back(ranges.back().get());
+            }
+        }
+        unsigned long long resumed = size;
+        for (const auto &part: ranges)
+        {
+            resumed -= part->end - part->committed;
+        }
+
+        std::mutex scheduler;
+        unsigned int splits = 0;
+        bool unsupported = false;
+        std::string error;
+
+        // records the bytes every range still misses, the sinks call it after flushing what they wrote
+        std::mutex journal_mutex;
+        const std::function<void()> save_journal = [&]
+        {
+            if (options.in_memory) return;
+            std::vector<std::pair<unsigned long long, unsigned long long>> snapshot;
+            {
+                std::lock_guard lock(scheduler);
+                for (const auto &part: ranges)
+                {
+                    std::lock_guard part_lock(part->mutex);
+                    if (part->committed < part->end) snapshot.emplace_back(part->committed, part->end);
+                }
+            }
+            std::lock_guard lock(journal_mutex);
+            write_journal(path, size, validator, snapshot);
+        };
+        save_journal();
+
+        // hands out the next unstarted range, or splits the range with the most bytes left once none is unstarted
+        const auto next_range = [&]() -> range *
+        {
+            std::lock_guard lock(scheduler);
+            if (unsupported || !error.empty()) return nullptr;
+            if (!pending.empty())
+            {
+                range *part = pending.front();
+                pending.pop_front();
+                part->active = true;
+                return part;
+            }
+
+            range *victim = nullptr;
+            unsigned long long most = 0;
+            for (const auto &part: ranges)
+            {
+                if (!part->active) continue;
+                std::lock_guard part_lock(part->mutex);
+                if (part->end > part->position && part->end - part->position > most)
+                {
+                    most = part->end - part->position;
+                    victim = part.get();
+                }
+            }
+            if (victim == nullptr || most < options.min_split_size * 2) return nullptr;
+
+            std::lock_guard part_lock(victim->mutex);
+            const unsigned long long middle = victim->position + (victim->end - victim->position) / 2;
+            ranges.push_back(std::make_unique<range>(middle, victim->end));
+            victim->end = middle;
+            ranges.back()->active = true;
+            splits++;
+            return ranges.back().get();
+        };
+
+        const auto worker = [&]
+        {
+            http_client client(options.client);
+            std::fstream file;
+            if (!options.in_memory) file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+
+            for (range *part; (part = next_range()) != nullptr;)
+            {
+                for (unsigned int attempt = 0;;)
+                {
+                    unsigned long long from, to;
+                    {
+                        std::lock_guard lock(part->mutex);
+                        from = part->position;
+                        to = part->end;
+                    }
+                    if (from >= to) break;
+
+                    http_message message = request;
+                    message.headers.set("Range", "bytes=" + std::to_string(from) + "-" + std::to_string(to - 1));
+                    if (!validator.empty()) message.headers.set("If-Range", validator);
+                    range_sink sink(*part, from, options.in_memory ? nullptr : &file, options.in_memory ? memory.data() : nullptr, save_journal);
+                    std::string failure;
+                    bool done = false;
+                    try
+                    {
+                        client.make_request(message, sink);
+                    } catch (range_end &)
+                    {
+                        done = true;
+                    } catch (range_unsupported &)
+                    {
+                        std::lock_guard scheduler_lock(scheduler);
+                        unsupported = true;
+                        break;
+                    } catch (std::exception &e)
+                    {
+                        failure = e.what();
+                    }
+                    sink.checkpoint();
+                    if (done) break;
+
+                    // continue from the last byte received, the retries are only spent when no progress was made
+                    unsigned long long reached;
+                    {
+                        std::lock_guard lock(part->mutex);
+                        reached = part->position;
+                    }
+                    if (reached > from) continue;
+                    if (++attempt > options.retries)
+                    {
+                        std::lock_guard scheduler_lock(scheduler);
+                        if (error.empty()) error = failure.empty() ? "the server sent no data for a range" : failure;
+                        break;
+                    }
+                }
+                std::lock_guard lock(scheduler);
+                part->active = false;
+            }
+            if (file.is_open()) file.flush();
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < options.max_threads; i++)
+        {
+            threads.emplace_back(worker);
+        }
+        for (std::thread &thread: threads)
+        {
+            thread.join();
+        }
+
+        // the resource changed since the journal was written, or the server ignores ranges after all
+        if (unsupported) return download_single(request, path);
+        if (!error.empty()) throw std::runtime_error("Download failed: " + error);
+        for (const auto &part: ranges)
+        {
+            if (part->position < part->end) throw std::runtime_error("Download failed: a range is incomplete");
+        }
+
+        if (options.in_memory)
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(memory.data(), static_cast<std::streamsize>(memory.size()));
+            if (!file) throw std::runtime_error("Failed to write " + path);
+        }
+        remove_journal(path);
+
+        download_result result;
+        result.size = size;
+        result.ranged = true;
+        result.ranges = static_cast<unsigned int>(ranges.size());
+        result.resumed = resumed;
+        result.splits = splits;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    }
+} // cnet
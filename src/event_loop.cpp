@@ -0,0 +1,551 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "event_loop.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "io_ring.h"
+
+// the epoll data of the wake-up eventfd, sockets carry their descriptor and generation instead
+#define CNET_WAKE_TOKEN (~0ull)
+// the io_uring user data of submissions whose completion needs no handling
+#define CNET_IGNORE_TOKEN (~0ull - 1)
+// set in the io_uring user data of completion API operations, which carry their id instead of a descriptor
+#define CNET_OPERATION_FLAG (1ull << 63)
+#define CNET_BUFFER_GROUP 0
+
+namespace cnet
+{
+    static constexpr int max_events = 256;
+
+    event_loop::event_loop([[maybe_unused]] const loop_backend backend)
+    {
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0) throw std::runtime_error("Error at eventfd(): " + std::string(strerror(errno)));
+#ifdef CNET_IO_URING
+        if (backend != loop_backend::epoll && setup_ring()) return;
+#endif
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+        {
+            const int error = errno;
+            ::close(wake_fd);
+            throw std::runtime_error("Error at epoll_create1(): " + std::string(strerror(error)));
+        }
+        this->backend = loop_backend::epoll;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = CNET_WAKE_TOKEN;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+    }
+
+    event_loop::~event_loop()
+    {
+#ifdef CNET_IO_URING
+        ring.reset();
+#endif
+        ::close(wake_fd);
+        if (epoll_fd >= 0) ::close(epoll_fd);
+    }
+
+    void event_loop::watch(const int fd, const uint32_t events, event_handler handler)
+    {
+        // the generation tells a socket apart from an earlier one with the same descriptor whose events are still
+        // queued, it stays below 2^31 so the tag never looks like an io_uring operation
+        const uint32_t current = generation = (generation + 1) & 0x7fffffff;
+        auto entry = std::make_shared<watch_entry>(watch_entry{std::move(handler), current, events, false});
+#ifdef CNET_IO_URING
+        if (ring != nullptr)
+        {
+            arm_poll(fd, *entry);
+            watches[fd] = std::move(entry);
+            return;
+        }
+#endif
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = static_cast<uint64_t>(current) << 32 | static_cast<uint32_t>(fd);
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            throw std::runtime_error("Error at epoll_ctl(): " + std::string(strerror(errno)));
+        }
+        watches[fd] = std::move(entry);
+    }
+
+    void event_loop::modify(const int fd, const uint32_t events)
+    {
+        const auto it = watches.find(fd);
+        if (it == watches.end()) throw std::runtime_error("Socket is not watched");
+        watch_entry &entry = *it->second;
+        entry.events = events;
+#ifdef CNET_IO_URING
+        if (ring != nullptr)
+        {
+            // a poll can't be changed in place, so replace it by one with a new generation
+            if (entry.armed)
+            {
+                io_uring_sqe *sqe = ring->get_sqe();
+                sqe->opcode = IORING_OP_POLL_REMOVE;
+                sqe->fd = -1;
+                sqe->addr = static_cast<uint64_t>(entry.generation) << 32 | static_cast<uint32_t>(fd);
+                sqe->user_data = CNET_IGNORE_TOKEN;
+            }
+            entry.generation = generation = (generation + 1) & 0x7fffffff;
+            arm_poll(fd, entry);
+            return;
+        }
+#endif
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = static_cast<uint64_t>(entry.generation) << 32 | static_cast<uint32_t>(fd);
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0)
+        {
+            throw std::runtime_error("Error at epoll_ctl(): " + std::string(strerror(errno)));
+        }
+    }
+
+    void event_loop::unwatch(const int fd)
+    {
+        const auto it = watches.find(fd);
+        if (it == watches.end()) return;
+#ifdef CNET_IO_URING
+        if (ring != nullptr)
+        {
+            if (it->second->armed)
+            {
+                io_uring_sqe *sqe = ring->get_sqe();
+                sqe->opcode = IORING_OP_POLL_REMOVE;
+                sqe->fd = -1;
+                sqe->addr = static_cast<uint64_t>(it->second->generation) << 32 | static_cast<uint32_t>(fd);
+                sqe->user_data = CNET_IGNORE_TOKEN;
+            }
+            watches.erase(it);
+            return;
+        }
+#endif
+        watches.erase(it);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    void event_loop::watch_all(std::vector<int> &watched, const std::vector<int> &fds, const uint32_t events, const event_handler &handler)
+    {
+        for (const int fd: watched)
+        {
+            unwatch(fd);
+        }
+        watched.clear();
+        for (const int fd: fds)
+        {
+            watch(fd, events, handler);
+            watched.push_back(fd);
+        }
+    }
+
+    unsigned long long event_loop::add_timer(const unsigned int delay, std::function<void()> callback)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay);
+        const unsigned long long id = next_timer++;
+        timers.emplace(std::make_pair(deadline, id), std::move(callback));
+        timer_deadlines.emplace(id, deadline);
+        return id;
+    }
+
+    void event_loop::cancel_timer(const unsigned long long id)
+    {
+        const auto it = timer_deadlines.find(id);
+        if (it == timer_deadlines.end()) return;
+        timers.erase(std::make_pair(it->second, id));
+        timer_deadlines.erase(it);
+    }
+
+    void event_loop::post(std::function<void()> task)
+    {
+        {
+            std::lock_guard lock(tasks_mutex);
+            tasks.push_back(std::move(task));
+            ++pending_tasks;
+        }
+        // the loop's own thread runs the tasks before it waits again, only other threads need to wake it
+        if (in_loop_thread()) return;
+        constexpr uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(wake_fd, &one, sizeof(one));
+    }
+
+    void event_loop::stop()
+    {
+        stopped = true;
+        constexpr uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(wake_fd, &one, sizeof(one));
+    }
+
+    void event_loop::run_tasks()
+    {
+        if (pending_tasks == 0) return;
+        std::vector<std::function<void()>> batch;
+        {
+            std::lock_guard lock(tasks_mutex);
+            batch.swap(tasks);
+            pending_tasks -= batch.size();
+        }
+        for (std::function<void()> &task: batch)
+        {
+            task();
+        }
+    }
+
+    void event_loop::run_timers()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        while (!timers.empty() && timers.begin()->first.first <= now)
+        {
+            const auto first = timers.begin();
+            const std::function<void()> callback = std::move(first->second);
+            timer_deadlines.erase(first->first.second);
+            timers.erase(first);
+            callback();
+        }
+    }
+
+    bool event_loop::is_idle() const
+    {
+#ifdef CNET_IO_URING
+        if (!operations.empty()) return false;
+#endif
+        return watches.empty() && timers.empty() && pending_tasks == 0;
+    }
+
+    int event_loop::next_timeout() const
+    {
+        // tasks posted by timers or other tasks on this thread didn't wake the loop, so they must not wait
+        if (pending_tasks > 0) return 0;
+        if (timers.empty()) return -1;
+        const auto remaining = timers.begin()->first.first - std::chrono::steady_clock::now();
+        // round up, so the wait doesn't end a fraction of a millisecond before the timer is due
+        return static_cast<int>(std::max<long long>(0, std::chrono::ceil<std::chrono::milliseconds>(remaining).count()));
+    }
+
+    void event_loop::run(const bool forever)
+    {
+        thread.store(std::this_thread::get_id());
+        while (!stopped)
+        {
+            run_tasks();
+            run_timers();
+            if (stopped || (!forever && is_idle())) break;
+#ifdef CNET_IO_URING
+            if (ring != nullptr)
+            {
+                wait_ring();
+                continue;
+            }
+#endif
+            wait_epoll();
+        }
+        stopped = false;
+    }
+
+    void event_loop::wait_epoll()
+    {
+        epoll_event events[max_events];
+        const int count = epoll_wait(epoll_fd, events, max_events, next_timeout());
+        if (count < 0)
+        {
+            if (errno == EINTR) return;
+            throw std::runtime_error("Error at epoll_wait(): " + std::string(strerror(errno)));
+        }
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.u64 == CNET_WAKE_TOKEN)
+            {
+                uint64_t value;
+                [[maybe_unused]] const ssize_t read = ::read(wake_fd, &value, sizeof(value));
+                continue;
+            }
+            const int fd = static_cast<int>(events[i].data.u64 & 0xffffffff);
+            const auto it = watches.find(fd);
+            if (it == watches.end() || it->second->generation != events[i].data.u64 >> 32) continue;
+            // keep the entry alive while its handler runs, the handler may well unwatch its own socket
+            const std::shared_ptr<watch_entry> entry = it->second;
+            entry->handler(events[i].events);
+        }
+    }
+
+    bool event_loop::supports_completions() const
+    {
+#ifdef CNET_IO_URING
+        return completions;
+#else
+        return false;
+#endif
+    }
+
+#ifdef CNET_IO_URING
+    bool event_loop::setup_ring()
+    {
+        try
+        {
+            ring = std::make_unique<io_ring>(CNET_IO_URING_ENTRIES);
+        } catch (const std::exception &)
+        {
+            // e.g. an old kernel, or io_uring disabled by a sysctl or seccomp
+            return false;
+        }
+        backend = loop_backend::io_uring;
+        completions = ring->register_files(CNET_IO_URING_FILES) && ring->register_buffers(CNET_IO_URING_BUFFERS, CNET_IO_URING_BUFFER_SIZE, CNET_BUFFER_GROUP);
+        if (completions)
+        {
+            free_files.reserve(CNET_IO_URING_FILES);
+            for (int slot = CNET_IO_URING_FILES - 1; slot >= 0; slot--)
+            {
+                free_files.push_back(slot);
+            }
+        }
+        arm_wake();
+        return true;
+    }
+
+    void event_loop::arm_poll(const int fd, watch_entry &entry)
+    {
+        io_uring_sqe *sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        // the epoll event bits used here have the values of their poll counterparts
+        sqe->poll32_events = entry.events;
+        sqe->user_data = static_cast<uint64_t>(entry.generation) << 32 | static_cast<uint32_t>(fd);
+        entry.armed = true;
+    }
+
+    void event_loop::arm_wake()
+    {
+        io_uring_sqe *sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = wake_fd;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = CNET_WAKE_TOKEN;
+    }
+
+    unsigned long long event_loop::add_operation(std::unique_ptr<operation> op)
+    {
+        const unsigned long long id = next_operation++ | CNET_OPERATION_FLAG;
+        operations.emplace(id, std::move(op));
+        return id;
+    }
+
+    void event_loop::wait_ring()
+    {
+        // everything submitted since the last wait goes to the kernel in the same call that waits
+        const int timeout = next_timeout();
+        __kernel_timespec time{};
+        time.tv_sec = timeout / 1000;
+        time.tv_nsec = static_cast<long long>(timeout % 1000) * 1000000;
+        const int result = ring->submit(1, timeout < 0 ? nullptr : &time);
+        if (result < 0 && result != -ETIME && result != -EINTR && result != -EBUSY)
+        {
+            throw std::runtime_error("Error at io_uring_enter(): " + std::string(strerror(-result)));
+        }
+
+        for (int i = 0; i < max_events; i++)
+        {
+            const io_uring_cqe *cqe = ring->peek();
+            if (cqe == nullptr) break;
+            const uint64_t token = cqe->user_data;
+            const int res = cqe->res;
+            const uint32_t flags = cqe->flags;
+            ring->advance();
+
+            if (token == CNET_IGNORE_TOKEN) continue;
+            if (token == CNET_WAKE_TOKEN)
+            {
+                uint64_t value;
+                [[maybe_unused]] const ssize_t read = ::read(wake_fd, &value, sizeof(value));
+                arm_wake();
+                continue;
+            }
+            if ((token & CNET_OPERATION_FLAG) != 0)
+            {
+                const auto it = operations.find(token);
+                if (it == operations.end()) continue;
+                // the record lives until the last completion of the operation, a multishot one completes many times
+                std::unique_ptr<operation> op;
+                if ((flags & IORING_CQE_F_MORE) == 0)
+                {
+                    op = std::move(it->second);
+                    operations.erase(it);
+                }
+                const operation &current = op != nullptr ? *op : *it->second;
+                if (current.handler) current.handler(res, flags);
+                if ((flags & IORING_CQE_F_BUFFER) != 0) ring->recycle_buffer(flags >> IORING_CQE_BUFFER_SHIFT);
+                continue;
+            }
+
+            const int fd = static_cast<int>(token & 0xffffffff);
+            const auto it = watches.find(fd);
+            if (it == watches.end() || it->second->generation != token >> 32) continue;
+            const std::shared_ptr<watch_entry> entry = it->second;
+            entry->armed = false;
+            entry->handler(res < 0 ? EPOLLERR : static_cast<uint32_t>(res));
+            // the poll is one-shot, arming it again keeps watching level-triggered like epoll
+            const auto current = watches.find(fd);
+            if (current != watches.end() && current->second == entry && !entry->armed) arm_poll(fd, *entry);
+        }
+    }
+
+    int event_loop::submit_connect(const int fd, const sockaddr *address, const socklen_t length, completion_handler handler)
+    {
+        if (free_files.empty()) throw std::runtime_error("No free io_uring file slots");
+        const int slot = free_files.back();
+        free_files.pop_back();
+
+        auto update = std::make_unique<operation>();
+        update->file = fd;
+        io_uring_sqe *sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_FILES_UPDATE;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&update->file);
+        sqe->len = 1;
+        sqe->off = static_cast<uint64_t>(slot);
+        // linked, so the connect only starts once the socket is in its slot
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = add_operation(std::move(update));
+
+        auto connect = std::make_unique<operation>();
+        connect->handler = std::move(handler);
+        memcpy(&connect->address, address, std::min<size_t>(length, sizeof(sockaddr_storage)));
+        sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->fd = slot;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->addr = reinterpret_cast<uint64_t>(&connect->address);
+        sqe->off = length;
+        sqe->user_data = add_operation(std::move(connect));
+        return slot;
+    }
+
+    void event_loop::submit_send(const int slot, const const_buffer *buffers, const size_t count, completion_handler handler)
+    {
+        auto send = std::make_unique<operation>();
+        send->handler = std::move(handler);
+        send->vectors.resize(std::min<size_t>(count, IOV_MAX));
+        for (size_t i = 0; i < send->vectors.size(); i++)
+        {
+            send->vectors[i].iov_base = const_cast<char *>(buffers[i].data);
+            send->vectors[i].iov_len = buffers[i].size;
+        }
+        send->header.msg_iov = send->vectors.data();
+        send->header.msg_iovlen = send->vectors.size();
+        io_uring_sqe *sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = slot;
+        sqe->flags = IOSQE_FIXED_FILE;
+        // the header and its segments live in the operation, as the kernel may read them only once the send runs
+        sqe->addr = reinterpret_cast<uint64_t>(&send->header);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = add_operation(std::move(send));
+    }
+
+    unsigned long long event_loop::submit_receive(const int slot, completion_handler handler)
+    {
+        auto receive = std::make_unique<operation>();
+        receive->handler = std::move(handler);
+        io_uring_sqe *sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = slot;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->buf_group = ring->get_buffer_group();
+        const unsigned long long id = add_operation(std::move(receive));
+        sqe->user_data = id;
+        return id;
+    }
+
+    std::string_view event_loop::get_buffer(const int result, const uint32_t flags) const
+    {
+        if (result <= 0 || (flags & IORING_CQE_F_BUFFER) == 0) return {};
+        return ring->get_buffer(flags >> IORING_CQE_BUFFER_SHIFT, static_cast<size_t>(result));
+    }
+
+    void event_loop::cancel(const unsigned long long id)
+    {
+        if (operations.find(id) == operations.end()) return;
+        io_uring_sqe *sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = id;
+        sqe->user_data = CNET_IGNORE_TOKEN;
+    }
+
+    void event_loop::release_file(const int slot)
+    {
+        io_uring_sqe *sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = slot;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_FD_FIXED | IORING_ASYNC_CANCEL_ALL;
+        // a hard link, the slot is cleared even when there was nothing left to cancel
+        sqe->flags = IOSQE_IO_HARDLINK;
+        sqe->user_data = CNET_IGNORE_TOKEN;
+
+        auto update = std::make_unique<operation>();
+        update->handler = [this, slot](int, uint32_t) { free_files.push_back(slot); };
+        sqe = ring->get_sqe();
+        sqe->opcode = IORING_OP_FILES_UPDATE;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&update->file);
+        sqe->len = 1;
+        sqe->off = static_cast<uint64_t>(slot);
+        sqe->user_data = add_operation(std::move(update));
+    }
+
+    unsigned long long event_loop::get_enters() const
+    {
+        return ring != nullptr ? ring->get_enters() : 0;
+    }
+#endif
+
+    event_loop_group::event_loop_group(unsigned int count, const loop_backend backend)
+    {
+        if (count == 0) count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < count; i++)
+        {
+            loops.push_back(std::make_unique<event_loop>(backend));
+        }
+        for (const auto &loop: loops)
+        {
+            threads.emplace_back([&loop] { loop->run(true); });
+        }
+    }
+
+    event_loop_group::~event_loop_group()
+    {
+        stop();
+    }
+
+    event_loop &event_loop_group::next()
+    {
+        return *loops[turn++ % loops.size()];
+    }
+
+    void event_loop_group::stop()
+    {
+        for (const auto &loop: loops)
+        {
+            loop->stop();
+        }
+        for (std::thread &thread: threads)
+        {
+            if (thread.joinable()) thread.join();
+        }
+    }
+} // cnet
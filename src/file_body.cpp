@@ -0,0 +1,71 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "file_body.h"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef __WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace cnet
+{
+    static int open_file(const std::string &path, unsigned long long &size)
+    {
+#ifdef __WIN32
+        const int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+        struct _stat64 status{};
+        if (fd >= 0 && _fstat64(fd, &status) != 0)
+        {
+            _close(fd);
+            throw std::runtime_error("Failed to read the size of " + path);
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat status{};
+        if (fd >= 0 && fstat(fd, &status) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to read the size of " + path);
+        }
+#endif
+        if (fd < 0) throw std::runtime_error("Failed to open " + path);
+        size = static_cast<unsigned long long>(status.st_size);
+        return fd;
+    }
+
+    file_body::file_body(const std::string &path)
+    {
+        fd = open_file(path, size);
+    }
+
+    file_body::file_body(const std::string &path, const unsigned long long offset, const unsigned long long size): offset(offset), size(size)
+    {
+        unsigned long long file_size;
+        fd = open_file(path, file_size);
+        if (offset > file_size || size > file_size - offset)
+        {
+#ifdef __WIN32
+            _close(fd);
+#else
+            close(fd);
+#endif
+            throw std::runtime_error("The range is past the end of " + path);
+        }
+    }
+
+    file_body::~file_body()
+    {
+#ifdef __WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+} // cnet
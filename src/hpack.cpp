@@ -0,0 +1,400 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "hpack.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace cnet
+{
+    // RFC 7541 appendix B, the code of each byte value and its length in bits
+    static constexpr uint32_t huffman_codes[256] = {
+        0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+        0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+        0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+        0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+        0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+        0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+        0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+        0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+        0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+        0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+        0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+        0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+        0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+        0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+        0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+        0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+        0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+        0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+        0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+        0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+        0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+        0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+        0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+        0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+        0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+        0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+        0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+        0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+        0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+        0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+        0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee
+    };
+    static constexpr uint8_t huffman_lengths[256] = {
+        13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+        28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+        6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+        5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+        13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+        15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+        6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+        20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+        24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+        22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+        21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+        26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+        19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+        20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+        26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26
+    };
+
+    // RFC 7541 appendix A, index 1 is the first entry
+    static const std::pair<std::string_view, std::string_view> static_table[61] = {
+        {":authority", ""}, {":method", "GET"}, {":method", "POST"},
+        {":path", "/"}, {":path", "/index.html"}, {":scheme", "http"},
+        {":scheme", "https"}, {":status", "200"}, {":status", "204"},
+        {":status", "206"}, {":status", "304"}, {":status", "400"},
+        {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+        {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""},
+        {"accept", ""}, {"access-control-allow-origin", ""}, {"age", ""},
+        {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+        {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""},
+        {"content-length", ""}, {"content-location", ""}, {"content-range", ""},
+        {"content-type", ""}, {"cookie", ""}, {"date", ""},
+        {"etag", ""}, {"expect", ""}, {"expires", ""},
+        {"from", ""}, {"host", ""}, {"if-match", ""},
+        {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""},
+        {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""},
+        {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+        {"proxy-authorization", ""}, {"range", ""}, {"referer", ""},
+        {"refresh", ""}, {"retry-after", ""}, {"server", ""},
+        {"set-cookie", ""}, {"strict-transport-security", ""}, {"transfer-encoding", ""},
+        {"user-agent", ""}, {"vary", ""}, {"via", ""},
+        {"www-authenticate", ""}
+    };
+
+    // the Huffman code as a binary tree, each node holding its two children or, in a leaf, the byte it decodes to
+    struct huffman_node
+    {
+        int16_t children[2] = {-1, -1};
+        int16_t symbol = -1;
+    };
+
+    static const std::vector<huffman_node> &huffman_tree()
+    {
+        static const std::vector<huffman_node> tree = []
+        {
+            std::vector<huffman_node> nodes(1);
+            // 256 is the end of string symbol, which is only ever seen as the padding of the last byte
+            for (int symbol = 0; symbol <= 256; symbol++)
+            {
+                const uint32_t code = symbol < 256 ? huffman_codes[symbol] : 0x3fffffff;
+                const int length = symbol < 256 ? huffman_lengths[symbol] : 30;
+                size_t node = 0;
+                for (int bit = length - 1; bit >= 0; bit--)
+                {
+                    const int branch = static_cast<int>(code >> bit & 1);
+                    if (nodes[node].children[branch] < 0)
+                    {
+                        nodes[node].children[branch] = static_cast<int16_t>(nodes.size());
+                        nodes.emplace_back();
+                    }
+                    node = static_cast<size_t>(nodes[node].children[branch]);
+                }
+                nodes[node].symbol = static_cast<int16_t>(symbol);
+            }
+            return nodes;
+        }();
+        return tree;
+    }
+
+    static size_t huffman_size(const std::string_view text)
+    {
+        size_t bits = 0;
+        for (const unsigned char c: text)
+        {
+            bits += huffman_lengths[c];
+        }
+        return (bits + 7) / 8;
+    }
+
+    static void huffman_encode(const std::string_view text, std::string &out)
+    {
+        uint64_t pending = 0;
+        int count = 0;
+        for (const unsigned char c: text)
+        {
+            pending = pending << huffman_lengths[c] | huffman_codes[c];
+            count += huffman_lengths[c];
+            while (count >= 8)
+            {
+                count -= 8;
+                out += static_cast<char>(pending >> count);
+            }
+        }
+        // the last byte is padded with the most significant bits of the end of string code, all ones
+        if (count > 0) out += static_cast<char>(pending << (8 - count) | 0xff >> count);
+    }
+
+    static void huffman_decode(const std::string_view data, std::string &out)
+    {
+        const std::vector<huffman_node> &tree = huffman_tree();
+        size_t node = 0;
+        int depth = 0;
+        bool ones = true;
+        for (const unsigned char c: data)
+        {
+            for (int bit = 7; bit >= 0; bit--)
+            {
+                const int branch = c >> bit & 1;
+                node = static_cast<size_t>(tree[node].children[branch]);
+                depth++;
+                ones = ones && branch == 1;
+                if (tree[node].symbol < 0) continue;
+                if (tree[node].symbol == 256) throw std::runtime_error("HPACK string contains the end of string symbol");
+                out += static_cast<char>(tree[node].symbol);
+                node = 0;
+                depth = 0;
+                ones = true;
+            }
+        }
+        // RFC 7541 section 5.2, padding longer than 7 bits or not made of ones is an error
+        if (depth > 7 || !ones) throw std::runtime_error("Invalid HPACK string padding");
+    }
+
+    static void encode_integer(std::string &out, const uint8_t flags, const int prefix, size_t value)
+    {
+        const size_t limit = (1u << prefix) - 1;
+        if (value < limit)
+        {
+            out += static_cast<char>(flags | value);
+            return;
+        }
+        out += static_cast<char>(flags | limit);
+        value -= limit;
+        while (value >= 128)
+        {
+            out += static_cast<char>(value % 128 + 128);
+            value /= 128;
+        }
+        out += static_cast<char>(value);
+    }
+
+    static size_t decode_integer(const std::string_view block, size_t &position, const int prefix)
+    {
+        if (position >= block.size()) throw std::runtime_error("Truncated HPACK integer");
+        const size_t limit = (1u << prefix) - 1;
+        size_t value = static_cast<unsigned char>(block[position++]) & limit;
+        if (value < limit) return value;
+        for (int shift = 0;; shift += 7)
+        {
+            // a header block is bounded, so any integer that needs more than 28 bits is malformed
+            if (position >= block.size() || shift > 21) throw std::runtime_error("Invalid HPACK integer");
+            const unsigned char byte = block[position++];
+            value += static_cast<size_t>(byte & 127) << shift;
+            if ((byte & 128) == 0) return value;
+        }
+    }
+
+    static void encode_string(std::string &out, const std::string_view text)
+    {
+        if (const size_t size = huffman_size(text); size < text.size())
+        {
+            encode_integer(out, 0x80, 7, size);
+            huffman_encode(text, out);
+            return;
+        }
+        encode_integer(out, 0, 7, text.size());
+        out += text;
+    }
+
+    static std::string decode_string(const std::string_view block, size_t &position)
+    {
+        if (position >= block.size()) throw std::runtime_error("Truncated HPACK string");
+        const bool huffman = (block[position] & 0x80) != 0;
+        const size_t length = decode_integer(block, position, 7);
+        if (length > block.size() - position) throw std::runtime_error("Truncated HPACK string");
+        std::string text;
+        if (huffman) huffman_decode(block.substr(position, length), text);
+        else text.assign(block.data() + position, length);
+        position += length;
+        return text;
+    }
+
+    static size_t entry_size(const std::string_view name, const std::string_view value)
+    {
+        // RFC 7541 section 4.1, 32 bytes stand for the overhead of an entry
+        return name.size() + value.size() + 32;
+    }
+
+    void hpack_table::evict(const size_t limit)
+    {
+        while (size > limit && !entries.empty())
+        {
+            size -= entry_size(entries.back().name, entries.back().value);
+            entries.pop_back();
+        }
+    }
+
+    void hpack_table::add(const std::string_view name, const std::string_view value)
+    {
+        const size_t added = entry_size(name, value);
+        if (added > max_size)
+        {
+            evict(0);
+            return;
+        }
+        evict(max_size - added);
+        entries.push_front({std::string(name), std::string(value)});
+        size += added;
+    }
+
+    void hpack_table::resize(const size_t max_size)
+    {
+        this->max_size = max_size;
+        evict(max_size);
+    }
+
+    const hpack_field *hpack_table::get(const size_t index) const
+    {
+        static const std::vector<hpack_field> statics = []
+        {
+            std::vector<hpack_field> fields;
+            for (const auto &[name, value]: static_table)
+            {
+                fields.push_back({std::string(name), std::string(value)});
+            }
+            return fields;
+        }();
+        if (index == 0) return nullptr;
+        if (index <= statics.size()) return &statics[index - 1];
+        if (index - statics.size() > entries.size()) return nullptr;
+        return &entries[index - statics.size() - 1];
+    }
+
+    size_t hpack_table::find(const std::string_view name, const std::string_view value, bool &name_only) const
+    {
+        size_t name_index = 0;
+        for (size_t i = 0; i < std::size(static_table); i++)
+        {
+            if (static_table[i].first != name) continue;
+            if (static_table[i].second == value)
+            {
+                name_only = false;
+                return i + 1;
+            }
+            if (name_index == 0) name_index = i + 1;
+        }
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].name != name) continue;
+            if (entries[i].value == value)
+            {
+                name_only = false;
+                return std::size(static_table) + i + 1;
+            }
+            if (name_index == 0) name_index = std::size(static_table) + i + 1;
+        }
+        name_only = true;
+        return name_index;
+    }
+
+    void hpack_encoder::set_max_table_size(size_t size)
+    {
+        size = std::min<size_t>(size, CNET_HPACK_TABLE_SIZE);
+        if (size == table.get_max_size()) return;
+        lowest_size = std::min(lowest_size, size);
+        size_changed = true;
+        table.resize(size);
+    }
+
+    void hpack_encoder::encode(const std::vector<hpack_field> &fields, std::string &block)
+    {
+        // RFC 7541 section 4.2, a shrink followed by a growth is signalled as both, smallest first
+        if (size_changed)
+        {
+            if (lowest_size < table.get_max_size()) encode_integer(block, 0x20, 5, lowest_size);
+            encode_integer(block, 0x20, 5, table.get_max_size());
+            lowest_size = table.get_max_size();
+            size_changed = false;
+        }
+        for (const auto &[name, value]: fields)
+        {
+            bool name_only = false;
+            const size_t index = table.find(name, value, name_only);
+            if (index != 0 && !name_only)
+            {
+                encode_integer(block, 0x80, 7, index);
+                continue;
+            }
+            const bool sensitive = name == "authorization" || name == "proxy-authorization" || name == "cookie";
+            const bool changing = name == ":path" || name == "content-length";
+            if (sensitive) encode_integer(block, 0x10, 4, index);
+            else if (changing) encode_integer(block, 0x00, 4, index);
+            else encode_integer(block, 0x40, 6, index);
+            if (index == 0) encode_string(block, name);
+            encode_string(block, value);
+            if (!sensitive && !changing) table.add(name, value);
+        }
+    }
+
+    void hpack_decoder::set_max_table_size(const size_t size)
+    {
+        max_table_size = size;
+        if (table.get_max_size() > size) table.resize(size);
+    }
+
+    void hpack_decoder::decode(const std::string_view block, std::vector<hpack_field> &fields)
+    {
+        size_t position = 0;
+        bool first = true;
+        while (position < block.size())
+        {
+            const auto byte = static_cast<unsigned char>(block[position]);
+            if ((byte & 0x80) != 0)
+            {
+                const hpack_field *field = table.get(decode_integer(block, position, 7));
+                if (field == nullptr) throw std::runtime_error("Invalid HPACK index");
+                fields.push_back(*field);
+            } else if ((byte & 0xe0) == 0x20)
+            {
+                // RFC 7541 section 4.2, only allowed at the start of a block and within the advertised limit
+                const size_t size = decode_integer(block, position, 5);
+                if (!first || size > max_table_size) throw std::runtime_error("Invalid HPACK table size update");
+                table.resize(size);
+                continue;
+            } else
+            {
+                // a literal with incremental indexing, without indexing or never indexed
+                const bool indexing = (byte & 0xc0) == 0x40;
+                const size_t index = decode_integer(block, position, indexing ? 6 : 4);
+                hpack_field field;
+                if (index == 0) field.name = decode_string(block, position);
+                else if (const hpack_field *named = table.get(index); named != nullptr) field.name = named->name;
+                else throw std::runtime_error("Invalid HPACK index");
+                field.value = decode_string(block, position);
+                if (indexing) table.add(field.name, field.value);
+                fields.push_back(std::move(field));
+            }
+            first = false;
+        }
+    }
+} // cnet
@@ -0,0 +1,825 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "http2_connection.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#ifndef __WIN32
+#include <poll.h>
+#endif
+
+#include "http_method.h"
+
+namespace cnet
+{
+    // RFC 9113 section 6, the frame types
+    static constexpr uint8_t frame_data = 0x0;
+    static constexpr uint8_t frame_headers = 0x1;
+    static constexpr uint8_t frame_priority = 0x2;
+    static constexpr uint8_t frame_rst_stream = 0x3;
+    static constexpr uint8_t frame_settings = 0x4;
+    static constexpr uint8_t frame_push_promise = 0x5;
+    static constexpr uint8_t frame_ping = 0x6;
+    static constexpr uint8_t frame_goaway = 0x7;
+    static constexpr uint8_t frame_window_update = 0x8;
+    static constexpr uint8_t frame_continuation = 0x9;
+
+    static constexpr uint8_t flag_end_stream = 0x1;
+    static constexpr uint8_t flag_ack = 0x1;
+    static constexpr uint8_t flag_end_headers = 0x4;
+    static constexpr uint8_t flag_padded = 0x8;
+    static constexpr uint8_t flag_priority = 0x20;
+
+    // RFC 9113 section 7, the error codes
+    static constexpr uint32_t no_error = 0x0;
+    static constexpr uint32_t protocol_error = 0x1;
+    static constexpr uint32_t internal_error = 0x2;
+    static constexpr uint32_t flow_control_error = 0x3;
+    static constexpr uint32_t frame_size_error = 0x6;
+    static constexpr uint32_t cancel = 0x8;
+    static constexpr uint32_t compression_error = 0x9;
+
+    static constexpr uint16_t setting_header_table_size = 0x1;
+    static constexpr uint16_t setting_enable_push = 0x2;
+    static constexpr uint16_t setting_max_concurrent_streams = 0x3;
+    static constexpr uint16_t setting_initial_window_size = 0x4;
+    static constexpr uint16_t setting_max_frame_size = 0x5;
+    static constexpr uint16_t setting_no_rfc7540_priorities = 0x9;
+
+    static constexpr uint32_t max_window = 0x7fffffff;
+    static constexpr size_t frame_header_size = 9;
+    // request bodies are framed only as fast as they are sent, so a large one isn't copied whole into the output
+    static constexpr size_t max_buffered_output = 262144;
+    static constexpr std::string_view client_preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    /**
+     * @brief An error that ends the whole connection, sent to the server in a GOAWAY frame.
+     */
+    struct connection_error: std::runtime_error
+    {
+        uint32_t code;
+
+        connection_error(const uint32_t code, const std::string &what): std::runtime_error("HTTP/2 connection error: " + what), code(code) {}
+    };
+
+    static void put_u16(std::string &out, const uint16_t value)
+    {
+        out += static_cast<char>(value >> 8);
+        out += static_cast<char>(value);
+    }
+
+    static void put_u32(std::string &out, const uint32_t value)
+    {
+        put_u16(out, static_cast<uint16_t>(value >> 16));
+        put_u16(out, static_cast<uint16_t>(value));
+    }
+
+    static uint32_t get_u32(const std::string_view data, const size_t offset)
+    {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(data.data() + offset);
+        return static_cast<uint32_t>(bytes[0]) << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3];
+    }
+
+    static std::string error_name(const uint32_t code)
+    {
+        static const char *names[] = {
+            "NO_ERROR", "PROTOCOL_ERROR", "INTERNAL_ERROR", "FLOW_CONTROL_ERROR", "SETTINGS_TIMEOUT", "STREAM_CLOSED",
+            "FRAME_SIZE_ERROR", "REFUSED_STREAM", "CANCEL", "COMPRESSION_ERROR", "CONNECT_ERROR", "ENHANCE_YOUR_CALM",
+            "INADEQUATE_SECURITY", "HTTP_1_1_REQUIRED"
+        };
+        return code < std::size(names) ? names[code] : "error " + std::to_string(code);
+    }
+
+    static std::string to_lower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](const unsigned char c) { return static_cast<char>(tolower(c)); });
+        return text;
+    }
+
+    // RFC 9113 section 8.2.2, headers that only mean something to an HTTP/1.1 connection
+    static bool is_connection_specific(const std::string &name)
+    {
+        return name == "connection" || name == "keep-alive" || name == "proxy-connection" || name == "transfer-encoding" || name == "upgrade" || name == "host";
+    }
+
+    // strips the padding of a DATA or HEADERS frame
+    static std::string_view unpad(std::string_view payload, const uint8_t flags)
+    {
+        if ((flags & flag_padded) == 0) return payload;
+        if (payload.empty()) throw connection_error(protocol_error, "padded frame without a pad length");
+        const size_t padding = static_cast<unsigned char>(payload[0]);
+        if (padding >= payload.size()) throw connection_error(protocol_error, "padding longer than the frame");
+        return payload.substr(1, payload.size() - 1 - padding);
+    }
+
+    http2_connection::http2_connection(tcp_client connection, http2_options options): connection(std::move(connection)), options(std::move(options))
+    {
+        if (this->connection.get_alpn_protocol() != "h2") throw std::runtime_error("The server didn't negotiate HTTP/2");
+        this->options.stream_window = std::clamp<uint32_t>(this->options.stream_window, 1, max_window);
+        this->options.connection_window = std::clamp<uint32_t>(this->options.connection_window, 65535, max_window);
+        if (this->options.max_concurrent_streams == 0) this->options.max_concurrent_streams = 1;
+    }
+
+    http2_connection http2_connection::connect(const std::string &host, const unsigned int port, http2_options options)
+    {
+        tls_options tls = options.tls;
+        if (std::find(tls.alpn.begin(), tls.alpn.end(), "h2") == tls.alpn.end()) tls.alpn.insert(tls.alpn.begin(), "h2");
+        tcp_client client = tcp_client::connect(host, port, options.timeout, options.host_resolver);
+        try
+        {
+            client.create_ssl_handshake(tls_context::get(tls));
+            return http2_connection(std::move(client), std::move(options));
+        } catch (...)
+        {
+            client.close();
+            throw;
+        }
+    }
+
+    void http2_connection::start()
+    {
+        started = true;
+        output += client_preface;
+        std::string settings;
+        put_u16(settings, setting_enable_push);
+        put_u32(settings, 0);
+        put_u16(settings, setting_initial_window_size);
+        put_u32(settings, options.stream_window);
+        // RFC 9218, the priority header replaces the dependency tree of RFC 7540
+        put_u16(settings, setting_no_rfc7540_priorities);
+        put_u32(settings, 1);
+        write_frame(frame_settings, 0, 0, settings);
+        if (options.connection_window > receive_window)
+        {
+            write_window_update(0, static_cast<uint32_t>(options.connection_window - receive_window));
+            receive_window = options.connection_window;
+        }
+    }
+
+    void http2_connection::write_frame(const uint8_t type, const uint8_t flags, const uint32_t stream_id, const std::string_view payload)
+    {
+        output += static_cast<char>(payload.size() >> 16);
+        put_u16(output, static_cast<uint16_t>(payload.size()));
+        output += static_cast<char>(type);
+        output += static_cast<char>(flags);
+        put_u32(output, stream_id);
+        output += payload;
+    }
+
+    void http2_connection::write_window_update(const uint32_t stream_id, const uint32_t increment)
+    {
+        std::string payload;
+        put_u32(payload, increment);
+        write_frame(frame_window_update, 0, stream_id, payload);
+    }
+
+    void http2_connection::submit(http_message &message, response_handler handler, body_sink *sink, const int urgency)
+    {
+        if (closed) throw std::runtime_error("The HTTP/2 connection is closed");
+        if (going_away) throw std::runtime_error("The HTTP/2 server is going away");
+        auto submitted = std::make_unique<stream>();
+        submitted->message = &message;
+        submitted->handler = std::move(handler);
+        submitted->sink = sink;
+        submitted->urgency = std::clamp(urgency, 0, 7);
+        submitted->response = http_message(message.url, message.method);
+        waiting.push_back(std::move(submitted));
+    }
+
+    void http2_connection::open_streams()
+    {
+        while (!waiting.empty() && !going_away && streams.size() < std::min(options.max_concurrent_streams, peer_max_streams))
+        {
+            if (next_stream_id > max_window)
+            {
+                // stream ids can't be reused, a new connection is needed for the rest
+                going_away = true;
+                while (!waiting.empty())
+                {
+                    std::unique_ptr<stream> failed = std::move(waiting.front());
+                    waiting.pop_front();
+                    fail_stream(std::move(failed), std::make_exception_ptr(std::runtime_error("The HTTP/2 connection ran out of stream ids")));
+                }
+                return;
+            }
+            std::unique_ptr<stream> opened = std::move(waiting.front());
+            waiting.pop_front();
+            opened->id = next_stream_id;
+            next_stream_id += 2;
+            opened->send_window = peer_stream_window;
+            opened->receive_window = options.stream_window;
+
+            http_message &message = *opened->message;
+            std::string authority(message.url.get_authority());
+            if (const std::optional<std::string_view> host = message.headers.get(known_header::host); host.has_value()) authority = *host;
+            std::string path(message.url.get_path());
+            path += message.url.get_parameter_query();
+
+            std::vector<hpack_field> fields;
+            fields.reserve(message.headers.size() + 6);
+            fields.push_back({":method", http_method_to_str(message.method)});
+            fields.push_back({":scheme", "https"});
+            fields.push_back({":authority", std::move(authority)});
+            fields.push_back({":path", std::move(path)});
+            bool has_length = false;
+            for (const auto &[key, value]: message.headers)
+            {
+                std::string name = to_lower(std::string(key));
+                if (is_connection_specific(name) || (name == "te" && value != "trailers")) continue;
+                has_length = has_length || name == "content-length";
+                fields.push_back({std::move(name), std::string(value)});
+            }
+            if (!has_length && !message.body.empty()) fields.push_back({"content-length", std::to_string(message.body.size())});
+            if (opened->urgency != CNET_HTTP2_DEFAULT_URGENCY && !message.headers.get(known_header::priority).has_value())
+            {
+                fields.push_back({"priority", "u=" + std::to_string(opened->urgency)});
+            }
+
+            std::string block;
+            encoder.encode(fields, block);
+            opened->request_done = message.body.empty();
+            // a block larger than a frame continues in CONTINUATION frames, with nothing else in between
+            size_t offset = 0;
+            do
+            {
+                const size_t size = std::min<size_t>(block.size() - offset, peer_max_frame_size);
+                const bool last = offset + size == block.size();
+                const uint8_t flags = (last ? flag_end_headers : 0) | (offset == 0 && opened->request_done ? flag_end_stream : 0);
+                write_frame(offset == 0 ? frame_headers : frame_continuation, flags, opened->id, std::string_view(block).substr(offset, size));
+                offset += size;
+            } while (offset < block.size());
+
+            const uint32_t id = opened->id;
+            streams.emplace(id, std::move(opened));
+        }
+    }
+
+    void http2_connection::send_bodies()
+    {
+        // the most urgent streams send first, those of equal urgency take turns a frame at a time
+        std::vector<stream *> sending;
+        for (const auto &[id, open]: streams)
+        {
+            if (!open->request_done) sending.push_back(open.get());
+        }
+        std::stable_sort(sending.begin(), sending.end(), [](const stream *a, const stream *b) { return a->urgency < b->urgency; });
+
+        bool progress = true;
+        while (progress && output.size() - output_sent < max_buffered_output && send_window > 0)
+        {
+            progress = false;
+            for (size_t i = 0; i < sending.size(); i++)
+            {
+                stream *current = sending[i];
+                // a less urgent stream only sends once the more urgent ones are done or out of credit
+                if (progress && current->urgency != sending[0]->urgency) break;
+                if (current->request_done || current->send_window <= 0 || send_window <= 0) continue;
+                const std::string &body = current->message->body;
+                const size_t size = std::min<size_t>({body.size() - current->body_sent, peer_max_frame_size, static_cast<size_t>(current->send_window), static_cast<size_t>(send_window)});
+                current->request_done = current->body_sent + size == body.size();
+                write_frame(frame_data, current->request_done ? flag_end_stream : 0, current->id, std::string_view(body).substr(current->body_sent, size));
+                current->body_sent += size;
+                current->send_window -= static_cast<long long>(size);
+                send_window -= static_cast<long long>(size);
+                progress = true;
+            }
+            sending.erase(std::remove_if(sending.begin(), sending.end(), [](const stream *s) { return s->request_done; }), sending.end());
+        }
+    }
+
+    bool http2_connection::flush(io_wait &wait)
+    {
+        wait = io_wait::none;
+        while (output_sent < output.size())
+        {
+            // bounded, so a TLS write retried after the output grew is never shorter than the first try
+            const size_t sent = connection.try_send(output.data() + output_sent, std::min<size_t>(output.size() - output_sent, CNET_TLS_RECORD_SIZE), wait);
+            if (wait != io_wait::none) return false;
+            output_sent += sent;
+        }
+        output.clear();
+        output_sent = 0;
+        return true;
+    }
+
+    bool http2_connection::receive(io_wait &wait)
+    {
+        bool received = false;
+        while (!closed)
+        {
+            if (input_used > 0 && input_used * 2 >= input.size())
+            {
+                input.erase(0, input_used);
+                input_used = 0;
+            }
+            const size_t filled = input.size();
+            input.resize(filled + CNET_HTTP2_FRAME_SIZE);
+            const size_t count = connection.try_receive(input.data() + filled, CNET_HTTP2_FRAME_SIZE, wait);
+            input.resize(filled + count);
+            if (count == 0)
+            {
+                if (wait != io_wait::none) return received;
+                throw std::runtime_error("The HTTP/2 server closed the connection");
+            }
+            received = true;
+
+            while (!closed && input.size() - input_used >= frame_header_size)
+            {
+                const std::string_view available = std::string_view(input).substr(input_used);
+                const uint32_t length = get_u32(available, 0) >> 8;
+                if (length > CNET_HTTP2_FRAME_SIZE) throw connection_error(frame_size_error, "frame of " + std::to_string(length) + " bytes");
+                if (available.size() < frame_header_size + length) break;
+                const auto type = static_cast<uint8_t>(available[3]);
+                const auto flags = static_cast<uint8_t>(available[4]);
+                const uint32_t stream_id = get_u32(available, 5) & max_window;
+                input_used += frame_header_size + length;
+                process_frame(type, flags, stream_id, available.substr(frame_header_size, length));
+            }
+        }
+        return received;
+    }
+
+    void http2_connection::process_frame(const uint8_t type, const uint8_t flags, const uint32_t stream_id, const std::string_view payload)
+    {
+        if (!settings_received && type != frame_settings) throw connection_error(protocol_error, "the server preface isn't a SETTINGS frame");
+        if (header_stream != 0 && type != frame_continuation) throw connection_error(protocol_error, "header block interrupted by another frame");
+        switch (type)
+        {
+            case frame_data:
+            {
+                if (stream_id == 0) throw connection_error(protocol_error, "DATA on stream 0");
+                process_data(stream_id, unpad(payload, flags), static_cast<uint32_t>(payload.size()), (flags & flag_end_stream) != 0);
+                break;
+            }
+            case frame_headers:
+            {
+                if (stream_id == 0) throw connection_error(protocol_error, "HEADERS on stream 0");
+                std::string_view fragment = unpad(payload, flags);
+                if ((flags & flag_priority) != 0)
+                {
+                    if (fragment.size() < 5) throw connection_error(frame_size_error, "HEADERS too short for its priority");
+                    fragment.remove_prefix(5);
+                }
+                if ((flags & flag_end_headers) != 0)
+                {
+                    process_headers(stream_id, fragment, (flags & flag_end_stream) != 0);
+                    break;
+                }
+                header_block.assign(fragment);
+                header_stream = stream_id;
+                header_end_stream = (flags & flag_end_stream) != 0;
+                break;
+            }
+            case frame_continuation:
+            {
+                if (header_stream == 0 || stream_id != header_stream) throw connection_error(protocol_error, "unexpected CONTINUATION");
+                if (header_block.size() + payload.size() > CNET_HTTP2_MAX_HEADER_BLOCK) throw connection_error(internal_error, "header block too large");
+                header_block += payload;
+                if ((flags & flag_end_headers) == 0) break;
+                const std::string block = std::move(header_block);
+                header_block.clear();
+                header_stream = 0;
+                process_headers(stream_id, block, header_end_stream);
+                break;
+            }
+            case frame_priority:
+                // RFC 9113 section 5.3.2, the dependency tree is deprecated and its frames are ignored
+                break;
+            case frame_rst_stream:
+            {
+                if (stream_id == 0) throw connection_error(protocol_error, "RST_STREAM on stream 0");
+                if (payload.size() != 4) throw connection_error(frame_size_error, "RST_STREAM of " + std::to_string(payload.size()) + " bytes");
+                const auto it = streams.find(stream_id);
+                if (it == streams.end()) break;
+                std::unique_ptr<stream> reset_stream = std::move(it->second);
+                streams.erase(it);
+                fail_stream(std::move(reset_stream), std::make_exception_ptr(std::runtime_error("Stream reset by the HTTP/2 server: " + error_name(get_u32(payload, 0)))));
+                break;
+            }
+            case frame_settings:
+                if (stream_id != 0) throw connection_error(protocol_error, "SETTINGS on a stream");
+                process_settings(flags, payload);
+                break;
+            case frame_push_promise:
+                // push is disabled by the client's first SETTINGS
+                throw connection_error(protocol_error, "PUSH_PROMISE while push is disabled");
+            case frame_ping:
+                if (stream_id != 0) throw connection_error(protocol_error, "PING on a stream");
+                if (payload.size() != 8) throw connection_error(frame_size_error, "PING of " + std::to_string(payload.size()) + " bytes");
+                if ((flags & flag_ack) == 0) write_frame(frame_ping, flag_ack, 0, payload);
+                break;
+            case frame_goaway:
+            {
+                if (stream_id != 0) throw connection_error(protocol_error, "GOAWAY on a stream");
+                if (payload.size() < 8) throw connection_error(frame_size_error, "GOAWAY of " + std::to_string(payload.size()) + " bytes");
+                const uint32_t last_stream = get_u32(payload, 0) & max_window;
+                const uint32_t code = get_u32(payload, 4);
+                going_away = true;
+                // the streams above the last one weren't processed and can safely be sent again on a new connection
+                std::string reason = "The HTTP/2 server is going away (" + error_name(code) + ")";
+                if (payload.size() > 8) reason += ": " + std::string(payload.substr(8));
+                for (auto it = streams.upper_bound(last_stream); it != streams.end();)
+                {
+                    std::unique_ptr<stream> unprocessed = std::move(it->second);
+                    it = streams.erase(it);
+                    fail_stream(std::move(unprocessed), std::make_exception_ptr(std::runtime_error(reason)));
+                }
+                while (!waiting.empty())
+                {
+                    std::unique_ptr<stream> unsent = std::move(waiting.front());
+                    waiting.pop_front();
+                    fail_stream(std::move(unsent), std::make_exception_ptr(std::runtime_error(reason)));
+                }
+                break;
+            }
+            case frame_window_update:
+            {
+                if (payload.size() != 4) throw connection_error(frame_size_error, "WINDOW_UPDATE of " + std::to_string(payload.size()) + " bytes");
+                const uint32_t increment = get_u32(payload, 0) & max_window;
+                if (stream_id == 0)
+                {
+                    if (increment == 0) throw connection_error(protocol_error, "WINDOW_UPDATE of 0");
+                    send_window += increment;
+                    if (send_window > max_window) throw connection_error(flow_control_error, "connection window above 2^31-1");
+                    break;
+                }
+                const auto it = streams.find(stream_id);
+                if (it == streams.end()) break;
+                if (increment == 0)
+                {
+                    reset(stream_id, protocol_error, "WINDOW_UPDATE of 0");
+                    break;
+                }
+                it->second->send_window += increment;
+                if (it->second->send_window > max_window) reset(stream_id, flow_control_error, "stream window above 2^31-1");
+                break;
+            }
+            default:
+                // RFC 9113 section 5.5, unknown frame types are ignored
+                break;
+        }
+    }
+
+    void http2_connection::process_settings(const uint8_t flags, const std::string_view payload)
+    {
+        if ((flags & flag_ack) != 0)
+        {
+            if (!payload.empty()) throw connection_error(frame_size_error, "SETTINGS acknowledgement with a payload");
+            return;
+        }
+        if (payload.size() % 6 != 0) throw connection_error(frame_size_error, "SETTINGS of " + std::to_string(payload.size()) + " bytes");
+        settings_received = true;
+        for (size_t offset = 0; offset < payload.size(); offset += 6)
+        {
+            const uint16_t id = static_cast<uint16_t>(static_cast<unsigned char>(payload[offset]) << 8 | static_cast<unsigned char>(payload[offset + 1]));
+            const uint32_t value = get_u32(payload, offset + 2);
+            switch (id)
+            {
+                case setting_header_table_size:
+                    encoder.set_max_table_size(value);
+                    break;
+                case setting_max_concurrent_streams:
+                    peer_max_streams = value;
+                    break;
+                case setting_initial_window_size:
+                {
+                    if (value > max_window) throw connection_error(flow_control_error, "initial window above 2^31-1");
+                    // RFC 9113 section 6.9.2, the change applies to every open stream, which may leave one in debt
+                    const long long delta = static_cast<long long>(value) - peer_stream_window;
+                    peer_stream_window = value;
+                    for (const auto &[stream_id, open]: streams)
+                    {
+                        open->send_window += delta;
+                        if (open->send_window > max_window) throw connection_error(flow_control_error, "stream window above 2^31-1");
+                    }
+                    break;
+                }
+                case setting_max_frame_size:
+                    if (value < CNET_HTTP2_FRAME_SIZE || value > 0xffffff) throw connection_error(protocol_error, "invalid SETTINGS_MAX_FRAME_SIZE");
+                    peer_max_frame_size = value;
+                    break;
+                default:
+                    // SETTINGS_ENABLE_PUSH only binds servers, the others are ignored when unknown
+                    break;
+            }
+        }
+        write_frame(frame_settings, flag_ack, 0, {});
+    }
+
+    void http2_connection::process_headers(const uint32_t stream_id, const std::string_view block, const bool end_stream)
+    {
+        // the block is decoded even for a stream that's gone, or the table would fall out of step with the server's
+        std::vector<hpack_field> fields;
+        try
+        {
+            decoder.decode(block, fields);
+        } catch (const std::runtime_error &e)
+        {
+            throw connection_error(compression_error, e.what());
+        }
+
+        const auto it = streams.find(stream_id);
+        if (it == streams.end())
+        {
+            if (stream_id % 2 == 0 || stream_id >= next_stream_id) throw connection_error(protocol_error, "HEADERS on a stream that wasn't opened");
+            return;
+        }
+        stream &current = *it->second;
+        http_message &response = current.response;
+        if (current.headers_received)
+        {
+            // trailers, which end the stream
+            if (!end_stream)
+            {
+                reset(stream_id, protocol_error, "Trailers that don't end the stream");
+                return;
+            }
+            for (hpack_field &field: fields)
+            {
+                if (!field.name.empty() && field.name[0] == ':') continue;
+                response.headers.add(field.name, field.value);
+            }
+            complete(stream_id);
+            return;
+        }
+
+        int status = 0;
+        for (const hpack_field &field: fields)
+        {
+            if (field.name == ":status") status = std::atoi(field.value.c_str());
+        }
+        if (status < 100 || status > 999)
+        {
+            reset(stream_id, protocol_error, "Response without a valid :status");
+            return;
+        }
+        // an interim response, the final one follows on the same stream
+        if (status < 200)
+        {
+            if (end_stream) reset(stream_id, protocol_error, "Interim response that ends the stream");
+            return;
+        }
+
+        response.status_code = status;
+        response.headers.clear();
+        for (const hpack_field &field: fields)
+        {
+            if (!field.name.empty() && field.name[0] != ':') response.headers.add(field.name, field.value);
+        }
+        if (const std::optional<std::string_view> length = response.headers.get(known_header::content_length); length.has_value())
+        {
+            response.content_length = std::strtoull(std::string(*length).c_str(), nullptr, 10);
+        }
+        current.headers_received = true;
+        if (current.sink != nullptr)
+        {
+            try
+            {
+                current.sink->start(response);
+            } catch (const std::exception &e)
+            {
+                reset(stream_id, cancel, e.what());
+                return;
+            }
+        }
+        if (end_stream) complete(stream_id);
+    }
+
+    void http2_connection::process_data(const uint32_t stream_id, const std::string_view payload, const uint32_t length, const bool end_stream)
+    {
+        // the whole frame counts against the windows, padding included
+        receive_window -= length;
+        if (receive_window < 0) throw connection_error(flow_control_error, "the server sent more than the connection window");
+        unacknowledged += length;
+        if (unacknowledged >= options.connection_window / 2)
+        {
+            write_window_update(0, unacknowledged);
+            receive_window += unacknowledged;
+            unacknowledged = 0;
+        }
+
+        const auto it = streams.find(stream_id);
+        if (it == streams.end())
+        {
+            if (stream_id % 2 == 0 || stream_id >= next_stream_id) throw connection_error(protocol_error, "DATA on a stream that wasn't opened");
+            return;
+        }
+        stream &current = *it->second;
+        if (!current.headers_received)
+        {
+            reset(stream_id, protocol_error, "DATA before the response headers");
+            return;
+        }
+        current.receive_window -= length;
+        if (current.receive_window < 0)
+        {
+            reset(stream_id, flow_control_error, "The server sent more than the stream window");
+            return;
+        }
+        try
+        {
+            if (current.sink != nullptr) current.sink->write(payload);
+            else current.response.body.append(payload);
+        } catch (const std::exception &e)
+        {
+            reset(stream_id, cancel, e.what());
+            return;
+        }
+        if (end_stream)
+        {
+            complete(stream_id);
+            return;
+        }
+        current.unacknowledged += length;
+        if (current.unacknowledged >= options.stream_window / 2)
+        {
+            write_window_update(stream_id, current.unacknowledged);
+            current.receive_window += current.unacknowledged;
+            current.unacknowledged = 0;
+        }
+    }
+
+    void http2_connection::complete(const uint32_t stream_id)
+    {
+        const auto it = streams.find(stream_id);
+        std::unique_ptr<stream> done = std::move(it->second);
+        streams.erase(it);
+        // RFC 9113 section 8.1, a server may answer before the whole request body was sent, the rest isn't needed
+        if (!done->request_done)
+        {
+            std::string payload;
+            put_u32(payload, cancel);
+            write_frame(frame_rst_stream, 0, stream_id, payload);
+        }
+
+        http_message &response = done->response;
+        if (!response.headers.get(known_header::content_length).has_value()) response.content_length = response.body.size();
+        if (done->sink != nullptr)
+        {
+            try
+            {
+                done->sink->finish();
+            } catch (...)
+            {
+                fail_stream(std::move(done), std::current_exception());
+                return;
+            }
+        }
+        http_message &message = *done->message;
+        message.status_code = response.status_code;
+        message.headers = std::move(response.headers);
+        message.body = std::move(response.body);
+        message.content_length = response.content_length;
+        if (done->handler) done->handler(message, nullptr);
+    }
+
+    void http2_connection::reset(const uint32_t stream_id, const uint32_t error_code, const std::string &reason)
+    {
+        const auto it = streams.find(stream_id);
+        if (it == streams.end()) return;
+        std::unique_ptr<stream> failed = std::move(it->second);
+        streams.erase(it);
+        std::string payload;
+        put_u32(payload, error_code);
+        write_frame(frame_rst_stream, 0, stream_id, payload);
+        fail_stream(std::move(failed), std::make_exception_ptr(std::runtime_error(reason)));
+    }
+
+    void http2_connection::fail_stream(const std::unique_ptr<stream> failed, const std::exception_ptr error)
+    {
+        if (failed->handler) failed->handler(*failed->message, error);
+    }
+
+    void http2_connection::fail_all(const std::exception_ptr error, const uint32_t error_code)
+    {
+        if (!closed)
+        {
+            // the server learns why, if the connection still works
+            std::string payload;
+            // no stream is ever opened by the server, push being disabled
+            put_u32(payload, 0);
+            put_u32(payload, error_code);
+            write_frame(frame_goaway, 0, 0, payload);
+            try
+            {
+                io_wait wait;
+                flush(wait);
+            } catch (...)
+            {
+            }
+            connection.close();
+            closed = true;
+        }
+        std::vector<std::unique_ptr<stream>> failed;
+        for (auto &[id, open]: streams)
+        {
+            failed.push_back(std::move(open));
+        }
+        streams.clear();
+        while (!waiting.empty())
+        {
+            failed.push_back(std::move(waiting.front()));
+            waiting.pop_front();
+        }
+        for (std::unique_ptr<stream> &stream: failed)
+        {
+            fail_stream(std::move(stream), error);
+        }
+    }
+
+    void http2_connection::run()
+    {
+        if (closed)
+        {
+            fail_all(std::make_exception_ptr(std::runtime_error("The HTTP/2 connection is closed")), no_error);
+            return;
+        }
+        if (!started) start();
+        auto last_progress = std::chrono::steady_clock::now();
+        while (!closed && (!streams.empty() || !waiting.empty()))
+        {
+            try
+            {
+                open_streams();
+                send_bodies();
+                const size_t pending = output.size() - output_sent;
+                io_wait write_wait = io_wait::none;
+                const bool flushed = flush(write_wait);
+                const bool sent = output.size() - output_sent < pending || (flushed && pending > 0);
+                io_wait read_wait = io_wait::none;
+                const bool received = receive(read_wait);
+                if (sent || received)
+                {
+                    last_progress = std::chrono::steady_clock::now();
+                    continue;
+                }
+                // more body can be framed as soon as the output drained, without waiting for the socket
+                if (flushed && send_window > 0 && std::any_of(streams.begin(), streams.end(), [](const auto &open) { return !open.second->request_done && open.second->send_window > 0; }))
+                {
+                    continue;
+                }
+
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - last_progress).count();
+                if (elapsed >= options.timeout) throw std::runtime_error("Timed out waiting for the HTTP/2 server");
+#ifndef __WIN32
+                pollfd fd{static_cast<int>(connection.get_sock()), 0, 0};
+                for (const io_wait wait: {read_wait, write_wait})
+                {
+                    if (wait == io_wait::read) fd.events |= POLLIN;
+                    else if (wait == io_wait::write) fd.events |= POLLOUT;
+                }
+                if (poll(&fd, 1, static_cast<int>(options.timeout - elapsed)) < 0 && errno != EINTR)
+                {
+                    throw std::runtime_error("Error at poll(): " + std::string(strerror(errno)));
+                }
+#else
+                WSAPOLLFD fd{connection.get_sock(), 0, 0};
+                for (const io_wait wait: {read_wait, write_wait})
+                {
+                    if (wait == io_wait::read) fd.events |= POLLRDNORM;
+                    else if (wait == io_wait::write) fd.events |= POLLWRNORM;
+                }
+                WSAPoll(&fd, 1, static_cast<int>(options.timeout - elapsed));
+#endif
+            } catch (const connection_error &e)
+            {
+                fail_all(std::current_exception(), e.code);
+            } catch (...)
+            {
+                fail_all(std::current_exception(), internal_error);
+            }
+        }
+        // what is left, e.g. the last WINDOW_UPDATE or SETTINGS acknowledgement, goes out with the next run
+        if (!closed)
+        {
+            try
+            {
+                io_wait wait;
+                flush(wait);
+            } catch (...)
+            {
+            }
+        }
+    }
+
+    void http2_connection::make_request(http_message &message, body_sink *sink)
+    {
+        std::exception_ptr failure;
+        submit(message, [&failure](http_message &, const std::exception_ptr error) { failure = error; }, sink);
+        run();
+        if (failure != nullptr) std::rethrow_exception(failure);
+    }
+
+    void http2_connection::close()
+    {
+        if (closed) return;
+        fail_all(std::make_exception_ptr(std::runtime_error("The HTTP/2 connection was closed")), no_error);
+    }
+} // cnet
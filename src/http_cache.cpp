@@ -0,0 +1,583 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "http_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#ifdef __WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace cnet
+{
+    namespace
+    {
+        /**
+         * @brief The Cache-Control directives that matter to a private cache, of a request or of a response.
+         */
+        struct cache_directives
+        {
+            bool no_store = false;
+            bool no_cache = false;
+            bool must_revalidate = false;
+            bool max_stale = false;
+            std::optional<long long> max_age;
+            std::optional<long long> min_fresh;
+            std::optional<long long> max_stale_seconds; // nullopt with max_stale set accepts any staleness
+        };
+
+        std::string_view trim(std::string_view value)
+        {
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            return value;
+        }
+
+        // delta-seconds, RFC 9111 section 1.2.2, too large a value is capped rather than rejected
+        std::optional<long long> parse_seconds(std::string_view text)
+        {
+            if (text.size() >= 2 && text.front() == '"' && text.back() == '"') text = text.substr(1, text.size() - 2);
+            if (text.empty()) return std::nullopt;
+            long long value = 0;
+            for (const char c: text)
+            {
+                if (c < '0' || c > '9') return std::nullopt;
+                value = std::min(value * 10 + (c - '0'), 1LL << 31);
+            }
+            return value;
+        }
+
+        cache_directives parse_directives(const http_headers &headers)
+        {
+            cache_directives result;
+            bool found = false;
+            for (const auto &[name, value]: headers)
+            {
+                if (!http_headers::equals_ignore_case(name, "Cache-Control")) continue;
+                found = true;
+                std::string_view list = value;
+                while (!list.empty())
+                {
+                    const size_t comma = list.find(',');
+                    const std::string_view directive = trim(list.substr(0, comma));
+                    list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+                    const size_t equals = directive.find('=');
+                    const std::string_view key = trim(directive.substr(0, equals));
+                    const std::string_view argument = equals == std::string_view::npos ? std::string_view() : trim(directive.substr(equals + 1));
+                    if (http_headers::equals_ignore_case(key, "no-store")) result.no_store = true;
+                    // no-cache listing field names is treated as no-cache of the whole response
+                    else if (http_headers::equals_ignore_case(key, "no-cache")) result.no_cache = true;
+                    else if (http_headers::equals_ignore_case(key, "must-revalidate")) result.must_revalidate = true;
+                    // an invalid max-age makes the response stale, RFC 9111 section 4.2.1
+                    else if (http_headers::equals_ignore_case(key, "max-age")) result.max_age = parse_seconds(argument).value_or(0);
+                    else if (http_headers::equals_ignore_case(key, "min-fresh")) result.min_fresh = parse_seconds(argument);
+                    else if (http_headers::equals_ignore_case(key, "max-stale"))
+                    {
+                        result.max_stale = true;
+                        result.max_stale_seconds = parse_seconds(argument);
+                    }
+                }
+            }
+            // Pragma: no-cache is only honored without Cache-Control, RFC 9111 section 5.4
+            if (!found)
+            {
+                if (const std::optional<std::string_view> pragma = headers.get(known_header::pragma); pragma.has_value())
+                {
+                    result.no_cache = http_headers::equals_ignore_case(trim(*pragma), "no-cache");
+                }
+            }
+            return result;
+        }
+
+        // the status codes a response can be stored and heuristically fresh with, RFC 9110 section 15.1
+        bool is_heuristically_cacheable(const int status)
+        {
+            switch (status)
+            {
+                case 200: case 203: case 204: case 300: case 301: case 308: case 404: case 405: case 410: case 414: case 501:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // days since the epoch of a date in the proleptic Gregorian calendar
+        long long days_from_civil(long long year, const unsigned month, const unsigned day)
+        {
+            year -= month <= 2;
+            const long long era = (year >= 0 ? year : year - 399) / 400;
+            const auto year_of_era = static_cast<unsigned>(year - era * 400);
+            const unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+            const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+            return era * 146097 + static_cast<long long>(day_of_era) - 719468;
+        }
+
+        bool read_number(std::string_view &text, const size_t min_digits, const size_t max_digits, int &value)
+        {
+            size_t digits = 0;
+            value = 0;
+            while (digits < text.size() && digits < max_digits && text[digits] >= '0' && text[digits] <= '9')
+            {
+                value = value * 10 + (text[digits++] - '0');
+            }
+            text.remove_prefix(digits);
+            return digits >= min_digits;
+        }
+
+        bool read_month(std::string_view &text, int &month)
+        {
+            static constexpr std::string_view months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+            if (text.size() < 3) return false;
+            for (int i = 0; i < 12; i++)
+            {
+                if (http_headers::equals_ignore_case(text.substr(0, 3), months[i]))
+                {
+                    month = i + 1;
+                    text.remove_prefix(3);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool read_char(std::string_view &text, const char c)
+        {
+            if (text.empty() || text.front() != c) return false;
+            text.remove_prefix(1);
+            return true;
+        }
+
+        bool read_time(std::string_view &text, int &hour, int &minute, int &second)
+        {
+            return read_number(text, 2, 2, hour) && read_char(text, ':') && read_number(text, 2, 2, minute) && read_char(text, ':') &&
+                   read_number(text, 2, 2, second) && hour < 24 && minute < 60 && second <= 60;
+        }
+
+        // the file name of a key, FNV-1a so it is the same on every platform and run
+        std::string hash_key(const std::string_view key)
+        {
+            unsigned long long hash = 14695981039346656037ULL;
+            for (const char c: key)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ULL;
+            }
+            char name[17];
+            snprintf(name, sizeof(name), "%016llx", hash);
+            return name;
+        }
+    }
+
+    bool http_cache_entry::has_validator() const
+    {
+        return headers.get(known_header::etag).has_value() || headers.get(known_header::last_modified).has_value();
+    }
+
+    size_t http_cache_entry::get_size() const
+    {
+        size_t total = sizeof(http_cache_entry) + key.size() + body.size();
+        for (const auto &[name, value]: headers) total += name.size() + value.size();
+        return total;
+    }
+
+    http_cache::http_cache(http_cache_options options): options(std::move(options))
+    {
+        if (!this->options.directory.empty())
+        {
+            std::error_code error;
+            std::filesystem::create_directories(this->options.directory, error);
+        }
+    }
+
+    long long http_cache::now()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::string http_cache::make_key(const uri &url)
+    {
+        std::string key = url.to_string();
+        if (const std::string_view fragment = url.get_fragment(); !fragment.empty()) key.resize(key.size() - fragment.size() - 1);
+        return key;
+    }
+
+    std::optional<long long> http_cache::parse_http_date(std::string_view text)
+    {
+        text = trim(text);
+        int day, month, year, hour, minute, second;
+        if (const size_t comma = text.find(','); comma != std::string_view::npos)
+        {
+            // IMF-fixdate "Sun, 06 Nov 1994 08:49:37 GMT" or the obsolete RFC 850 "Sunday, 06-Nov-94 08:49:37 GMT"
+            text.remove_prefix(comma + 1);
+            if (!read_char(text, ' ') || !read_number(text, 1, 2, day)) return std::nullopt;
+            const bool rfc850 = !text.empty() && text.front() == '-';
+            const char separator = rfc850 ? '-' : ' ';
+            if (!read_char(text, separator) || !read_month(text, month) || !read_char(text, separator)) return std::nullopt;
+            if (!read_number(text, rfc850 ? 2 : 4, rfc850 ? 2 : 4, year)) return std::nullopt;
+            // a two digit year more than 50 years in the future is in the past century, RFC 9110 section 5.6.7
+            if (rfc850) year += year < 70 ? 2000 : 1900;
+            if (!read_char(text, ' ') || !read_time(text, hour, minute, second) || trim(text) != "GMT") return std::nullopt;
+        } else
+        {
+            // the obsolete asctime "Sun Nov  6 08:49:37 1994"
+            const size_t space = text.find(' ');
+            if (space == std::string_view::npos) return std::nullopt;
+            text.remove_prefix(space + 1);
+            if (!read_month(text, month) || !read_char(text, ' ')) return std::nullopt;
+            read_char(text, ' ');
+            if (!read_number(text, 1, 2, day) || !read_char(text, ' ') || !read_time(text, hour, minute, second)) return std::nullopt;
+            if (!read_char(text, ' ') || !read_number(text, 4, 4, year) || !trim(text).empty()) return std::nullopt;
+        }
+        if (day < 1 || day > 31) return std::nullopt;
+        return days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    }
+
+    bool http_cache::is_cacheable(const http_message &request)
+    {
+        if (request.method != http_method::GET || !request.body.empty()) return false;
+        // conditional and range requests are the caller's own business, their answers aren't the full response
+        for (const std::string_view name: {"If-None-Match", "If-Modified-Since", "If-Match", "If-Unmodified-Since", "If-Range", "Range"})
+        {
+            if (request.headers.contains(name)) return false;
+        }
+        return !parse_directives(request.headers).no_store;
+    }
+
+    bool http_cache::is_storable(const http_message &response)
+    {
+        if (!is_heuristically_cacheable(response.status_code) || parse_directives(response.headers).no_store) return false;
+        for (const auto &[name, value]: response.headers)
+        {
+            if (http_headers::equals_ignore_case(name, "Vary") && trim(value) == "*") return false;
+        }
+        return true;
+    }
+
+    void http_cache::prepare(http_cache_entry &entry) const
+    {
+        // RFC 9111 section 4.2.3
+        const long long date = entry.headers.get(known_header::date).has_value()
+                                   ? parse_http_date(*entry.headers.get(known_header::date)).value_or(entry.response_time)
+                                   : entry.response_time;
+        const std::optional<std::string_view> age = entry.headers.get(known_header::age);
+        const long long age_value = age.has_value() ? parse_seconds(trim(*age)).value_or(0) : 0;
+        const long long apparent_age = std::max(0LL, entry.response_time - date);
+        const long long response_delay = std::max(0LL, entry.response_time - entry.request_time);
+        entry.initial_age = std::max(apparent_age, age_value + response_delay);
+
+        // RFC 9111 section 4.2.1, a private cache ignores s-maxage
+        const cache_directives directives = parse_directives(entry.headers);
+        entry.no_cache = directives.no_cache;
+        entry.must_revalidate = directives.must_revalidate;
+        if (directives.max_age.has_value()) entry.lifetime = *directives.max_age;
+        else if (const std::optional<std::string_view> expires = entry.headers.get(known_header::expires); expires.has_value())
+        {
+            // an invalid date, e.g. "0", means already expired
+            const std::optional<long long> time = parse_http_date(*expires);
+            entry.lifetime = time.has_value() ? std::max(0LL, *time - date) : 0;
+        } else if (const std::optional<std::string_view> modified = entry.headers.get(known_header::last_modified);
+            options.heuristic_freshness && modified.has_value() && is_heuristically_cacheable(entry.status_code))
+        {
+            const std::optional<long long> time = parse_http_date(*modified);
+            entry.lifetime = time.has_value() ? std::max(0LL, date - *time) / CNET_CACHE_HEURISTIC_FRACTION : 0;
+        } else entry.lifetime = 0;
+    }
+
+    std::shared_ptr<const http_cache_entry> http_cache::lookup(const http_message &request, bool &fresh)
+    {
+        fresh = false;
+        const std::string key = make_key(request.url);
+        std::shared_ptr<const http_cache_entry> entry;
+        {
+            std::lock_guard lock(mutex);
+            if (const auto it = index.find(key); it != index.end())
+            {
+                entries.splice(entries.begin(), entries, it->second);
+                entry = *it->second;
+            }
+        }
+        if (entry == nullptr && !options.directory.empty())
+        {
+            entry = read_file(key);
+            if (entry != nullptr) insert(entry);
+        }
+
+        // RFC 9111 section 4.1, the request must carry the same values of the headers the response varies on
+        const auto matches = [&request](const std::pair<std::string, std::optional<std::string>> &field)
+        {
+            const std::optional<std::string_view> value = request.headers.get(field.first);
+            return value.has_value() == field.second.has_value() && (!value.has_value() || trim(*value) == *field.second);
+        };
+        if (entry == nullptr || !std::all_of(entry->vary.begin(), entry->vary.end(), matches))
+        {
+            ++misses;
+            return nullptr;
+        }
+
+        // RFC 9111 sections 4.2 and 5.2.1
+        const cache_directives directives = parse_directives(request.headers);
+        const long long age = entry->get_age(now());
+        const bool revalidate = directives.no_cache || entry->no_cache;
+        bool usable = !revalidate && age < entry->lifetime && (!directives.max_age.has_value() || age <= *directives.max_age);
+        if (usable && directives.min_fresh.has_value()) usable = entry->lifetime - age >= *directives.min_fresh;
+        if (!usable && !revalidate && directives.max_stale && !entry->must_revalidate && age >= entry->lifetime &&
+            (!directives.max_age.has_value() || age <= *directives.max_age))
+        {
+            usable = !directives.max_stale_seconds.has_value() || age - entry->lifetime <= *directives.max_stale_seconds;
+        }
+        if (usable)
+        {
+            fresh = true;
+            ++hits;
+            return entry;
+        }
+        ++misses;
+        return entry->has_validator() ? entry : nullptr;
+    }
+
+    void http_cache::add_validators(const http_cache_entry &entry, http_message &request)
+    {
+        if (const std::optional<std::string_view> etag = entry.headers.get(known_header::etag); etag.has_value())
+        {
+            request.headers.set("If-None-Match", *etag);
+        }
+        if (const std::optional<std::string_view> modified = entry.headers.get(known_header::last_modified); modified.has_value())
+        {
+            request.headers.set("If-Modified-Since", *modified);
+        }
+    }
+
+    void http_cache::remove_validators(http_message &request)
+    {
+        request.headers.remove("If-None-Match");
+        request.headers.remove("If-Modified-Since");
+    }
+
+    bool http_cache::store(const uri &url, const http_headers &request_headers, const http_message &response, const std::string_view body,
+                           const long long request_time, const long long response_time)
+    {
+        if (!is_storable(response) || body.size() > options.max_entry_size) return false;
+        auto entry = std::make_shared<http_cache_entry>();
+        entry->key = make_key(url);
+        entry->status_code = response.status_code;
+        for (const auto &[name, value]: response.headers)
+        {
+            // RFC 9111 section 3.1, connection specific fields aren't stored, nor the framing of a body stored whole
+            if (http_headers::equals_ignore_case(name, "Connection") || http_headers::equals_ignore_case(name, "Keep-Alive") ||
+                http_headers::equals_ignore_case(name, "Transfer-Encoding")) continue;
+            entry->headers.add(name, value);
+            if (!http_headers::equals_ignore_case(name, "Vary")) continue;
+            std::string_view list = value;
+            while (!list.empty())
+            {
+                const size_t comma = list.find(',');
+                const std::string_view field = trim(list.substr(0, comma));
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+                if (field.empty()) continue;
+                const std::optional<std::string_view> sent = request_headers.get(field);
+                entry->vary.emplace_back(std::string(field), sent.has_value() ? std::optional<std::string>(trim(*sent)) : std::nullopt);
+            }
+        }
+        entry->body = body;
+        entry->request_time = request_time;
+        entry->response_time = response_time;
+        prepare(*entry);
+        // a response that is never fresh and can't be revalidated would never be used
+        if (entry->lifetime <= entry->initial_age && !entry->has_validator()) return false;
+
+        if (!options.directory.empty()) write_file(*entry);
+        insert(std::move(entry));
+        ++stores;
+        return true;
+    }
+
+    std::shared_ptr<const http_cache_entry> http_cache::update(const http_cache_entry &entry, const http_message &not_modified,
+                                                               const long long request_time, const long long response_time)
+    {
+        auto updated = std::make_shared<http_cache_entry>(entry);
+        std::vector<std::string_view> replaced;
+        for (const auto &[name, value]: not_modified.headers)
+        {
+            // RFC 9111 section 3.2, the fields describing the body or the connection of the 304 aren't taken
+            if (http_headers::equals_ignore_case(name, "Content-Length") || http_headers::equals_ignore_case(name, "Content-Encoding") ||
+                http_headers::equals_ignore_case(name, "Transfer-Encoding") || http_headers::equals_ignore_case(name, "Connection") ||
+                http_headers::equals_ignore_case(name, "Keep-Alive")) continue;
+            const bool first = std::none_of(replaced.begin(), replaced.end(), [name = name](const std::string_view other) { return http_headers::equals_ignore_case(name, other); });
+            if (first)
+            {
+                updated->headers.remove(name);
+                replaced.push_back(name);
+            }
+            updated->headers.add(name, value);
+        }
+        updated->request_time = request_time;
+        updated->response_time = response_time;
+        prepare(*updated);
+
+        if (!options.directory.empty()) write_file(*updated);
+        insert(updated);
+        ++revalidations;
+        return updated;
+    }
+
+    void http_cache::copy(const http_cache_entry &entry, http_message &response, const bool with_body)
+    {
+        response.status_code = entry.status_code;
+        response.headers = entry.headers;
+        // RFC 9111 section 5.1
+        response.headers.set("Age", std::to_string(entry.get_age(now())));
+        response.content_length = entry.body.size();
+        if (with_body) response.body.assign(entry.body);
+        else response.body.clear();
+    }
+
+    void http_cache::insert(std::shared_ptr<const http_cache_entry> entry)
+    {
+        std::lock_guard lock(mutex);
+        if (const auto it = index.find(entry->key); it != index.end())
+        {
+            size -= (*it->second)->get_size();
+            entries.erase(it->second);
+            index.erase(it);
+        }
+        size += entry->get_size();
+        entries.push_front(std::move(entry));
+        index[entries.front()->key] = entries.begin();
+        while (size > options.max_size && !entries.empty())
+        {
+            size -= entries.back()->get_size();
+            index.erase(entries.back()->key);
+            entries.pop_back();
+            ++evictions;
+        }
+    }
+
+    void http_cache::invalidate(const uri &url)
+    {
+        const std::string key = make_key(url);
+        {
+            std::lock_guard lock(mutex);
+            if (const auto it = index.find(key); it != index.end())
+            {
+                size -= (*it->second)->get_size();
+                entries.erase(it->second);
+                index.erase(it);
+            }
+        }
+        if (!options.directory.empty())
+        {
+            std::error_code error;
+            std::filesystem::remove(get_path(key), error);
+        }
+    }
+
+    void http_cache::clear()
+    {
+        std::lock_guard lock(mutex);
+        entries.clear();
+        index.clear();
+        size = 0;
+    }
+
+    http_cache_stats http_cache::get_stats() const
+    {
+        http_cache_stats stats;
+        stats.hits = hits.load();
+        stats.revalidations = revalidations.load();
+        stats.misses = misses.load();
+        stats.stores = stores.load();
+        stats.evictions = evictions.load();
+        return stats;
+    }
+
+    std::string http_cache::get_path(const std::string_view key) const
+    {
+        return (std::filesystem::path(options.directory) / (hash_key(key) + ".cache")).string();
+    }
+
+    // a stored response is a text header followed by the body, e.g.
+    //   cnet-cache 1
+    //   key https://example.com/config.json
+    //   status 200
+    //   time 1792238400 1792238401
+    //   vary Accept-Language: en
+    //   header ETag: "v1"
+    //   body 42
+    // and is replaced atomically, so a crash leaves either the previous or the new version behind. Every write goes
+    // to a temporary file of its own, named after the process and a counter, so threads and processes sharing the
+    // directory never write into the same one
+    void http_cache::write_file(const http_cache_entry &entry) const
+    {
+        static std::atomic<unsigned long long> writes = 0;
+        const std::string path = get_path(entry.key);
+        const std::string temporary = path + "." + std::to_string(getpid()) + "." + std::to_string(writes++) + ".tmp";
+        bool written;
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file << "cnet-cache 1\nkey " << entry.key << "\nstatus " << entry.status_code << "\ntime " << entry.request_time << " " << entry.response_time << "\n";
+            for (const auto &[name, value]: entry.vary)
+            {
+                file << "vary " << name;
+                if (value.has_value()) file << ": " << *value;
+                file << "\n";
+            }
+            for (const auto &[name, value]: entry.headers) file << "header " << name << ": " << value << "\n";
+            file << "body " << entry.body.size() << "\n";
+            file.write(entry.body.data(), static_cast<std::streamsize>(entry.body.size()));
+            file.flush();
+            written = static_cast<bool>(file);
+        }
+        std::error_code error;
+        // a response that can't be written is only kept in memory
+        if (written) std::filesystem::rename(temporary, path, error);
+        if (!written || error) std::filesystem::remove(temporary, error);
+    }
+
+    std::shared_ptr<const http_cache_entry> http_cache::read_file(const std::string &key) const
+    {
+        std::ifstream file(get_path(key), std::ios::binary);
+        if (!file.is_open()) return nullptr;
+
+        auto entry = std::make_shared<http_cache_entry>();
+        std::string line;
+        // another key may share the file name, its response isn't this one
+        if (!std::getline(file, line) || line != "cnet-cache 1") return nullptr;
+        if (!std::getline(file, line) || line != "key " + key) return nullptr;
+        if (!std::getline(file, line) || sscanf(line.c_str(), "status %d", &entry->status_code) != 1) return nullptr;
+        if (!std::getline(file, line) || sscanf(line.c_str(), "time %lld %lld", &entry->request_time, &entry->response_time) != 2) return nullptr;
+        while (std::getline(file, line))
+        {
+            const std::string_view text = line;
+            const size_t colon = text.find(':');
+            if (text.rfind("vary ", 0) == 0)
+            {
+                if (colon == std::string_view::npos) entry->vary.emplace_back(std::string(text.substr(5)), std::nullopt);
+                else entry->vary.emplace_back(std::string(text.substr(5, colon - 5)), std::string(trim(text.substr(colon + 1))));
+            } else if (text.rfind("header ", 0) == 0 && colon != std::string_view::npos)
+            {
+                entry->headers.add(text.substr(7, colon - 7), trim(text.substr(colon + 1)));
+            } else if (text.rfind("body ", 0) == 0)
+            {
+                unsigned long long length;
+                if (sscanf(line.c_str(), "body %llu", &length) != 1 || length > options.max_entry_size) return nullptr;
+                entry->body.resize(length);
+                file.read(entry->body.data(), static_cast<std::streamsize>(length));
+                if (static_cast<unsigned long long>(file.gcount()) != length) return nullptr;
+                entry->key = key;
+                prepare(*entry);
+                return entry;
+            } else return nullptr;
+        }
+        return nullptr;
+    }
+} // cnet
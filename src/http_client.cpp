@@ -4,56 +4,452 @@
 
 #include "http_client.h"
 
+#include <algorithm>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <optional>
 #include <stdexcept>
+#include "http2_connection.h"
+#include "http_request_serializer.h"
 
 
 namespace cnet
 {
+    // the least free space a read asks the parser for, the read then fills whatever is free in its pooled buffer
+    static constexpr size_t receive_minimum = 4096;
+
+    static bool is_secure(const uri &url)
+    {
+        return url.get_scheme() == "https" || url.get_port() == 443;
+    }
+
+    static bool is_idempotent(const http_method method)
+    {
+        return method != http_method::POST && method != http_method::PATCH && method != http_method::CONNECT;
+    }
+
+    // RFC 9110 section 9.2.1
+    static bool is_safe(const http_method method)
+    {
+        return method == http_method::GET || method == http_method::HEAD || method == http_method::OPTIONS || method == http_method::TRACE;
+    }
+
+    // only requests without a body that can safely be sent again are pipelined
+    static bool is_pipelinable(const http_message &message)
+    {
+        return (message.method == http_method::GET || message.method == http_method::HEAD) && message.body.empty();
+    }
+
+    static void take_response(http_message &message, http_message &response)
+    {
+        message.status_code = response.status_code;
+        // the headers are copied into the message's own memory and the bodies traded, so both messages keep their
+        // memory for the next request
+        message.headers = response.headers;
+        message.body.swap(response.body);
+        message.content_length = response.content_length;
+    }
+
+    /**
+     * @brief Hands the body to the caller's sink while keeping a copy to store, and holds back a 304 answering the
+     * cache's own validators, which the sink receives as the stored response instead.
+     */
+    class cache_sink : public body_sink
+    {
+    private:
+        body_sink *next;
+        bool validating;
+        size_t limit;
+        bool passing = true;
+        bool capturing = false;
+
+    public:
+        std::string body;
+        bool overflowed = false;
+
+        cache_sink(body_sink *next, const bool validating, const size_t limit): next(next), validating(validating), limit(limit) {}
+
+        void start(const http_message &response) override
+        {
+            passing = !(validating && response.is_not_modified());
+            capturing = passing && http_cache::is_storable(response);
+            if (passing) next->start(response);
+        }
+
+        void write(const std::string_view chunk) override
+        {
+            if (!passing) return;
+            next->write(chunk);
+            if (!capturing) return;
+            if (chunk.size() > limit - body.size())
+            {
+                capturing = false;
+                overflowed = true;
+                std::string().swap(body);
+            } else body.append(chunk);
+        }
+
+        void finish() override
+        {
+            if (passing) next->finish();
+        }
+    };
+
+    static void deliver(const http_cache_entry &entry, http_message &message, body_sink *sink)
+    {
+        http_cache::copy(entry, message, sink == nullptr);
+        if (sink == nullptr) return;
+        sink->start(message);
+        if (!entry.body.empty()) sink->write(entry.body);
+        sink->finish();
+    }
+
     void http_client::make_request(http_message &message)
     {
-        this->message = message;
-        tcp = tcp_client::connect(message.url.get_host(), message.url.get_port());
-        if (message.url.get_port() == 443) tcp.create_ssl_handshake();
-        if (!preflight_check())
+        perform(message, nullptr);
+    }
+
+    void http_client::make_request(http_message &message, body_sink &sink)
+    {
+        perform(message, &sink);
+    }
+
+    void http_client::make_request(http_message &message, const std::function<void(std::string_view)> &callback)
+    {
+        callback_sink sink(callback);
+        perform(message, &sink);
+    }
+
+    void http_client::upload(http_message &message, const file_body &file)
+    {
+        perform(message, nullptr, &file);
+    }
+
+    void http_client::perform(http_message &message, body_sink *sink, const file_body *file)
+    {
+        if (options.coalescer == nullptr || sink != nullptr || file != nullptr || !request_coalescer::can_coalesce(message))
         {
-            throw std::runtime_error("Preflight check failed");
+            fetch(message, sink, file);
+            return;
         }
-        std::string response;
-        if (message.url.get_port() == 443)
+        validate(message);
+        // the key is taken before the cache adds any validators to the request
+        const std::string key = request_coalescer::make_key(message, options.decode_content ? content_decoder::get_accept_encoding() : std::string());
+        const std::shared_ptr<const http_message> shared = options.coalescer->run(key, [this, &message]() -> const http_message &
+        {
+            fetch(message, nullptr, nullptr);
+            return message;
+        });
+        if (shared == nullptr) return;
+        message.status_code = shared->status_code;
+        message.headers = shared->headers;
+        message.body.assign(shared->body);
+        message.content_length = shared->content_length;
+    }
+
+    void http_client::fetch(http_message &message, body_sink *sink, const file_body *file)
+    {
+        if (options.cache == nullptr)
         {
-            tcp.write_ssl(build_http_query(this->message));
-            response = tcp.read_ssl(4096);
-        } else
+            exchange(message, sink, file);
+            return;
+        }
+        if (file != nullptr || !http_cache::is_cacheable(message))
         {
-            tcp.send(build_http_query(this->message));
-            response = tcp.receive(4096);
+            exchange(message, sink, file);
+            // RFC 9111 section 4.4
+            if (!is_safe(message.method) && message.is_sucess()) options.cache->invalidate(message.url);
+            return;
         }
-        this->message.body = response;
-        parse_headers(response);
 
+        cache_state state;
+        if (use_cache(message, sink, state)) return;
+        std::optional<cache_sink> tee;
+        if (sink != nullptr) tee.emplace(sink, state.stored != nullptr, options.cache->get_options().max_entry_size);
+        try
+        {
+            exchange(message, tee.has_value() ? &*tee : nullptr, nullptr);
+        } catch (...)
+        {
+            if (state.stored != nullptr) http_cache::remove_validators(message);
+            throw;
+        }
+        if (tee.has_value()) update_cache(message, sink, state, tee->body, !tee->overflowed);
+        else update_cache(message, sink, state, message.body, true);
+    }
 
-        tcp.close();
+    bool http_client::use_cache(http_message &message, body_sink *sink, cache_state &state)
+    {
+        validate(message);
+        state.request_time = http_cache::now();
+        bool fresh;
+        state.stored = options.cache->lookup(message, fresh);
+        if (fresh)
+        {
+            deliver(*state.stored, message, sink);
+            return true;
+        }
+        state.request_headers = message.headers;
+        if (state.stored != nullptr) http_cache::add_validators(*state.stored, message);
+        return false;
     }
 
-    bool http_client::preflight_check()
+    void http_client::update_cache(http_message &message, body_sink *sink, cache_state &state, const std::string_view body, const bool complete)
+    {
+        const long long response_time = http_cache::now();
+        if (state.stored != nullptr && message.is_not_modified())
+        {
+            deliver(*options.cache->update(*state.stored, message, state.request_time, response_time), message, sink);
+            return;
+        }
+        // a response replacing the one being revalidated that can't be stored leaves nothing current to keep
+        const bool stored = complete && options.cache->store(message.url, state.request_headers, message, body, state.request_time, response_time);
+        if (!stored && state.stored != nullptr) options.cache->invalidate(message.url);
+    }
+
+    void http_client::exchange(http_message &message, body_sink *sink, const file_body *file)
+    {
+        validate(message);
+        // only the url and method are needed while connecting, the request is sent from the caller's message
+        this->message.reset(message.url, message.method);
+
+        // without a pool the connection is closed after the response, so tell the server not to keep it open
+        const std::optional<std::string_view> connection_header = message.find_header("Connection");
+        const bool close_connection = !connection_header.has_value() && options.pool == nullptr;
+        const bool request_close = connection_header.has_value() && http_response_parser::has_token(*connection_header, "close");
+        const std::string accept_encoding = options.decode_content ? content_decoder::get_accept_encoding() : std::string();
+        http_request_serializer request(message, close_connection, file, accept_encoding);
+        const bool offer_http2 = options.http2 && options.pool == nullptr && file == nullptr && options.preflight == preflight_mode::none;
+
+        for (int attempt = 0;; attempt++)
+        {
+            bool reused = false;
+            std::shared_ptr<http2_connection> http2;
+            if (offer_http2) http2 = open_http2(reused);
+            else open_connection(reused);
+            if (http2 != nullptr)
+            {
+                try
+                {
+                    http2->make_request(message, sink);
+                } catch (...)
+                {
+                    if (http2->is_open()) throw;
+                    http2_connections.erase(connection_pool::make_key(message.url.get_scheme(), message.url.get_host(), message.url.get_port()));
+                    // the server may have closed an idle connection just before it was reused, the response only
+                    // replaces the message once complete so the request can be sent again as it was
+                    if (reused && attempt == 0 && is_idempotent(message.method) && sink == nullptr) continue;
+                    throw;
+                }
+                if (!http2->is_open()) http2_connections.erase(connection_pool::make_key(message.url.get_scheme(), message.url.get_host(), message.url.get_port()));
+                return;
+            }
+            parser.reset();
+            // the connection goes back before the sink finishes, which can still throw, and must not be released twice
+            bool released = false;
+            try
+            {
+                if (options.preflight == preflight_mode::probe && !preflight_check())
+                {
+                    throw std::runtime_error("Preflight check failed");
+                }
+                request.rewind();
+                tcp.send(request.data(), request.count());
+                if (file != nullptr) tcp.send_file(file->get_fd(), file->get_offset(), file->get_size());
+
+                http_message &response = received;
+                response.reset(message.url, message.method);
+                std::optional<decoding_sink> decoder;
+                // a HEAD response has no body to decode, and its Content-Length describes the encoded one
+                if (options.decode_content && message.method != http_method::HEAD) decoder.emplace(sink, &response.body);
+                body_sink *target = decoder.has_value() ? &*decoder : sink;
+                const bool keep_alive = read_response(tcp, response, message.method == http_method::HEAD, target);
+                release_connection(keep_alive && !request_close);
+                released = true;
+                if (target != nullptr) target->finish();
+                if (decoder.has_value()) decoder->apply(response);
+                take_response(message, response);
+                return;
+            } catch (...)
+            {
+                if (released) throw;
+                release_connection(false);
+                // an idle connection may have been closed by the server just before it was reused, so try once more on a
+                // new one, unless part of the response has already been handed out
+                if (reused && attempt == 0 && is_idempotent(message.method) && !parser.headers_complete()) continue;
+                throw;
+            }
+        }
+    }
+
+    void http_client::make_requests(std::vector<http_message> &messages)
+    {
+        for (http_message &message: messages) validate(message);
+        for (size_t start = 0; start < messages.size();)
+        {
+            if (!is_pipelinable(messages[start]))
+            {
+                perform(messages[start++], nullptr);
+                continue;
+            }
+            // the run of requests up to the next one that can't be pipelined, grouped by host in the order given
+            std::vector<std::string> keys;
+            std::map<std::string, std::vector<http_message *>> batches;
+            std::vector<std::pair<http_message *, cache_state>> cached;
+            for (; start < messages.size() && is_pipelinable(messages[start]); start++)
+            {
+                if (options.cache != nullptr && http_cache::is_cacheable(messages[start]))
+                {
+                    cache_state state;
+                    if (use_cache(messages[start], nullptr, state)) continue;
+                    cached.emplace_back(&messages[start], std::move(state));
+                }
+                const uri &url = messages[start].url;
+                const std::string key = connection_pool::make_key(url.get_scheme(), url.get_host(), url.get_port());
+                std::vector<http_message *> &batch = batches[key];
+                if (batch.empty()) keys.push_back(key);
+                batch.push_back(&messages[start]);
+            }
+            try
+            {
+                for (const std::string &key: keys) pipeline(batches[key]);
+            } catch (...)
+            {
+                for (auto &[message, state]: cached)
+                {
+                    if (state.stored != nullptr) http_cache::remove_validators(*message);
+                }
+                throw;
+            }
+            for (auto &[message, state]: cached) update_cache(*message, nullptr, state, message->body, true);
+        }
+    }
+
+    void http_client::pipeline(const std::vector<http_message *> &batch)
+    {
+        this->message.reset(batch.front()->url, batch.front()->method);
+        // the serializers point into the messages, a deque never moves them as more are added
+        std::deque<http_request_serializer> requests;
+        const std::string accept_encoding = options.decode_content ? content_decoder::get_accept_encoding() : std::string();
+        for (const http_message *request: batch) requests.emplace_back(*request, false, nullptr, accept_encoding);
+
+        bool connected = false;
+        bool reused = false;
+        if (options.http2 && options.pool == nullptr && is_secure(this->message.url))
+        {
+            if (const std::shared_ptr<http2_connection> http2 = open_http2(reused); http2 != nullptr)
+            {
+                // every request goes out at once as a stream of its own, answered in whatever order the server likes
+                std::vector<http_message *> failed;
+                std::exception_ptr failure;
+                for (http_message *request: batch)
+                {
+                    http2->submit(*request, [&failed, &failure, request](http_message &, const std::exception_ptr &error)
+                    {
+                        if (error == nullptr) return;
+                        failed.push_back(request);
+                        if (failure == nullptr) failure = error;
+                    });
+                }
+                http2->run();
+                const bool lost = !http2->is_open();
+                if (lost) http2_connections.erase(connection_pool::make_key(this->message.url.get_scheme(), this->message.url.get_host(), this->message.url.get_port()));
+                if (failure == nullptr) return;
+                // an idle connection the server closed just before it was reused fails the streams, which go out again
+                // on a new connection, those answered already hold their responses
+                if (reused && lost) return pipeline(failed);
+                std::rethrow_exception(failure);
+            }
+            // the server picked HTTP/1.1 on the new connection, which the pipeline starts on
+            connected = true;
+        }
+
+        size_t depth = std::max<size_t>(options.pipeline_depth, 1);
+        size_t answered = 0;
+        while (answered < batch.size())
+        {
+            if (!connected) open_connection(reused);
+            connected = false;
+            parser.reset();
+            const size_t first = answered;
+            size_t sent = answered;
+            try
+            {
+                bool keep_alive = true;
+                while (keep_alive && answered < batch.size())
+                {
+                    // a sliding window, the next request is sent as soon as a response makes room for it
+                    for (; sent < batch.size() && sent - answered < depth; sent++)
+                    {
+                        requests[sent].rewind();
+                        tcp.send(requests[sent].data(), requests[sent].count());
+                    }
+                    http_message &request = *batch[answered];
+                    http_message &response = received;
+                    response.reset(request.url, request.method);
+                    std::optional<decoding_sink> decoder;
+                    if (options.decode_content && request.method != http_method::HEAD) decoder.emplace(nullptr, &response.body);
+                    keep_alive = read_response(tcp, response, request.method == http_method::HEAD, decoder.has_value() ? &*decoder : nullptr, true);
+                    if (decoder.has_value())
+                    {
+                        decoder->finish();
+                        decoder->apply(response);
+                    }
+                    take_response(request, response);
+                    answered++;
+                }
+                // responses the server sent past the last request mean it can't be trusted anymore
+                release_connection(keep_alive && parser.leftover() == 0);
+            } catch (...)
+            {
+                release_connection(false);
+                // the requests left unanswered are sent again on a new connection, as long as this one made progress or
+                // was an idle one the server may have closed just before it was reused. A server that answered none of a
+                // pipeline on a new connection may not handle pipelining, so it gets one request at a time instead.
+                if (answered > first || reused) continue;
+                if (depth > 1)
+                {
+                    depth = 1;
+                    continue;
+                }
+                throw;
+            }
+        }
+    }
+
+    http_message http_client::probe(const http_message &message)
+    {
+        http_message head = message;
+        head.method = http_method::HEAD;
+        make_request(head);
+        return head;
+    }
+
+    void http_client::validate(http_message &message)
     {
         if (message.url.get_host().empty()) throw std::runtime_error("Host is empty");
+        if (const std::string_view scheme = message.url.get_scheme(); scheme != "http" && scheme != "https")
+        {
+            throw std::runtime_error("Unsupported scheme: " + std::string(scheme));
+        }
+    }
+
+    bool http_client::preflight_check()
+    {
         try
         {
-            const std::string msg = "HEAD " + message.url.get_path() + " HTTP/1.1\r\n"
-                                    "Host:" + message.url.get_host() + "\r\n\r\n";
-            std::string response;
-            if (message.url.get_port() == 443)
-            {
-                tcp.write_ssl(msg);
-                response = tcp.read_ssl(4096);
-            } else
+            const std::string msg = "HEAD " + std::string(message.url.get_path()) + " HTTP/1.1\r\n"
+                                    "Host:" + std::string(message.url.get_authority()) + "\r\n\r\n";
+            tcp.send(msg);
+            last_probe = http_message(message.url, http_method::HEAD);
+            if (!read_response(tcp, last_probe, true))
             {
-                tcp.send(msg);
-                response = tcp.receive(4096); // Setting the buffer size to 4KB, this should be overkill for an OPTIONS request, but it's a good size for a buffer.
+                // the server won't accept another request on this connection, so the real request needs a new one
+                bool reused;
+                release_connection(false);
+                open_connection(reused);
             }
-            parse_headers(response);
             return true;
         } catch (std::exception &e)
         {
@@ -61,51 +457,110 @@ namespace cnet
         }
     }
 
-    void http_client::parse_headers(std::string body)
+    void http_client::open_connection(bool &reused, const bool offer_http2)
     {
-        const std::string delimiter = "\r\n";
-        size_t pos = 0;
-        while ((pos = body.find(delimiter)) != std::string::npos)
+        const std::string host(message.url.get_host());
+        const unsigned int port = message.url.get_port();
+        if (options.pool != nullptr)
+        {
+            tcp = options.pool->acquire(std::string(message.url.get_scheme()), host, port, is_secure(message.url), options.timeout, reused);
+            return;
+        }
+        reused = false;
+        tcp = tcp_client::connect(host, port, options.timeout, options.host_resolver);
+        if (is_secure(message.url))
         {
-            std::string token = body.substr(0, pos);
-            body.erase(0, pos + 2);
-            if (token.empty()) continue;
-            if (token.find("HTTP") != std::string::npos)
+            try
             {
-                message.status_code = std::stoi(token.substr(token.find(' ') + 1, 3));
-            } else
+                if (offer_http2)
+                {
+                    tls_options tls;
+                    tls.alpn = {"h2", "http/1.1"};
+                    tcp.create_ssl_handshake(tls_context::get(tls));
+                } else tcp.create_ssl_handshake();
+            } catch (...)
             {
-                const size_t colon_pos = token.find(':');
-                const std::string key = token.substr(0, colon_pos);
-                const std::string value = token.substr(colon_pos + 1);
-                message.headers[key] = value;
+                tcp.close();
+                throw;
+            }
+        }
+    }
 
-                if (key == "Content-Length")
-                {
-                    message.content_length = std::stoi(value);
-                }
-                if (key == "Content-Type")
-                {
-                    message.content_type = value;
-                }
+    std::shared_ptr<http2_connection> http_client::open_http2(bool &reused)
+    {
+        const std::string key = connection_pool::make_key(message.url.get_scheme(), message.url.get_host(), message.url.get_port());
+        if (const auto it = http2_connections.find(key); it != http2_connections.end())
+        {
+            if (it->second->is_open())
+            {
+                reused = true;
+                return it->second;
             }
+            http2_connections.erase(it);
         }
-        message.body = body;
+        open_connection(reused, true);
+        if (tcp.get_alpn_protocol() != "h2") return nullptr;
+        http2_options http2;
+        http2.timeout = options.timeout;
+        // like a tcp_client the connection isn't closed on destruction, so it is closed once the client lets go of it
+        std::shared_ptr<http2_connection> connection(new http2_connection(std::move(tcp), http2), [](http2_connection *closing)
+        {
+            closing->close();
+            delete closing;
+        });
+        tcp = tcp_client();
+        http2_connections[key] = connection;
+        return connection;
     }
 
-    std::string http_client::build_http_query(http_message &message)
+    void http_client::release_connection(const bool reusable)
     {
-        std::string query = http_method_to_str(message.method) + " " + message.url.get_path() + message.url.get_parameter_query() + " HTTP/1.1\n\r"
-                            "Host: " + message.url.get_host() + "\r\n";
+        if (options.pool != nullptr)
+        {
+            options.pool->release(std::string(message.url.get_scheme()), std::string(message.url.get_host()), message.url.get_port(), tcp, reusable);
+            tcp = tcp_client();
+            return;
+        }
+        tcp.close();
+    }
 
-        if (!message.headers.empty())
+    bool http_client::read_response(tcp_client &connection, http_message &response, const bool head, body_sink *sink, const bool pipelined)
+    {
+        parser.reset(pipelined, head);
+        response.body.clear();
+        unsigned long long body_size = 0;
+        bool started = false;
+        // a pipelined response may already be complete in what was received with the previous one
+        while (true)
         {
-            for (auto &[key, value]: message.headers)
+            if (parser.headers_complete())
             {
-                query += key + ": " + value + "\r\n";
+                if (!started)
+                {
+                    started = true;
+                    parser.copy_headers(response);
+                    if (sink != nullptr) sink->start(response);
+                }
+
+                // the parser's buffer is compacted on the next receive, so the memory used stays bounded while streaming
+                for (std::string_view chunk; parser.next_body(chunk);)
+                {
+                    body_size += chunk.size();
+                    if (sink != nullptr) sink->write(chunk);
+                    else response.body.append(chunk);
+                }
             }
+            if (parser.is_complete()) break;
+
+            char *space = parser.prepare(receive_minimum);
+            const size_t received = connection.receive(space, parser.available());
+            if (received == 0) parser.finish();
+            else parser.commit(received);
         }
+        if (parser.find_header("Content-Length") == std::nullopt) response.content_length = body_size;
 
-        return query;
+        // anything left over means the server sent more than one response, the connection can't be trusted anymore, unless
+        // more were asked for
+        return parser.keep_alive() && (pipelined || parser.leftover() == 0);
     }
 } // cnet
@@ -0,0 +1,182 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "http_headers.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace cnet
+{
+    static constexpr std::pair<std::string_view, known_header> known_names[] = {
+        {"accept-encoding", known_header::accept_encoding},
+        {"accept-ranges", known_header::accept_ranges},
+        {"age", known_header::age},
+        {"authorization", known_header::authorization},
+        {"cache-control", known_header::cache_control},
+        {"connection", known_header::connection},
+        {"content-encoding", known_header::content_encoding},
+        {"content-length", known_header::content_length},
+        {"content-range", known_header::content_range},
+        {"content-type", known_header::content_type},
+        {"date", known_header::date},
+        {"etag", known_header::etag},
+        {"expires", known_header::expires},
+        {"host", known_header::host},
+        {"if-modified-since", known_header::if_modified_since},
+        {"if-none-match", known_header::if_none_match},
+        {"if-range", known_header::if_range},
+        {"last-modified", known_header::last_modified},
+        {"location", known_header::location},
+        {"pragma", known_header::pragma},
+        {"priority", known_header::priority},
+        {"range", known_header::range},
+        {"transfer-encoding", known_header::transfer_encoding},
+        {"vary", known_header::vary},
+    };
+
+    http_headers::http_headers(const http_headers &other)
+    {
+        *this = other;
+    }
+
+    http_headers::http_headers(http_headers &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    http_headers &http_headers::operator=(const http_headers &other)
+    {
+        if (this == &other) return *this;
+        // the headers are copied into this container's own blocks, which are kept
+        clear();
+        entries.reserve(other.entries.size());
+        for (const auto &[name, value]: other.entries)
+        {
+            entries.push_back({store(name), store(value)});
+        }
+        known = other.known;
+        return *this;
+    }
+
+    http_headers &http_headers::operator=(http_headers &&other) noexcept
+    {
+        if (this == &other) return *this;
+        // the blocks move with their addresses, so the views stay valid
+        blocks = std::move(other.blocks);
+        current = other.current;
+        entries = std::move(other.entries);
+        known = other.known;
+        other.blocks.clear();
+        other.current = 0;
+        other.entries.clear();
+        other.known.fill(0);
+        return *this;
+    }
+
+    known_header http_headers::classify(const std::string_view name)
+    {
+        for (const auto &[known_name, kind]: known_names)
+        {
+            if (known_name.size() == name.size() && equals_ignore_case(known_name, name)) return kind;
+        }
+        return known_header::other;
+    }
+
+    bool http_headers::equals_ignore_case(const std::string_view a, const std::string_view b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const unsigned char x, const unsigned char y) { return tolower(x) == tolower(y); });
+    }
+
+    std::string_view http_headers::store(const std::string_view text)
+    {
+        if (text.empty()) return {};
+        // blocks that are full are skipped rather than searched, the memory of a message is only reclaimed by clear()
+        while (current < blocks.size() && blocks[current].size - blocks[current].used < text.size()) current++;
+        if (current == blocks.size())
+        {
+            const size_t size = std::max(text.size(), blocks.empty() ? CNET_HEADER_BLOCK_SIZE : blocks.back().size * 2);
+            blocks.push_back({std::make_unique<char[]>(size), size, 0});
+        }
+        block &target = blocks[current];
+        char *data = target.data.get() + target.used;
+        memcpy(data, text.data(), text.size());
+        target.used += text.size();
+        return {data, text.size()};
+    }
+
+    void http_headers::index()
+    {
+        known.fill(0);
+        for (size_t i = entries.size(); i-- > 0;)
+        {
+            if (const known_header kind = classify(entries[i].name); kind != known_header::other) known[static_cast<size_t>(kind)] = static_cast<uint32_t>(i + 1);
+        }
+    }
+
+    void http_headers::add(const std::string_view name, const std::string_view value)
+    {
+        entries.push_back({store(name), store(value)});
+        if (const known_header kind = classify(name); kind != known_header::other && known[static_cast<size_t>(kind)] == 0)
+        {
+            known[static_cast<size_t>(kind)] = static_cast<uint32_t>(entries.size());
+        }
+    }
+
+    void http_headers::set(const std::string_view name, const std::string_view value)
+    {
+        const auto first = std::find_if(entries.begin(), entries.end(), [name](const http_header &header) { return equals_ignore_case(header.name, name); });
+        if (first == entries.end())
+        {
+            add(name, value);
+            return;
+        }
+        first->value = store(value);
+        const auto duplicates = std::remove_if(first + 1, entries.end(), [name](const http_header &header) { return equals_ignore_case(header.name, name); });
+        if (duplicates != entries.end())
+        {
+            entries.erase(duplicates, entries.end());
+            index();
+        }
+    }
+
+    bool http_headers::remove(const std::string_view name)
+    {
+        const auto removed = std::remove_if(entries.begin(), entries.end(), [name](const http_header &header) { return equals_ignore_case(header.name, name); });
+        if (removed == entries.end()) return false;
+        entries.erase(removed, entries.end());
+        index();
+        return true;
+    }
+
+    std::optional<std::string_view> http_headers::get(const std::string_view name) const
+    {
+        if (const known_header kind = classify(name); kind != known_header::other) return get(kind);
+        for (const auto &[key, value]: entries)
+        {
+            if (equals_ignore_case(key, name)) return value;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::string_view> http_headers::get(const known_header kind) const
+    {
+        if (kind == known_header::other) return std::nullopt;
+        const uint32_t position = known[static_cast<size_t>(kind)];
+        if (position == 0) return std::nullopt;
+        return entries[position - 1].value;
+    }
+
+    void http_headers::clear()
+    {
+        entries.clear();
+        known.fill(0);
+        for (block &block: blocks)
+        {
+            block.used = 0;
+        }
+        current = 0;
+    }
+} // cnet
@@ -0,0 +1,101 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "http_request_serializer.h"
+
+#include "http_method.h"
+
+namespace cnet
+{
+    static constexpr const_buffer separator{": ", 2};
+    static constexpr const_buffer line_end{"\r\n", 2};
+
+    http_request_serializer::http_request_serializer(const http_message &message, const bool close_connection, const file_body *file, const std::string_view accept_encoding)
+    {
+        reset(message, close_connection, file, accept_encoding);
+    }
+
+    void http_request_serializer::reset(const http_message &message, const bool close_connection, const file_body *file, const std::string_view accept_encoding)
+    {
+        const uri &url = message.url;
+        formatted.clear();
+        formatted += http_method_to_str(message.method);
+        formatted += ' ';
+        formatted += url.get_path();
+        formatted += url.get_parameter_query();
+        formatted += " HTTP/1.1\r\nHost: ";
+        formatted += url.get_authority();
+        formatted += "\r\n";
+        if (close_connection) formatted += "Connection: close\r\n";
+        if (!accept_encoding.empty() && !message.headers.get(known_header::accept_encoding).has_value())
+        {
+            formatted += "Accept-Encoding: ";
+            formatted += accept_encoding;
+            formatted += "\r\n";
+        }
+        const size_t head_size = formatted.size();
+        const unsigned long long body_size = file != nullptr ? file->get_size() : message.body.size();
+        if ((file != nullptr || body_size > 0) && !message.headers.get(known_header::content_length).has_value())
+        {
+            formatted += "Content-Length: ";
+            formatted += std::to_string(body_size);
+            formatted += "\r\n";
+        }
+        formatted += "\r\n";
+
+        // the pointers are only taken now that formatted won't grow anymore
+        layout.clear();
+        layout.reserve(message.headers.size() * 4 + 3);
+        layout.push_back({formatted.data(), head_size});
+        for (const auto &[key, value]: message.headers)
+        {
+            layout.push_back({key.data(), key.size()});
+            layout.push_back(separator);
+            if (!value.empty()) layout.push_back({value.data(), value.size()});
+            layout.push_back(line_end);
+        }
+        layout.push_back({formatted.data() + head_size, formatted.size() - head_size});
+        if (file == nullptr && !message.body.empty()) layout.push_back({message.body.data(), message.body.size()});
+        rewind();
+    }
+
+    void http_request_serializer::rewind()
+    {
+        segments = layout;
+        first = 0;
+        remaining = 0;
+        for (const const_buffer &segment: segments)
+        {
+            remaining += segment.size;
+        }
+    }
+
+    void http_request_serializer::consume(size_t bytes)
+    {
+        remaining -= bytes;
+        while (bytes > 0 && first < segments.size())
+        {
+            const_buffer &segment = segments[first];
+            if (bytes < segment.size)
+            {
+                segment.data += bytes;
+                segment.size -= bytes;
+                return;
+            }
+            bytes -= segment.size;
+            first++;
+        }
+    }
+
+    std::string http_request_serializer::to_string() const
+    {
+        std::string request;
+        request.reserve(remaining);
+        for (size_t i = first; i < segments.size(); i++)
+        {
+            request.append(segments[i].data, segments[i].size);
+        }
+        return request;
+    }
+} // cnet
@@ -0,0 +1,367 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "http_response_parser.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include "byte_scan.h"
+
+namespace cnet
+{
+    bool http_response_parser::equals_ignore_case(const std::string_view a, const std::string_view b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) return false;
+        }
+        return true;
+    }
+
+    bool http_response_parser::has_token(std::string_view value, const std::string_view token)
+    {
+        while (!value.empty())
+        {
+            const size_t comma = value.find(',');
+            if (equals_ignore_case(trim(value.substr(0, comma)), token)) return true;
+            if (comma == std::string_view::npos) break;
+            value.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    std::string_view http_response_parser::trim(std::string_view value)
+    {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+        return value;
+    }
+
+    unsigned long long http_response_parser::parse_content_length(const std::string_view value)
+    {
+        if (value.empty()) throw std::runtime_error("Malformed HTTP Content-Length");
+        unsigned long long length = 0;
+        for (const char c: value)
+        {
+            if (!isdigit(static_cast<unsigned char>(c))) throw std::runtime_error("Malformed HTTP Content-Length");
+            const unsigned digit = c - '0';
+            if (length > (ULLONG_MAX - digit) / 10) throw std::runtime_error("Malformed HTTP Content-Length");
+            length = length * 10 + digit;
+        }
+        return length;
+    }
+
+    void http_response_parser::reset(const bool keep_leftover, const bool head_request)
+    {
+        const size_t left = keep_leftover && is_complete() ? filled - parsed : 0;
+        if (left > 0) memmove(buffer.data(), buffer.data() + parsed, left);
+        filled = left;
+        parsed = scanned = header_start = header_end = 0;
+        current = state::status_line;
+        framing = body_framing::none;
+        head = head_request;
+        status = 0;
+        minor_version = 1;
+        reason_span = {};
+        header_spans.clear();
+        remaining = 0;
+        trailer_size = 0;
+        body_spans.clear();
+        next_span = 0;
+        if (left > 0) parse();
+    }
+
+    char *http_response_parser::prepare(const size_t size)
+    {
+        if (next_span == body_spans.size())
+        {
+            body_spans.clear();
+            next_span = 0;
+
+            // the body data handed out has been consumed, so drop it and keep the header block in place
+            const size_t base = headers_complete() ? header_end : current == state::status_line ? 0 : parsed;
+            if (parsed > base)
+            {
+                const size_t delta = parsed - base;
+                scanned = std::max(scanned, parsed) - delta;
+                memmove(buffer.data() + base, buffer.data() + parsed, filled - parsed);
+                filled -= delta;
+                parsed = base;
+                if (current == state::status_line) header_start = 0;
+            }
+        }
+        if (buffer.capacity() < filled + size) grow(filled + size);
+        return buffer.data() + filled;
+    }
+
+    void http_response_parser::grow(const size_t size)
+    {
+        io_buffer next = size <= pool->get_buffer_size() ? pool->acquire() : io_buffer(std::max(size, buffer.capacity() * 2));
+        if (filled > 0) memcpy(next.data(), buffer.data(), filled);
+        buffer = std::move(next);
+    }
+
+    void http_response_parser::commit(const size_t size)
+    {
+        filled += size;
+        parse();
+    }
+
+    void http_response_parser::feed(const std::string_view data)
+    {
+        memcpy(prepare(data.size()), data.data(), data.size());
+        commit(data.size());
+    }
+
+    void http_response_parser::finish()
+    {
+        if (current == state::body_until_close)
+        {
+            current = state::complete;
+            return;
+        }
+        if (current != state::complete) throw std::runtime_error("Connection closed before the response was complete");
+    }
+
+    bool http_response_parser::next_body(std::string_view &chunk)
+    {
+        if (next_span == body_spans.size()) return false;
+        chunk = view(body_spans[next_span++]);
+        return true;
+    }
+
+    http_response_parser::header_field http_response_parser::get_header(const size_t index) const
+    {
+        return {view(header_spans[index].name), view(header_spans[index].value)};
+    }
+
+    std::optional<std::string_view> http_response_parser::find_header(const std::string_view name) const
+    {
+        for (const header_span &header: header_spans)
+        {
+            if (equals_ignore_case(view(header.name), name)) return view(header.value);
+        }
+        return std::nullopt;
+    }
+
+    bool http_response_parser::keep_alive() const
+    {
+        if (framing == body_framing::until_close) return false;
+        const std::optional<std::string_view> connection = find_header("Connection");
+        if (minor_version == 0) return connection.has_value() && has_token(*connection, "keep-alive");
+        return !connection.has_value() || !has_token(*connection, "close");
+    }
+
+    bool http_response_parser::next_line(size_t &line_end)
+    {
+        // only the bytes that arrived since the last search are scanned
+        const size_t from = std::max(scanned, parsed);
+        const size_t position = from + find_byte(buffer.data() + from, filled - from, '\n');
+        // the header block is bounded as a whole, as is the trailer section, and each chunk line on its own
+        const size_t end = position == filled ? filled : position + 1;
+        if (!headers_complete())
+        {
+            if (end - header_start > CNET_MAX_HEADER_SIZE) throw std::runtime_error("HTTP response header block is too large");
+        } else if (current == state::trailer_line)
+        {
+            if (trailer_size + end - parsed > CNET_MAX_HEADER_SIZE) throw std::runtime_error("HTTP response trailer section is too large");
+            if (position != filled) trailer_size += end - parsed;
+        } else if (end - parsed > CNET_MAX_CHUNK_LINE_SIZE)
+        {
+            throw std::runtime_error("HTTP chunk line is too long");
+        }
+        if (position == filled)
+        {
+            scanned = filled;
+            return false;
+        }
+        line_end = position > parsed && buffer.data()[position - 1] == '\r' ? position - 1 : position;
+        scanned = position + 1;
+        return true;
+    }
+
+    void http_response_parser::parse_status_line(const size_t line_end)
+    {
+        const std::string_view line(buffer.data() + parsed, line_end - parsed);
+        if (line.size() < 12 || line.compare(0, 7, "HTTP/1.") != 0 || !isdigit(static_cast<unsigned char>(line[7])) || line[8] != ' ' ||
+            !isdigit(static_cast<unsigned char>(line[9])) || !isdigit(static_cast<unsigned char>(line[10])) || !isdigit(static_cast<unsigned char>(line[11])))
+        {
+            throw std::runtime_error("Malformed HTTP status line");
+        }
+        minor_version = line[7] - '0';
+        status = (line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0');
+        const size_t reason = std::min(line.size(), static_cast<size_t>(13));
+        reason_span = {parsed + reason, line.size() - reason};
+    }
+
+    void http_response_parser::parse_header_line(const size_t line_end)
+    {
+        const std::string_view line(buffer.data() + parsed, line_end - parsed);
+        if ((line.front() == ' ' || line.front() == '\t') && !header_spans.empty())
+        {
+            // obsolete line folding, RFC 9112 section 5.2, the fold is replaced by a single space and the continuation
+            // moved down to follow the value of the previous field, so the value holds no line break
+            const std::string_view continuation = trim(line);
+            if (continuation.empty()) return;
+            span &value = header_spans.back().value;
+            if (value.length > 0) buffer.data()[value.offset + value.length++] = ' ';
+            std::memmove(buffer.data() + value.offset + value.length, continuation.data(), continuation.size());
+            value.length += continuation.size();
+            return;
+        }
+        const size_t colon = find_byte(line.data(), line.size(), ':');
+        if (colon == line.size() || colon == 0)
+        {
+            throw std::runtime_error("Malformed HTTP header field");
+        }
+        const std::string_view value = trim(line.substr(colon + 1));
+        const size_t value_offset = value.empty() ? line_end : value.data() - buffer.data();
+        header_spans.push_back({{parsed, colon}, {value_offset, value.size()}});
+    }
+
+    void http_response_parser::finish_headers()
+    {
+        header_end = parsed;
+        if (status >= 100 && status < 200 && status != 101)
+        {
+            // an interim response such as 100 Continue, the final response follows it
+            header_spans.clear();
+            header_start = parsed;
+            current = state::status_line;
+            return;
+        }
+
+        if (head || status == 204 || status == 304 || status < 200)
+        {
+            framing = body_framing::none;
+            current = state::complete;
+            return;
+        }
+        if (const std::optional<std::string_view> encoding = find_header("Transfer-Encoding"); encoding.has_value() && has_token(*encoding, "chunked"))
+        {
+            framing = body_framing::chunked;
+            current = state::chunk_size;
+            return;
+        }
+        if (const std::optional<std::string_view> length = find_header("Content-Length"); length.has_value())
+        {
+            remaining = parse_content_length(*length);
+            framing = body_framing::content_length;
+            current = remaining == 0 ? state::complete : state::body_fixed;
+            return;
+        }
+        framing = body_framing::until_close;
+        current = state::body_until_close;
+    }
+
+    void http_response_parser::take_body(const state next)
+    {
+        const size_t available = filled - parsed;
+        const size_t take = framing == body_framing::until_close ? available : static_cast<size_t>(std::min<unsigned long long>(available, remaining));
+        if (take > 0)
+        {
+            // adjacent pieces are merged so a chunk split across reads is still handed out whole
+            if (!body_spans.empty() && next_span < body_spans.size() && body_spans.back().offset + body_spans.back().length == parsed)
+                body_spans.back().length += take;
+            else
+                body_spans.push_back({parsed, take});
+            parsed += take;
+        }
+        if (framing != body_framing::until_close)
+        {
+            remaining -= take;
+            if (remaining == 0) current = next;
+        }
+    }
+
+    void http_response_parser::parse()
+    {
+        while (true)
+        {
+            size_t line_end;
+            switch (current)
+            {
+                case state::status_line:
+                    if (!next_line(line_end)) return;
+                    if (line_end > parsed)
+                    {
+                        parse_status_line(line_end);
+                        current = state::header_line;
+                    }
+                    parsed = scanned;
+                    break;
+                case state::header_line:
+                    if (!next_line(line_end)) return;
+                    if (line_end == parsed)
+                    {
+                        parsed = scanned;
+                        finish_headers();
+                    } else
+                    {
+                        parse_header_line(line_end);
+                        parsed = scanned;
+                    }
+                    break;
+                case state::body_fixed:
+                    if (parsed == filled) return;
+                    take_body(state::complete);
+                    break;
+                case state::chunk_size:
+                {
+                    if (!next_line(line_end)) return;
+                    const size_t digits = find_non_hex(buffer.data() + parsed, line_end - parsed);
+                    if (digits == 0 || digits > 15) throw std::runtime_error("Malformed HTTP chunk size");
+                    unsigned long long size = 0;
+                    for (size_t i = parsed; i < parsed + digits; i++)
+                    {
+                        const char c = static_cast<char>(buffer.data()[i] | 0x20);
+                        size = size * 16 + (c <= '9' ? c - '0' : c - 'a' + 10);
+                    }
+                    parsed = scanned;
+                    remaining = size;
+                    current = size == 0 ? state::trailer_line : state::chunk_data;
+                    break;
+                }
+                case state::chunk_data:
+                    if (parsed == filled) return;
+                    take_body(state::chunk_data_end);
+                    break;
+                case state::chunk_data_end:
+                    if (!next_line(line_end)) return;
+                    if (line_end != parsed) throw std::runtime_error("Malformed HTTP chunk");
+                    parsed = scanned;
+                    current = state::chunk_size;
+                    break;
+                case state::trailer_line:
+                    // trailer fields are skipped, the empty line ends the response
+                    if (!next_line(line_end)) return;
+                    if (line_end == parsed) current = state::complete;
+                    parsed = scanned;
+                    break;
+                case state::body_until_close:
+                    if (parsed == filled) return;
+                    take_body(state::body_until_close);
+                    break;
+                case state::complete:
+                    return;
+            }
+        }
+    }
+
+    void http_response_parser::copy_headers(http_message &response) const
+    {
+        response.status_code = status;
+        response.headers.clear();
+        for (size_t i = 0; i < header_count(); i++)
+        {
+            const auto [name, value] = get_header(i);
+            response.headers.add(name, value);
+            if (equals_ignore_case(name, "Content-Length")) response.content_length = parse_content_length(value);
+        }
+    }
+} // cnet
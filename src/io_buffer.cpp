@@ -0,0 +1,130 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "io_buffer.h"
+
+#include <new>
+#include <utility>
+
+namespace cnet
+{
+    io_buffer::block *io_buffer::allocate(const size_t capacity, buffer_pool *pool)
+    {
+        void *memory = ::operator new(sizeof(block) + capacity);
+        return new(memory) block{{1}, capacity, pool};
+    }
+
+    io_buffer::io_buffer(const size_t capacity): current(allocate(capacity, nullptr)) {}
+
+    io_buffer::io_buffer(const io_buffer &other): current(other.current), used(other.used)
+    {
+        if (current != nullptr) current->references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    io_buffer::io_buffer(io_buffer &&other) noexcept: current(std::exchange(other.current, nullptr)), used(std::exchange(other.used, 0)) {}
+
+    io_buffer &io_buffer::operator=(const io_buffer &other)
+    {
+        if (this != &other)
+        {
+            if (other.current != nullptr) other.current->references.fetch_add(1, std::memory_order_relaxed);
+            release();
+            current = other.current;
+            used = other.used;
+        }
+        return *this;
+    }
+
+    io_buffer &io_buffer::operator=(io_buffer &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            current = std::exchange(other.current, nullptr);
+            used = std::exchange(other.used, 0);
+        }
+        return *this;
+    }
+
+    io_buffer::~io_buffer()
+    {
+        release();
+    }
+
+    void io_buffer::release()
+    {
+        block *b = std::exchange(current, nullptr);
+        used = 0;
+        if (b == nullptr || b->references.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        if (b->pool != nullptr) b->pool->recycle(b);
+        else
+        {
+            b->~block();
+            ::operator delete(b);
+        }
+    }
+
+    buffer_pool::buffer_pool(const size_t buffer_size, const size_t limit): buffer_size(buffer_size), limit(limit) {}
+
+    buffer_pool::~buffer_pool()
+    {
+        trim();
+    }
+
+    io_buffer buffer_pool::acquire()
+    {
+        {
+            std::lock_guard lock(mutex);
+            if (!idle.empty())
+            {
+                io_buffer::block *b = idle.back();
+                idle.pop_back();
+                b->references.store(1, std::memory_order_relaxed);
+                return io_buffer(b);
+            }
+        }
+        return io_buffer(io_buffer::allocate(buffer_size, this));
+    }
+
+    void buffer_pool::recycle(io_buffer::block *b)
+    {
+        {
+            std::lock_guard lock(mutex);
+            if (idle.size() < limit)
+            {
+                idle.push_back(b);
+                return;
+            }
+        }
+        b->~block();
+        ::operator delete(b);
+    }
+
+    size_t buffer_pool::get_idle_count() const
+    {
+        std::lock_guard lock(mutex);
+        return idle.size();
+    }
+
+    void buffer_pool::trim()
+    {
+        std::vector<io_buffer::block *> freed;
+        {
+            std::lock_guard lock(mutex);
+            freed.swap(idle);
+        }
+        for (io_buffer::block *b: freed)
+        {
+            b->~block();
+            ::operator delete(b);
+        }
+    }
+
+    buffer_pool &buffer_pool::get_default()
+    {
+        // never destroyed, so buffers released during static destruction still have somewhere to go
+        static auto *pool = new buffer_pool();
+        return *pool;
+    }
+} // cnet
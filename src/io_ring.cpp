@@ -0,0 +1,215 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "io_ring.h"
+
+#ifdef CNET_IO_URING
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace cnet
+{
+    static int io_uring_setup(const unsigned entries, io_uring_params *params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    static int io_uring_enter(const int fd, const unsigned submit, const unsigned wait_for, const unsigned flags, const void *argument, const size_t size)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, wait_for, flags, argument, size));
+    }
+
+    static int io_uring_register(const int fd, const unsigned opcode, const void *argument, const unsigned count)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, argument, count));
+    }
+
+    // the queue indices are shared with the kernel, so they are read with acquire and published with release ordering
+    static unsigned load_acquire(const unsigned *value)
+    {
+        return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+    }
+
+    static void store_release(unsigned *value, const unsigned new_value)
+    {
+        __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+    }
+
+    io_ring::io_ring(const unsigned entries)
+    {
+        // completions are only ever reaped by the loop's own io_uring_enter calls, so the kernel needn't interrupt the
+        // thread to run their task work, and a bad entry shouldn't stop the rest of its batch (Linux 5.19+)
+        io_uring_params params{};
+        params.flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SUBMIT_ALL;
+        ring_fd = io_uring_setup(entries, &params);
+        if (ring_fd < 0 && errno == EINVAL)
+        {
+            params = {};
+            ring_fd = io_uring_setup(entries, &params);
+        }
+        if (ring_fd < 0) throw std::runtime_error("Error at io_uring_setup(): " + std::string(strerror(errno)));
+        features = params.features;
+        if ((features & IORING_FEAT_EXT_ARG) == 0)
+        {
+            ::close(ring_fd);
+            throw std::runtime_error("io_uring is too old, IORING_FEAT_EXT_ARG is required");
+        }
+
+        sq_memory_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_memory_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) sq_memory_size = cq_memory_size = std::max(sq_memory_size, cq_memory_size);
+
+        sq_memory = mmap(nullptr, sq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        if (sq_memory == MAP_FAILED)
+        {
+            ::close(ring_fd);
+            throw std::runtime_error("Failed to map the io_uring submission queue");
+        }
+        cq_memory = single_mmap ? sq_memory : mmap(nullptr, cq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqe_memory = cq_memory == MAP_FAILED ? MAP_FAILED : mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+        if (cq_memory == MAP_FAILED || sqe_memory == MAP_FAILED)
+        {
+            if (!single_mmap && cq_memory != MAP_FAILED) munmap(cq_memory, cq_memory_size);
+            munmap(sq_memory, sq_memory_size);
+            ::close(ring_fd);
+            throw std::runtime_error("Failed to map the io_uring queues");
+        }
+        sqes = static_cast<io_uring_sqe *>(sqe_memory);
+
+        auto *sq = static_cast<char *>(sq_memory);
+        sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_entries = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+        sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        sq_local_tail = *sq_tail;
+
+        auto *cq = static_cast<char *>(cq_memory);
+        cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    }
+
+    io_ring::~io_ring()
+    {
+        if (buffer_ring != nullptr) munmap(buffer_ring, buffer_memory_size);
+        munmap(sqes, sqes_size);
+        if (cq_memory != sq_memory) munmap(cq_memory, cq_memory_size);
+        munmap(sq_memory, sq_memory_size);
+        ::close(ring_fd);
+    }
+
+    io_uring_sqe *io_ring::get_sqe()
+    {
+        if (sq_local_tail - load_acquire(sq_head) >= sq_entries)
+        {
+            submit();
+            if (sq_local_tail - load_acquire(sq_head) >= sq_entries) throw std::runtime_error("The io_uring submission queue is full");
+        }
+        const unsigned index = sq_local_tail & sq_mask;
+        io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(io_uring_sqe));
+        sq_array[index] = index;
+        sq_local_tail++;
+        return sqe;
+    }
+
+    int io_ring::submit(const unsigned wait_for, const __kernel_timespec *timeout)
+    {
+        const unsigned pending = sq_local_tail - *sq_tail;
+        store_release(sq_tail, sq_local_tail);
+        if (pending == 0 && wait_for == 0) return 0;
+
+        io_uring_getevents_arg argument{};
+        argument.sigmask_sz = _NSIG / 8;
+        argument.ts = reinterpret_cast<__u64>(timeout);
+        const unsigned flags = IORING_ENTER_EXT_ARG | (wait_for > 0 ? IORING_ENTER_GETEVENTS : 0);
+        enters++;
+        const int result = io_uring_enter(ring_fd, pending, wait_for, flags, &argument, sizeof(argument));
+        return result < 0 ? -errno : result;
+    }
+
+    io_uring_cqe *io_ring::peek()
+    {
+        const unsigned head = *cq_head;
+        if (head == load_acquire(cq_tail)) return nullptr;
+        return &cqes[head & cq_mask];
+    }
+
+    void io_ring::advance()
+    {
+        store_release(cq_head, *cq_head + 1);
+    }
+
+    bool io_ring::register_files(const unsigned count)
+    {
+        io_uring_rsrc_register files{};
+        files.nr = count;
+        files.flags = IORING_RSRC_REGISTER_SPARSE;
+        return io_uring_register(ring_fd, IORING_REGISTER_FILES2, &files, sizeof(files)) == 0;
+    }
+
+    bool io_ring::register_buffers(const unsigned count, const unsigned size, const unsigned short group)
+    {
+        // the ring of buffer descriptors and the buffers themselves share one mapping
+        const size_t ring_size = count * sizeof(io_uring_buf);
+        buffer_memory_size = ring_size + static_cast<size_t>(count) * size;
+        void *memory = mmap(nullptr, buffer_memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) return false;
+
+        io_uring_buf_reg registration{};
+        registration.ring_addr = reinterpret_cast<__u64>(memory);
+        registration.ring_entries = count;
+        registration.bgid = group;
+        if (io_uring_register(ring_fd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0)
+        {
+            munmap(memory, buffer_memory_size);
+            return false;
+        }
+
+        buffer_ring = static_cast<io_uring_buf_ring *>(memory);
+        buffers = static_cast<char *>(memory) + ring_size;
+        buffer_count = count;
+        buffer_size = size;
+        buffer_group = group;
+        for (unsigned id = 0; id < count; id++)
+        {
+            io_uring_buf &buffer = get_entry(id);
+            buffer.addr = reinterpret_cast<__u64>(buffers + static_cast<size_t>(id) * size);
+            buffer.len = size;
+            buffer.bid = static_cast<__u16>(id);
+        }
+        __atomic_store_n(&buffer_ring->tail, static_cast<__u16>(count), __ATOMIC_RELEASE);
+        return true;
+    }
+
+    io_uring_buf &io_ring::get_entry(const unsigned index) const
+    {
+        // not buffer_ring->bufs, in C++ the empty struct the kernel header pads that flexible array with takes a byte
+        // and shifts it by 8
+        return reinterpret_cast<io_uring_buf *>(buffer_ring)[index];
+    }
+
+    void io_ring::recycle_buffer(const unsigned id)
+    {
+        const unsigned short tail = buffer_ring->tail;
+        io_uring_buf &buffer = get_entry(tail & (buffer_count - 1));
+        buffer.addr = reinterpret_cast<__u64>(buffers + static_cast<size_t>(id) * buffer_size);
+        buffer.len = buffer_size;
+        buffer.bid = static_cast<__u16>(id);
+        __atomic_store_n(&buffer_ring->tail, static_cast<__u16>(tail + 1), __ATOMIC_RELEASE);
+    }
+} // cnet
+#endif
@@ -0,0 +1,105 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "request_coalescer.h"
+
+#include <utility>
+
+namespace cnet
+{
+    bool request_coalescer::can_coalesce(const http_message &request)
+    {
+        return (request.method == http_method::GET || request.method == http_method::HEAD) && request.body.empty();
+    }
+
+    std::string request_coalescer::make_key(const http_message &request, const std::string_view context)
+    {
+        const uri &url = request.url;
+        // the scheme and host are lowercased when the url is parsed, and the port is spelled out so the default one
+        // matches whether it was written or not
+        std::string key = http_method_to_str(request.method);
+        key += ' ';
+        key += url.get_scheme();
+        key += "://";
+        if (const std::string_view userinfo = url.get_userinfo(); !userinfo.empty())
+        {
+            key += userinfo;
+            key += '@';
+        }
+        key += url.get_host();
+        key += ':';
+        key += std::to_string(url.get_port());
+        key += url.get_path();
+        key += url.get_parameter_query();
+        for (const auto &[name, value]: request.headers)
+        {
+            key += '\n';
+            key += name;
+            key += ": ";
+            key += value;
+        }
+        key += '\n';
+        key += context;
+        return key;
+    }
+
+    std::shared_ptr<const http_message> request_coalescer::run(const std::string &key, const std::function<const http_message &()> &send)
+    {
+        std::unique_lock lock(mutex);
+        if (const auto it = flights.find(key); it != flights.end())
+        {
+            const std::shared_ptr<flight> current = it->second;
+            current->followers++;
+            ++joined;
+            current->landed.wait(lock, [&current] { return current->done; });
+            if (current->error != nullptr) std::rethrow_exception(current->error);
+            return current->response;
+        }
+        const auto current = std::make_shared<flight>();
+        flights.emplace(key, current);
+        ++sent;
+        lock.unlock();
+
+        // the flight is taken off the table before it lands, so nobody joins it once its followers are counted
+        const auto land = [this, &current](std::shared_ptr<const http_message> response, std::exception_ptr error)
+        {
+            {
+                std::lock_guard guard(mutex);
+                current->response = std::move(response);
+                current->error = std::move(error);
+                current->done = true;
+            }
+            current->landed.notify_all();
+        };
+        try
+        {
+            const http_message &response = send();
+            size_t followers;
+            {
+                std::lock_guard guard(mutex);
+                flights.erase(key);
+                followers = current->followers;
+            }
+            // only copied when someone is waiting for it
+            land(followers > 0 ? std::make_shared<const http_message>(response) : nullptr, nullptr);
+        } catch (...)
+        {
+            {
+                std::lock_guard guard(mutex);
+                flights.erase(key);
+            }
+            land(nullptr, std::current_exception());
+            throw;
+        }
+        return nullptr;
+    }
+
+    request_coalescer_stats request_coalescer::get_stats() const
+    {
+        request_coalescer_stats stats;
+        stats.sent = sent.load();
+        stats.joined = joined.load();
+        return stats;
+    }
+} // cnet
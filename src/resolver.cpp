@@ -0,0 +1,315 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "resolver.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef __WIN32
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#endif
+
+namespace cnet
+{
+    static std::string to_lower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](const unsigned char c) { return static_cast<char>(tolower(c)); });
+        return text;
+    }
+
+    void endpoint::set_port(const unsigned int port)
+    {
+        if (address.ss_family == AF_INET6) reinterpret_cast<sockaddr_in6 *>(&address)->sin6_port = htons(static_cast<uint16_t>(port));
+        else reinterpret_cast<sockaddr_in *>(&address)->sin_port = htons(static_cast<uint16_t>(port));
+    }
+
+    std::string endpoint::to_string() const
+    {
+        char text[INET6_ADDRSTRLEN] = {};
+        if (address.ss_family == AF_INET6) inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6 *>(&address)->sin6_addr, text, sizeof(text));
+        else inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in *>(&address)->sin_addr, text, sizeof(text));
+        return text;
+    }
+
+    bool endpoint::parse(const std::string &text, endpoint &result)
+    {
+        // an IPv6 address in a url is enclosed in brackets
+        const std::string host = text.size() > 2 && text.front() == '[' && text.back() == ']' ? text.substr(1, text.size() - 2) : text;
+        endpoint parsed;
+        auto *ipv4 = reinterpret_cast<sockaddr_in *>(&parsed.address);
+        auto *ipv6 = reinterpret_cast<sockaddr_in6 *>(&parsed.address);
+        if (inet_pton(AF_INET, host.c_str(), &ipv4->sin_addr) == 1)
+        {
+            ipv4->sin_family = AF_INET;
+            parsed.length = sizeof(sockaddr_in);
+        } else if (inet_pton(AF_INET6, host.c_str(), &ipv6->sin6_addr) == 1)
+        {
+            ipv6->sin6_family = AF_INET6;
+            parsed.length = sizeof(sockaddr_in6);
+        } else return false;
+        result = parsed;
+        return true;
+    }
+
+    std::vector<endpoint> order_for_connect(const std::vector<endpoint> &addresses)
+    {
+        if (addresses.empty()) return {};
+        const int preferred = addresses.front().get_family();
+        std::vector<endpoint> first, second;
+        for (const endpoint &address: addresses)
+        {
+            (address.get_family() == preferred ? first : second).push_back(address);
+        }
+        std::vector<endpoint> ordered;
+        ordered.reserve(addresses.size());
+        for (size_t i = 0; i < first.size() || i < second.size(); i++)
+        {
+            if (i < first.size()) ordered.push_back(first[i]);
+            if (i < second.size()) ordered.push_back(second[i]);
+        }
+        return ordered;
+    }
+
+    void resolver::resolve_async(const std::string &host, const resolve_handler handler)
+    {
+        resolution result;
+        try
+        {
+            result = resolve(host);
+        } catch (...)
+        {
+            handler({}, std::current_exception());
+            return;
+        }
+        handler(std::move(result), nullptr);
+    }
+
+    std::shared_ptr<resolver> resolver::get_default()
+    {
+        static const std::shared_ptr<resolver> instance = std::make_shared<caching_resolver>(std::make_shared<system_resolver>());
+        return instance;
+    }
+
+    system_resolver::system_resolver(const unsigned int ttl, const size_t threads): ttl(ttl), thread_count(std::max<size_t>(threads, 1))
+    {
+    }
+
+    system_resolver::~system_resolver()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (std::thread &worker: workers)
+        {
+            worker.join();
+        }
+    }
+
+    resolution system_resolver::resolve(const std::string &host)
+    {
+        // a numeric address needs no lookup
+        if (endpoint literal; endpoint::parse(host, literal)) return {{literal}, ttl};
+
+        addrinfo hints{}, *result = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        if (const int error = getaddrinfo(host.c_str(), nullptr, &hints, &result); error != 0)
+        {
+            throw std::runtime_error("getaddrinfo failed for " + host + ": " + std::string(gai_strerror(error)));
+        }
+        resolution answer;
+        answer.ttl = ttl;
+        for (const addrinfo *info = result; info != nullptr; info = info->ai_next)
+        {
+            endpoint address;
+            memcpy(&address.address, info->ai_addr, std::min<size_t>(info->ai_addrlen, sizeof(sockaddr_storage)));
+            address.length = static_cast<socklen_t>(info->ai_addrlen);
+            answer.addresses.push_back(address);
+        }
+        freeaddrinfo(result);
+        if (answer.addresses.empty()) throw std::runtime_error("getaddrinfo returned no address for " + host);
+        return answer;
+    }
+
+    void system_resolver::resolve_async(const std::string &host, resolve_handler handler)
+    {
+        {
+            std::lock_guard lock(mutex);
+            queue.emplace_back(host, std::move(handler));
+            // the threads are only started once they are needed, most resolvers never run a lookup in the background
+            if (workers.empty())
+            {
+                for (size_t i = 0; i < thread_count; i++)
+                {
+                    workers.emplace_back(&system_resolver::work, this);
+                }
+            }
+        }
+        ready.notify_one();
+    }
+
+    void system_resolver::work()
+    {
+        while (true)
+        {
+            std::unique_lock lock(mutex);
+            ready.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            auto [host, handler] = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            resolver::resolve_async(host, handler);
+        }
+    }
+
+    void hosts_resolver::add(const std::string &host, const std::string &address)
+    {
+        endpoint parsed;
+        if (!endpoint::parse(address, parsed)) throw std::runtime_error("Not a numeric address: " + address);
+        std::lock_guard lock(mutex);
+        table[to_lower(host)].push_back(parsed);
+    }
+
+    void hosts_resolver::load(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file.is_open()) throw std::runtime_error("Failed to open " + path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (const size_t comment = line.find('#'); comment != std::string::npos) line.erase(comment);
+            std::istringstream fields(line);
+            std::string address, host;
+            if (!(fields >> address)) continue;
+            endpoint parsed;
+            if (!endpoint::parse(address, parsed)) continue;
+            std::lock_guard lock(mutex);
+            while (fields >> host)
+            {
+                table[to_lower(host)].push_back(parsed);
+            }
+        }
+    }
+
+    resolution hosts_resolver::resolve(const std::string &host)
+    {
+        if (endpoint literal; endpoint::parse(host, literal)) return {{literal}, ttl};
+        std::lock_guard lock(mutex);
+        const auto it = table.find(to_lower(host));
+        if (it == table.end()) throw std::runtime_error("Unknown host: " + host);
+        return {it->second, ttl};
+    }
+
+    caching_resolver::caching_resolver(std::shared_ptr<resolver> upstream, const resolver_cache_options options): upstream(std::move(upstream)), options(options)
+    {
+    }
+
+    bool caching_resolver::find(const std::string &host, resolution &result, std::string &error)
+    {
+        std::lock_guard lock(mutex);
+        const auto it = entries.find(host);
+        if (it == entries.end()) return false;
+        if (it->second.expires <= std::chrono::steady_clock::now())
+        {
+            entries.erase(it);
+            return false;
+        }
+        result = it->second.result;
+        error = it->second.error;
+        return true;
+    }
+
+    void caching_resolver::store(const std::string &host, const resolution &result, const std::string &error)
+    {
+        const unsigned int ttl = error.empty() ? std::min(result.ttl, options.max_ttl) : options.negative_ttl;
+        if (ttl == 0 || options.max_entries == 0) return;
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard lock(mutex);
+        if (entries.size() >= options.max_entries && entries.find(host) == entries.end())
+        {
+            for (auto it = entries.begin(); it != entries.end();)
+            {
+                if (it->second.expires <= now) it = entries.erase(it);
+                else ++it;
+            }
+            if (entries.size() >= options.max_entries) entries.erase(entries.begin());
+        }
+        entries[host] = {result, error, now + std::chrono::seconds(ttl)};
+    }
+
+    resolution caching_resolver::resolve(const std::string &host)
+    {
+        const std::string key = to_lower(host);
+        resolution result;
+        if (std::string error; find(key, result, error))
+        {
+            ++hits;
+            if (!error.empty()) throw std::runtime_error(error);
+            return result;
+        }
+        ++misses;
+        try
+        {
+            result = upstream->resolve(host);
+        } catch (std::exception &e)
+        {
+            store(key, {}, e.what());
+            throw;
+        }
+        store(key, result, {});
+        return result;
+    }
+
+    void caching_resolver::resolve_async(const std::string &host, resolve_handler handler)
+    {
+        const std::string key = to_lower(host);
+        resolution result;
+        if (std::string error; find(key, result, error))
+        {
+            ++hits;
+            if (!error.empty()) handler({}, std::make_exception_ptr(std::runtime_error(error)));
+            else handler(std::move(result), nullptr);
+            return;
+        }
+        ++misses;
+        upstream->resolve_async(host, [this, key, handler = std::move(handler)](resolution answer, std::exception_ptr failure)
+        {
+            if (failure == nullptr) store(key, answer, {});
+            else
+            {
+                try
+                {
+                    std::rethrow_exception(failure);
+                } catch (std::exception &e)
+                {
+                    store(key, {}, e.what());
+                } catch (...)
+                {
+                }
+            }
+            handler(std::move(answer), std::move(failure));
+        });
+    }
+
+    void caching_resolver::clear()
+    {
+        std::lock_guard lock(mutex);
+        entries.clear();
+    }
+
+    resolver_stats caching_resolver::get_stats() const
+    {
+        return {hits.load(), misses.load()};
+    }
+} // cnet
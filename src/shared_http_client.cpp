@@ -0,0 +1,108 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "shared_http_client.h"
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace cnet
+{
+    shared_http_client::worker::~worker()
+    {
+        if (wake_fd >= 0) ::close(wake_fd);
+    }
+
+    shared_http_client::shared_http_client(const shared_http_client_options &options): group(options.workers, options.backend)
+    {
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            auto added = std::make_unique<worker>();
+            added->loop = &group.get(i);
+            added->client = std::make_unique<async_http_client>(*added->loop, options.client);
+            added->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (added->wake_fd < 0) throw std::runtime_error("Error at eventfd(): " + std::string(strerror(errno)));
+            // a loop's watches are only touched from its own thread, submissions made before this runs are drained as
+            // soon as it does since the eventfd is already readable
+            worker &target = *added;
+            target.loop->post([&target] { target.loop->watch(target.wake_fd, EPOLLIN, [&target](uint32_t) { drain(target); }); });
+            workers.push_back(std::move(added));
+        }
+    }
+
+    shared_http_client::~shared_http_client()
+    {
+        // the loops are stopped first, so nothing runs while the clients and queues go away
+        group.stop();
+        workers.clear();
+    }
+
+    void shared_http_client::make_request(http_message message, response_handler handler)
+    {
+        submit({std::move(message), nullptr, std::move(handler)});
+    }
+
+    void shared_http_client::make_request(http_message message, body_sink &sink, response_handler handler)
+    {
+        submit({std::move(message), &sink, std::move(handler)});
+    }
+
+    std::future<http_message> shared_http_client::request(http_message message)
+    {
+        auto promise = std::make_shared<std::promise<http_message>>();
+        std::future<http_message> future = promise->get_future();
+        make_request(std::move(message), [promise](http_message &response, const std::exception_ptr &error)
+        {
+            if (error != nullptr) promise->set_exception(error);
+            else promise->set_value(std::move(response));
+        });
+        return future;
+    }
+
+    size_t shared_http_client::get_in_flight() const
+    {
+        size_t total = 0;
+        for (const auto &target: workers)
+        {
+            total += target->queued.load(std::memory_order_relaxed) + target->client->get_in_flight();
+        }
+        return total;
+    }
+
+    void shared_http_client::submit(submission &&request)
+    {
+        // each thread takes the workers in turn from its own starting point, so submitting touches no counter shared
+        // by all threads
+        static thread_local size_t turn = std::hash<std::thread::id>()(std::this_thread::get_id());
+        worker &target = *workers[turn++ % workers.size()];
+        target.queued.fetch_add(1, std::memory_order_relaxed);
+        target.queue.push(std::move(request));
+        // pairs with the fence in drain(), either the worker sees the request or this thread sees the flag cleared
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (target.signaled.exchange(true)) return;
+        constexpr uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(target.wake_fd, &one, sizeof(one));
+    }
+
+    void shared_http_client::drain(worker &target)
+    {
+        uint64_t value;
+        [[maybe_unused]] const ssize_t read = ::read(target.wake_fd, &value, sizeof(value));
+        target.signaled.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        submission request;
+        while (target.queue.pop(request))
+        {
+            target.queued.fetch_sub(1, std::memory_order_relaxed);
+            if (request.sink != nullptr) target.client->make_request(std::move(request.message), *request.sink, std::move(request.handler));
+            else target.client->make_request(std::move(request.message), std::move(request.handler));
+        }
+    }
+} // cnet
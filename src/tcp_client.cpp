@@ -3,86 +3,317 @@
 //
 
 #include "tcp_client.h"
+#include "byte_scan.h"
 
+#include <algorithm>
 #include <stdexcept>
+#include <vector>
 
 #ifdef __WIN32
 #include <winsock2.h>
 #include <windows.h>
+#include <io.h>
 #include <ws2tcpip.h>
 #include <cstdio>
 // #include <openssl/openssl.h>
 #pragma comment(lib, "ws2_32.lib") // Winsock Library
 #else
 #include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #endif
+#include <chrono>
 #include <iostream>
 
 #include "openssl/ssl.h"
 #include "openssl/err.h"
 
+// SSL_sendfile and kernel TLS arrived with OpenSSL 3.0
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS) && !defined(__WIN32)
+#define CNET_KTLS
+#endif
+
 namespace cnet
 {
-    void tcp_client::create_ssl_handshake()
+    static short to_poll_events(const io_wait wait)
+    {
+        return wait == io_wait::read ? POLLIN : POLLOUT;
+    }
+
+    static bool contains_terminator(const std::string &data, size_t from)
+    {
+        // only the \n are searched for, each is checked for the \r\n\r before it
+        while (from < data.size())
+        {
+            const size_t newline = from + find_byte(data.data() + from, data.size() - from, '\n');
+            if (newline == data.size()) return false;
+            if (newline >= 3 && data.compare(newline - 3, 3, "\r\n\r") == 0) return true;
+            from = newline + 1;
+        }
+        return false;
+    }
+
+    void tcp_client::create_ssl_handshake(std::shared_ptr<tls_context> context)
     {
-        SSL_library_init();
-        if (ssl_context == nullptr)
+        // The socket is non-blocking, so the handshake is retried whenever OpenSSL needs the socket to become ready.
+        const long long deadline = make_deadline();
+        for (io_wait wait; !try_ssl_handshake(wait, context);)
+        {
+            wait_for(to_poll_events(wait), deadline);
+        }
+    }
+
+    bool tcp_client::try_ssl_handshake(io_wait &wait, const std::shared_ptr<tls_context> &context)
+    {
+        wait = io_wait::none;
+        if (ssl == nullptr)
+        {
+            ssl_context = context;
+            ssl = ssl_context->create_ssl(host, port);
+            SSL_set_fd(ssl, static_cast<int>(sock));
+        }
+        const int result = SSL_connect(ssl);
+        if (result == 1)
+        {
+            ssl_context->record_handshake(ssl);
+            return true;
+        }
+        const int error = SSL_get_error(ssl, result);
+        if (error == SSL_ERROR_WANT_READ) wait = io_wait::read;
+        else if (error == SSL_ERROR_WANT_WRITE) wait = io_wait::write;
+        else
         {
-            SSL_load_error_strings();
-            ssl_context = SSL_CTX_new(SSLv23_client_method());
+            ERR_print_errors_fp(stderr);
+            throw std::runtime_error("Failed to create SSL connection");
+        }
+        return false;
+    }
 
-            if (ssl_context == nullptr)
+    size_t tcp_client::try_send(const char *data, const size_t size, io_wait &wait)
+    {
+        wait = io_wait::none;
+        if (ssl != nullptr)
+        {
+            size_t written = 0;
+            const int result = SSL_write_ex(ssl, data, size, &written);
+            if (result == 1) return written;
+            const int error = SSL_get_error(ssl, result);
+            if (error == SSL_ERROR_WANT_READ) wait = io_wait::read;
+            else if (error == SSL_ERROR_WANT_WRITE) wait = io_wait::write;
+            else
             {
                 ERR_print_errors_fp(stderr);
-                throw std::runtime_error("Failed to create SSL context");
+                throw std::runtime_error("Failed to write to SSL connection");
             }
+            return 0;
         }
-        ssl = SSL_new(ssl_context);
-        SSL_set_fd(ssl, static_cast<int>(sock));
-        if (SSL_connect(ssl) == -1)
+#ifdef __WIN32
+        const int result = ::send(sock, data, static_cast<int>(size), 0);
+        if (result != SOCKET_ERROR) return result;
+        if (WSAGetLastError() == WSAEWOULDBLOCK)
         {
-            ERR_print_errors_fp(stderr);
-            throw std::runtime_error("Failed to create SSL connection");
+            wait = io_wait::write;
+            return 0;
+        }
+        const int error = WSAGetLastError();
+        close();
+        throw std::runtime_error("Error at send(): " + std::to_string(error));
+#else
+        while (true)
+        {
+            const ssize_t result = ::send(static_cast<int>(sock), data, size, MSG_NOSIGNAL);
+            if (result >= 0) return result;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                wait = io_wait::write;
+                return 0;
+            }
+            const int error = errno;
+            close();
+            throw std::runtime_error("Error at send(): " + std::string(strerror(error)));
+        }
+#endif
+    }
+
+    size_t tcp_client::try_send(const const_buffer *buffers, const size_t count, io_wait &wait)
+    {
+        wait = io_wait::none;
+        if (count == 0) return 0;
+        if (ssl != nullptr || count == 1)
+        {
+            // a TLS record carries up to 16 KiB, so small segments are coalesced into one SSL_write_ex rather than a
+            // record each, while a segment that fills a record on its own is encrypted straight from where it is stored
+            if (count == 1 || buffers[0].size >= CNET_TLS_RECORD_SIZE) return try_send(buffers[0].data, buffers[0].size, wait);
+            char coalesced[CNET_TLS_RECORD_SIZE];
+            size_t size = 0;
+            for (size_t i = 0; i < count && size < sizeof(coalesced); i++)
+            {
+                const size_t length = std::min(buffers[i].size, sizeof(coalesced) - size);
+                memcpy(coalesced + size, buffers[i].data, length);
+                size += length;
+            }
+            return try_send(coalesced, size, wait);
         }
+#ifdef __WIN32
+        return try_send(buffers[0].data, buffers[0].size, wait);
+#else
+        iovec vectors[CNET_MAX_SEND_SEGMENTS];
+        msghdr header{};
+        header.msg_iov = vectors;
+        header.msg_iovlen = std::min<size_t>(count, CNET_MAX_SEND_SEGMENTS);
+        for (size_t i = 0; i < header.msg_iovlen; i++)
+        {
+            vectors[i].iov_base = const_cast<char *>(buffers[i].data);
+            vectors[i].iov_len = buffers[i].size;
+        }
+        while (true)
+        {
+            // sendmsg is writev with flags, MSG_NOSIGNAL keeps a closed connection from raising SIGPIPE
+            const ssize_t result = ::sendmsg(static_cast<int>(sock), &header, MSG_NOSIGNAL);
+            if (result >= 0) return result;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                wait = io_wait::write;
+                return 0;
+            }
+            const int error = errno;
+            close();
+            throw std::runtime_error("Error at sendmsg(): " + std::string(strerror(error)));
+        }
+#endif
+    }
+
+    size_t tcp_client::try_receive(char *buffer, const size_t size, io_wait &wait)
+    {
+        wait = io_wait::none;
+        if (ssl != nullptr)
+        {
+            size_t read = 0;
+            const int result = SSL_read_ex(ssl, buffer, size, &read);
+            if (result == 1) return read;
+            const int error = SSL_get_error(ssl, result);
+            if (error == SSL_ERROR_ZERO_RETURN) return 0;
+            if (error == SSL_ERROR_WANT_READ) wait = io_wait::read;
+            else if (error == SSL_ERROR_WANT_WRITE) wait = io_wait::write;
+            else
+            {
+                ERR_print_errors_fp(stderr);
+                throw std::runtime_error("Failed to read from SSL connection");
+            }
+            return 0;
+        }
+#ifdef __WIN32
+        const int result = recv(sock, buffer, static_cast<int>(size), 0);
+        if (result != SOCKET_ERROR) return result;
+        if (WSAGetLastError() == WSAEWOULDBLOCK)
+        {
+            wait = io_wait::read;
+            return 0;
+        }
+        const int error = WSAGetLastError();
+        close();
+        throw std::runtime_error("Error at recv(): " + std::to_string(error));
+#else
+        while (true)
+        {
+            const ssize_t result = recv(static_cast<int>(sock), buffer, size, 0);
+            // a zero byte read means the peer has closed the connection
+            if (result >= 0) return result;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                wait = io_wait::read;
+                return 0;
+            }
+            const int error = errno;
+            close();
+            throw std::runtime_error("Error at recv(): " + std::string(strerror(error)));
+        }
+#endif
     }
 
     void tcp_client::write_ssl(const std::string &message) const
     {
-        if (SSL_write(ssl, message.c_str(), static_cast<int>(message.size())) <= 0)
+        const long long deadline = make_deadline();
+        size_t written = 0;
+        while (written < message.size())
         {
-            ERR_print_errors_fp(stderr);
-            throw std::runtime_error("Failed to write to SSL connection");
+            const int result = SSL_write(ssl, message.c_str() + written, static_cast<int>(message.size() - written));
+            if (result > 0)
+            {
+                written += result;
+                continue;
+            }
+            const int error = SSL_get_error(ssl, result);
+            if (error == SSL_ERROR_WANT_READ) wait_for(POLLIN, deadline);
+            else if (error == SSL_ERROR_WANT_WRITE) wait_for(POLLOUT, deadline);
+            else
+            {
+                ERR_print_errors_fp(stderr);
+                throw std::runtime_error("Failed to write to SSL connection");
+            }
         }
     }
 
     std::string tcp_client::read_ssl(const unsigned long long buffer_size) const
     {
-        char buffer[buffer_size];
-        if (SSL_read(ssl, buffer, static_cast<int>(buffer_size)) <= 0)
+        const long long deadline = make_deadline();
+        std::string buffer(buffer_size, '\0');
+        while (true)
         {
-            ERR_print_errors_fp(stderr);
-            throw std::runtime_error("Failed to read from SSL connection");
+            const int result = SSL_read(ssl, buffer.data(), static_cast<int>(buffer_size));
+            if (result > 0)
+            {
+                buffer.resize(static_cast<size_t>(result));
+                return buffer;
+            }
+            const int error = SSL_get_error(ssl, result);
+            if (error == SSL_ERROR_ZERO_RETURN) return "";
+            if (error == SSL_ERROR_WANT_READ) wait_for(POLLIN, deadline);
+            else if (error == SSL_ERROR_WANT_WRITE) wait_for(POLLOUT, deadline);
+            else
+            {
+                ERR_print_errors_fp(stderr);
+                throw std::runtime_error("Failed to read from SSL connection");
+            }
         }
-        return {buffer};
     }
 
     std::string tcp_client::read_ssl_until_eof() const
     {
         std::string response;
-        constexpr unsigned long long buffer_size = 4096;
-        char buffer[buffer_size] = {};
+        const long long deadline = make_deadline();
+        io_buffer buffer = buffer_pool::get_default().acquire();
         while (true)
         {
-            memset(buffer, 0, buffer_size); // zero out the buffer (clears any previous data)
-            const int bytes = SSL_read(ssl, buffer, buffer_size);
+            // only the bytes SSL_read reports are used, so the buffer is never cleared
+            const int bytes = SSL_read(ssl, buffer.data(), static_cast<int>(buffer.capacity()));
             if (bytes <= 0)
             {
-                if (bytes < 0)
+                const int error = SSL_get_error(ssl, bytes);
+                if (error == SSL_ERROR_WANT_READ)
+                {
+                    wait_for(POLLIN, deadline);
+                    continue;
+                }
+                if (error == SSL_ERROR_WANT_WRITE)
+                {
+                    wait_for(POLLOUT, deadline);
+                    continue;
+                }
+                if (error != SSL_ERROR_ZERO_RETURN)
                 {
                     ERR_print_errors_fp(stderr);
                     throw std::runtime_error("Failed to read from SSL connection");
@@ -92,10 +323,10 @@ namespace cnet
             }
 
             // Append only the part of buffer that was filled
-            response.append(buffer, bytes);
-            // check if the response ends with \r\n\r\n
-            std::cout << response.substr(response.size() - 4) << std::endl;
-            if (response.size() >= 4 && response.substr(response.size() - 4) == "\r\n\r\n" || response.find("\r\n\r\n") != std::string::npos)
+            const size_t previous = response.size();
+            response.append(buffer.data(), bytes);
+            // check if the response contains \r\n\r\n, only a terminator ending in the new bytes can be new
+            if (contains_terminator(response, previous))
             {
                 break;
             }
@@ -104,11 +335,45 @@ namespace cnet
         return response;
     }
 
-    tcp_client tcp_client::connect(const std::string &host, const unsigned int port)
+    long long tcp_client::make_deadline() const
+    {
+        const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+        return now.count() + timeout;
+    }
+
+    void tcp_client::wait_for(const short events, const long long deadline_ms) const
+    {
+        while (true)
+        {
+            const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            const long long remaining = deadline_ms - now;
+            if (remaining <= 0) throw std::runtime_error("Timed out waiting for " + host + ":" + std::to_string(port));
+
+            pollfd fd{};
+            fd.fd = static_cast<decltype(fd.fd)>(sock);
+            fd.events = events;
+#ifdef __WIN32
+            const int result = WSAPoll(&fd, 1, static_cast<int>(remaining));
+            if (result == SOCKET_ERROR) throw std::runtime_error("Error at poll(): " + std::to_string(WSAGetLastError()));
+#else
+            const int result = poll(&fd, 1, static_cast<int>(remaining));
+            if (result < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Error at poll(): " + std::string(strerror(errno)));
+            }
+#endif
+            // POLLERR and POLLHUP are reported as ready, the following read or write will surface the actual error.
+            if (result > 0) return;
+        }
+    }
+
+    tcp_client tcp_client::connect(const std::string &host, const unsigned int port, const unsigned int timeout, const std::shared_ptr<resolver> &host_resolver)
     {
         tcp_client client;
         client.host = host;
         client.port = port;
+        client.timeout = timeout;
 
 #ifdef __WIN32
         //  initialize winsock
@@ -162,13 +427,212 @@ namespace cnet
 
 
 #else
-        // TODO: Implement for unix
+        client = start_connect(host, port, timeout, host_resolver);
+        const long long deadline = client.make_deadline();
+        try
+        {
+            while (!client.finish_connect())
+            {
+                client.wait_for_connect(deadline);
+            }
+        } catch (...)
+        {
+            client.close();
+            throw;
+        }
 #endif
 
         client.is_open = true;
         return client;
     }
 
+#ifndef __WIN32
+    static long long now_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    tcp_client tcp_client::start_connect(const std::string &host, const unsigned int port, const unsigned int timeout, const std::shared_ptr<resolver> &host_resolver)
+    {
+        const resolution answer = (host_resolver != nullptr ? host_resolver : resolver::get_default())->resolve(host);
+        return start_connect(host, port, answer.addresses, timeout);
+    }
+
+    tcp_client tcp_client::start_connect(const std::string &host, const unsigned int port, const std::vector<endpoint> &addresses, const unsigned int timeout)
+    {
+        tcp_client client = prepare_connect(host, port, addresses, timeout);
+        if (!client.start_attempt())
+        {
+            throw std::runtime_error("Failed to connect to " + host + ":" + std::to_string(port) + ": " + std::string(strerror(client.last_error)));
+        }
+        return client;
+    }
+
+    tcp_client tcp_client::prepare_connect(const std::string &host, const unsigned int port, const std::vector<endpoint> &addresses, const unsigned int timeout)
+    {
+        tcp_client client;
+        client.host = host;
+        client.port = port;
+        client.timeout = timeout;
+        client.endpoints = order_for_connect(addresses);
+        for (endpoint &address: client.endpoints)
+        {
+            address.set_port(port);
+        }
+        client.connecting = true;
+        client.is_open = true;
+        client.last_error = ECONNREFUSED;
+        return client;
+    }
+
+    int tcp_client::open_socket(const endpoint &address)
+    {
+        const int fd = socket(address.get_family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (fd < 0)
+        {
+            last_error = errno;
+            return -1;
+        }
+        // requests are small and latency bound, so don't let Nagle hold them back
+        constexpr int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        attempts.push_back(fd);
+        // RFC 8305: the next address is tried alongside this one if it hasn't connected by then
+        next_attempt = now_ms() + CNET_CONNECTION_ATTEMPT_DELAY;
+        return fd;
+    }
+
+    bool tcp_client::start_attempt()
+    {
+        while (next_endpoint < endpoints.size())
+        {
+            const endpoint &address = endpoints[next_endpoint++];
+            const int fd = open_socket(address);
+            if (fd < 0) continue;
+            if (::connect(fd, reinterpret_cast<const sockaddr *>(&address.address), address.length) == 0 || errno == EINPROGRESS) return true;
+            last_error = errno;
+            attempts.pop_back();
+            ::close(fd);
+        }
+        return false;
+    }
+
+    void tcp_client::win_attempt(const int fd)
+    {
+        for (const int attempt: attempts)
+        {
+            if (attempt != fd) ::close(attempt);
+        }
+        attempts.clear();
+        endpoints.clear();
+        next_endpoint = 0;
+        connecting = false;
+        sock = fd;
+    }
+
+    void tcp_client::fail_attempt(const int fd, const int error)
+    {
+        last_error = error;
+        attempts.erase(std::remove(attempts.begin(), attempts.end(), fd), attempts.end());
+        ::close(fd);
+        if (attempts.empty() && !has_next_address())
+        {
+            is_open = false;
+            connecting = false;
+            throw std::runtime_error("Failed to connect to " + host + ":" + std::to_string(port) + ": " + std::string(strerror(last_error)));
+        }
+    }
+
+    bool tcp_client::finish_connect()
+    {
+        if (!connecting) return true;
+
+        std::vector<pollfd> fds(attempts.size());
+        for (size_t i = 0; i < attempts.size(); i++)
+        {
+            fds[i].fd = attempts[i];
+            fds[i].events = POLLOUT;
+        }
+        if (poll(fds.data(), fds.size(), 0) > 0)
+        {
+            for (const pollfd &fd: fds)
+            {
+                if (fd.revents == 0) continue;
+                // the connect has finished, SO_ERROR tells if it succeeded
+                int error = 0;
+                socklen_t length = sizeof(error);
+                if (getsockopt(fd.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0) error = errno;
+                if (error == 0)
+                {
+                    win_attempt(fd.fd);
+                    return true;
+                }
+                fail_attempt(fd.fd, error);
+            }
+        }
+
+        // a failed attempt is replaced at once, a slow one gets company once the attempt delay has passed
+        if ((attempts.empty() || now_ms() >= next_attempt) && has_next_address()) start_attempt();
+        if (attempts.empty())
+        {
+            is_open = false;
+            connecting = false;
+            throw std::runtime_error("Failed to connect to " + host + ":" + std::to_string(port) + ": " + std::string(strerror(last_error)));
+        }
+        return false;
+    }
+
+    void tcp_client::wait_for_connect(const long long deadline_ms) const
+    {
+        std::vector<pollfd> fds(attempts.size());
+        for (size_t i = 0; i < attempts.size(); i++)
+        {
+            fds[i].fd = attempts[i];
+            fds[i].events = POLLOUT;
+        }
+        while (true)
+        {
+            const long long now = now_ms();
+            if (now >= deadline_ms) throw std::runtime_error("Timed out waiting for " + host + ":" + std::to_string(port));
+            long long wait = deadline_ms - now;
+            if (const int delay = get_attempt_delay(); delay >= 0) wait = std::min<long long>(wait, delay);
+            const int result = poll(fds.data(), fds.size(), static_cast<int>(wait));
+            if (result < 0 && errno == EINTR) continue;
+            if (result < 0) throw std::runtime_error("Error at poll(): " + std::string(strerror(errno)));
+            return;
+        }
+    }
+
+    int tcp_client::get_attempt_delay() const
+    {
+        if (!connecting || !has_next_address()) return -1;
+        return static_cast<int>(std::max<long long>(next_attempt - now_ms(), 0));
+    }
+
+    int tcp_client::open_attempt(endpoint &address)
+    {
+        while (has_next_address())
+        {
+            address = endpoints[next_endpoint++];
+            if (const int fd = open_socket(address); fd >= 0) return fd;
+        }
+        is_open = false;
+        connecting = false;
+        throw std::runtime_error("Failed to connect to " + host + ":" + std::to_string(port) + ": " + std::string(strerror(last_error)));
+    }
+
+    bool tcp_client::complete_attempt(const int fd, const int error)
+    {
+        if (error != 0)
+        {
+            fail_attempt(fd, error);
+            return false;
+        }
+        win_attempt(fd);
+        return true;
+    }
+#endif
+
 
     void tcp_client::send(const std::string &message)
     {
@@ -177,70 +641,287 @@ namespace cnet
         std::lock_guard lock(mutex);
 #endif
 #ifdef __WIN32
+        if (ssl != nullptr)
+        {
+            write_ssl(message);
+            return;
+        }
         if (iResult = ::send(sock, message.c_str(), static_cast<int>(message.size()), 0); iResult == SOCKET_ERROR)
         {
             close();
             throw std::runtime_error("Error at send(): " + std::to_string(WSAGetLastError()));
         }
 #else
-        // TODO: Implement for unix
+        const long long deadline = make_deadline();
+        size_t sent = 0;
+        while (sent < message.size())
+        {
+            io_wait wait;
+            sent += try_send(message.c_str() + sent, message.size() - sent, wait);
+            if (wait != io_wait::none) wait_for(to_poll_events(wait), deadline);
+        }
 #endif
     }
 
 
+    static long long read_at(const int fd, char *buffer, const size_t size, const unsigned long long offset)
+    {
+#ifdef __WIN32
+        if (_lseeki64(fd, static_cast<long long>(offset), SEEK_SET) < 0) return -1;
+        return _read(fd, buffer, static_cast<unsigned int>(size));
+#else
+        ssize_t result;
+        do
+        {
+            result = pread(fd, buffer, size, static_cast<off_t>(offset));
+        } while (result < 0 && errno == EINTR);
+        return result;
+#endif
+    }
+
+    void tcp_client::send_file(const int fd, unsigned long long offset, unsigned long long size)
+    {
+        if (!is_open) throw std::runtime_error("Socket is not open");
+#ifdef CNET_TCP_THREADSAFE
+        std::lock_guard lock(mutex);
+#endif
+        // the timeout applies to each stall rather than to the whole file, which may take far longer to send
+        long long deadline = make_deadline();
+#ifndef __WIN32
+        if (ssl == nullptr)
+        {
+            // the kernel moves the pages of the file straight to the socket, they are never copied to user space
+            while (size > 0)
+            {
+                off_t position = static_cast<off_t>(offset);
+                const ssize_t result = ::sendfile(static_cast<int>(sock), fd, &position, std::min<unsigned long long>(size, CNET_SENDFILE_CHUNK_SIZE));
+                if (result > 0)
+                {
+                    offset += result;
+                    size -= result;
+                    deadline = make_deadline();
+                    continue;
+                }
+                if (result == 0) throw std::runtime_error("The file ended before the body was sent");
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    wait_for(POLLOUT, deadline);
+                    continue;
+                }
+                // a file that can't be mapped, e.g. on some network and FUSE file systems, is read instead
+                if (errno == EINVAL || errno == ENOSYS) break;
+                const int error = errno;
+                close();
+                throw std::runtime_error("Error at sendfile(): " + std::string(strerror(error)));
+            }
+        }
+#ifdef CNET_KTLS
+        else if (is_kernel_tls())
+        {
+            // the records are encrypted by the kernel as it sends the pages of the file
+            while (size > 0)
+            {
+                const ossl_ssize_t result = SSL_sendfile(ssl, fd, static_cast<off_t>(offset), std::min<unsigned long long>(size, CNET_SENDFILE_CHUNK_SIZE), 0);
+                if (result > 0)
+                {
+                    offset += result;
+                    size -= result;
+                    deadline = make_deadline();
+                    continue;
+                }
+                const int error = SSL_get_error(ssl, static_cast<int>(result));
+                if (error == SSL_ERROR_WANT_READ) wait_for(POLLIN, deadline);
+                else if (error == SSL_ERROR_WANT_WRITE) wait_for(POLLOUT, deadline);
+                else
+                {
+                    ERR_print_errors_fp(stderr);
+                    throw std::runtime_error("Failed to send the file over the SSL connection");
+                }
+            }
+        }
+#endif
+#endif
+        std::vector<char> buffer(static_cast<size_t>(std::min<unsigned long long>(size, CNET_FILE_CHUNK_SIZE)));
+        while (size > 0)
+        {
+            const long long read = read_at(fd, buffer.data(), static_cast<size_t>(std::min<unsigned long long>(size, buffer.size())), offset);
+            if (read < 0) throw std::runtime_error("Failed to read the file being sent");
+            if (read == 0) throw std::runtime_error("The file ended before the body was sent");
+            for (size_t sent = 0; sent < static_cast<size_t>(read);)
+            {
+                io_wait wait;
+                const size_t written = try_send(buffer.data() + sent, static_cast<size_t>(read) - sent, wait);
+                if (wait != io_wait::none) wait_for(to_poll_events(wait), deadline);
+                else deadline = make_deadline();
+                sent += written;
+            }
+            offset += read;
+            size -= read;
+        }
+    }
+
+    bool tcp_client::is_kernel_tls() const
+    {
+#ifdef CNET_KTLS
+        return ssl != nullptr && BIO_get_ktls_send(SSL_get_wbio(ssl));
+#else
+        return false;
+#endif
+    }
+
+    std::string tcp_client::get_alpn_protocol() const
+    {
+        if (ssl == nullptr) return {};
+        const unsigned char *protocol = nullptr;
+        unsigned int length = 0;
+        SSL_get0_alpn_selected(ssl, &protocol, &length);
+        return {reinterpret_cast<const char *>(protocol), length};
+    }
+
+    void tcp_client::send(const const_buffer *buffers, const size_t count)
+    {
+        if (!is_open) throw std::runtime_error("Socket is not open");
+#ifdef CNET_TCP_THREADSAFE
+        std::lock_guard lock(mutex);
+#endif
+        std::vector<const_buffer> remaining(buffers, buffers + count);
+        size_t first = 0;
+        const long long deadline = make_deadline();
+        while (first < remaining.size())
+        {
+            io_wait wait;
+            size_t sent = try_send(remaining.data() + first, remaining.size() - first, wait);
+            if (wait != io_wait::none)
+            {
+#ifdef __WIN32
+                throw std::runtime_error("Error at send(): the socket would block");
+#else
+                wait_for(to_poll_events(wait), deadline);
+                continue;
+#endif
+            }
+            for (; first < remaining.size() && sent >= remaining[first].size; first++)
+            {
+                sent -= remaining[first].size;
+            }
+            if (sent > 0)
+            {
+                remaining[first].data += sent;
+                remaining[first].size -= sent;
+            }
+        }
+    }
+
     std::string tcp_client::receive(const unsigned long long buffer_size)
     {
         if (!is_open) throw std::runtime_error("Socket is not open");
 
 #ifdef  __WIN32
-        iResult = shutdown(sock, SD_SEND);
-        if (iResult == SOCKET_ERROR)
+        if (ssl == nullptr)
         {
+            iResult = shutdown(sock, SD_SEND);
+            if (iResult == SOCKET_ERROR)
+            {
+                close();
+                throw std::runtime_error("Error at shutdown(): " + std::to_string(WSAGetLastError()));
+            }
+
+            std::string received;
+            size_t size = 0;
+            do
+            {
+                received.resize(size + buffer_size);
+                iResult = recv(sock, received.data() + size, static_cast<int>(buffer_size), 0);
+                if (iResult > 0) size += iResult;
+            } while (iResult > 0);
+            received.resize(size);
+
             close();
-            throw std::runtime_error("Error at shutdown(): " + std::to_string(WSAGetLastError()));
+            if (iResult == SOCKET_ERROR) throw std::runtime_error("Error at recv(): " + std::to_string(WSAGetLastError()));
+            return received;
         }
+#endif
+        std::string buffer(buffer_size, '\0');
+        buffer.resize(receive(buffer.data(), buffer_size));
+        return buffer;
+    }
 
-        char recvBuffer[buffer_size];
-        do
+    size_t tcp_client::receive(char *buffer, const unsigned long long buffer_size)
+    {
+        if (!is_open) throw std::runtime_error("Socket is not open");
+        const long long deadline = make_deadline();
+#ifdef __WIN32
+        if (ssl == nullptr)
         {
-            iResult = recv(sock, recvBuffer, buffer_size, 0);
-            if (iResult > 0)
-                printf("Bytes received: %d\n", iResult);
-            else if (iResult == 0)
-                printf("Connection closed\n");
-            else
-                printf("recv failed: %d\n", WSAGetLastError());
-        } while (iResult > 0);
+            iResult = recv(sock, buffer, static_cast<int>(buffer_size), 0);
+            if (iResult == SOCKET_ERROR)
+            {
+                close();
+                throw std::runtime_error("Error at recv(): " + std::to_string(WSAGetLastError()));
+            }
+            return iResult;
+        }
+#endif
+        while (true)
+        {
+            io_wait wait;
+            const size_t received = try_receive(buffer, static_cast<size_t>(buffer_size), wait);
+            // nothing received without anything to wait for means the peer has closed the connection
+            if (received > 0 || wait == io_wait::none) return received;
+            wait_for(to_poll_events(wait), deadline);
+        }
+    }
 
+    size_t tcp_client::receive(io_buffer &buffer)
+    {
+        const size_t received = receive(buffer.tail(), buffer.available());
+        buffer.commit(received);
+        return received;
+    }
 
-        close();
-        return {recvBuffer};
+    bool tcp_client::is_connected() const
+    {
+        if (!is_open) return false;
+        pollfd fd{};
+        fd.fd = static_cast<decltype(fd.fd)>(sock);
+        fd.events = POLLIN;
+#ifdef __WIN32
+        const int result = WSAPoll(&fd, 1, 0);
 #else
-        // TODO: Implement for unix
-
-        return "";
+        const int result = poll(&fd, 1, 0);
 #endif
+        if (result == 0) return true; // nothing pending, the connection is idle
+        if (result < 0 || (fd.revents & (POLLERR | POLLHUP)) != 0) return false;
+
+        // readable: either the peer closed the connection, or data is pending
+        char byte;
+        if (recv(fd.fd, &byte, 1, MSG_PEEK) <= 0) return false;
+        // an idle SSL connection may still have records such as session tickets waiting, plain data is unexpected
+        return ssl != nullptr;
     }
 
     void tcp_client::close()
     {
+#ifndef __WIN32
+        for (const int attempt: attempts)
+        {
+            ::close(attempt);
+        }
+        attempts.clear();
+        connecting = false;
+#endif
         if (!is_open) return;
         is_open = false;
 
-        if (port == 443)
+        if (ssl != nullptr)
         {
-            if (ssl != nullptr)
-            {
-                SSL_shutdown(ssl);
-                SSL_free(ssl);
-                ssl = nullptr;
-            }
-            if (ssl_context != nullptr)
-            {
-                SSL_CTX_free(ssl_context);
-                ssl_context = nullptr;
-            }
+            SSL_shutdown(ssl);
+            SSL_free(ssl);
+            ssl = nullptr;
         }
+        // the context is shared with other connections and keeps the cached sessions, so only our reference is dropped
+        ssl_context = nullptr;
 
 #ifdef __WIN32
         if (sock != INVALID_SOCKET)
@@ -251,7 +932,11 @@ namespace cnet
         WSACleanup();
 
 #else
-        // TODO: Implement for unix
+        if (sock != static_cast<unsigned long long>(~0))
+        {
+            ::close(static_cast<int>(sock));
+            sock = ~0;
+        }
 #endif
     }
 }
@@ -0,0 +1,167 @@
+﻿//
+// Created by drew.chase on 10/17/2026.
+//
+
+#include "tls_context.h"
+
+#include <stdexcept>
+#include <utility>
+
+#include "openssl/err.h"
+#include "openssl/x509v3.h"
+
+namespace cnet
+{
+    static void free_session_key(void *, void *key, CRYPTO_EX_DATA *, int, long, void *)
+    {
+        delete static_cast<std::string *>(key);
+    }
+
+    // index of the host:port key attached to every SSL object, used to file the sessions handed to on_new_session
+    static int session_key_index()
+    {
+        static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, free_session_key);
+        return index;
+    }
+
+    tls_context::tls_context(tls_options options): options(std::move(options))
+    {
+        OPENSSL_init_ssl(OPENSSL_INIT_LOAD_SSL_STRINGS | OPENSSL_INIT_LOAD_CRYPTO_STRINGS, nullptr);
+        context = SSL_CTX_new(TLS_client_method());
+        if (context == nullptr)
+        {
+            ERR_print_errors_fp(stderr);
+            throw std::runtime_error("Failed to create SSL context");
+        }
+
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+        // many servers close without a close_notify, which would otherwise fail bodies delimited by the connection closing
+        SSL_CTX_set_options(context, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+        // scatter-gather sends coalesce small segments into a buffer that may be at another address when a write is retried
+        SSL_CTX_set_mode(context, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_ENABLE_KTLS
+        // OpenSSL falls back to encrypting in user space by itself whenever the kernel can't take over
+        if (this->options.kernel_tls) SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+#endif
+
+        if (!this->options.alpn.empty())
+        {
+            // the wire format is each protocol prefixed by its length
+            std::string protocols;
+            for (const std::string &protocol: this->options.alpn)
+            {
+                protocols += static_cast<char>(protocol.size());
+                protocols += protocol;
+            }
+            SSL_CTX_set_alpn_protos(context, reinterpret_cast<const unsigned char *>(protocols.data()), static_cast<unsigned int>(protocols.size()));
+        }
+
+        if (this->options.verify_peer)
+        {
+            const bool loaded = this->options.ca_file.empty()
+                                    ? SSL_CTX_set_default_verify_paths(context) == 1
+                                    : SSL_CTX_load_verify_locations(context, this->options.ca_file.c_str(), nullptr) == 1;
+            if (!loaded)
+            {
+                ERR_print_errors_fp(stderr);
+                SSL_CTX_free(context);
+                throw std::runtime_error("Failed to load the trusted certificate authorities");
+            }
+            SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+        }
+
+        // sessions are kept in our own cache keyed by host:port, OpenSSL's internal cache is keyed by session id which a client can't look up
+        SSL_CTX_set_app_data(context, this);
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(context, on_new_session);
+    }
+
+    tls_context::~tls_context()
+    {
+        clear_sessions();
+        SSL_CTX_free(context);
+    }
+
+    std::shared_ptr<tls_context> tls_context::get(const tls_options &options)
+    {
+        static std::mutex registry_mutex;
+        static std::map<std::string, std::shared_ptr<tls_context>> registry;
+
+        std::string key = std::to_string(options.verify_peer) + "|" + std::to_string(options.max_sessions) + "|" + std::to_string(options.kernel_tls) + "|" + options.ca_file;
+        for (const std::string &protocol: options.alpn)
+        {
+            key += "|" + protocol;
+        }
+        std::lock_guard lock(registry_mutex);
+        std::shared_ptr<tls_context> &context = registry[key];
+        if (context == nullptr) context = std::make_shared<tls_context>(options);
+        return context;
+    }
+
+    SSL *tls_context::create_ssl(const std::string &host, const unsigned int port)
+    {
+        SSL *ssl = SSL_new(context);
+        if (ssl == nullptr)
+        {
+            ERR_print_errors_fp(stderr);
+            throw std::runtime_error("Failed to create SSL connection");
+        }
+        SSL_set_tlsext_host_name(ssl, host.c_str());
+        if (options.verify_peer) SSL_set1_host(ssl, host.c_str());
+
+        auto *key = new std::string(host + ":" + std::to_string(port));
+        SSL_set_ex_data(ssl, session_key_index(), key);
+
+        std::lock_guard lock(mutex);
+        if (const auto it = sessions.find(*key); it != sessions.end() && SSL_SESSION_is_resumable(it->second))
+        {
+            SSL_set_session(ssl, it->second);
+        }
+        return ssl;
+    }
+
+    int tls_context::on_new_session(SSL *ssl, SSL_SESSION *session)
+    {
+        auto *self = static_cast<tls_context *>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+        const auto *key = static_cast<std::string *>(SSL_get_ex_data(ssl, session_key_index()));
+        if (self == nullptr || key == nullptr) return 0;
+
+        std::lock_guard lock(self->mutex);
+        if (const auto it = self->sessions.find(*key); it != self->sessions.end())
+        {
+            SSL_SESSION_free(it->second);
+            it->second = session;
+            return 1;
+        }
+        if (self->sessions.size() >= self->options.max_sessions)
+        {
+            // the cache is full, make room by dropping an arbitrary entry
+            SSL_SESSION_free(self->sessions.begin()->second);
+            self->sessions.erase(self->sessions.begin());
+        }
+        self->sessions.emplace(*key, session);
+        return 1; // the cache now owns the reference
+    }
+
+    void tls_context::record_handshake(SSL *ssl)
+    {
+        ++handshakes;
+        if (SSL_session_reused(ssl) == 1) ++resumed;
+    }
+
+    void tls_context::clear_sessions()
+    {
+        std::lock_guard lock(mutex);
+        for (auto &[key, session]: sessions)
+        {
+            SSL_SESSION_free(session);
+        }
+        sessions.clear();
+    }
+
+    tls_stats tls_context::get_stats() const
+    {
+        return {handshakes.load(), resumed.load()};
+    }
+} // cnet
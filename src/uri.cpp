@@ -5,129 +5,335 @@
 #include <utility>
 
 #include "../includes/uri.h"
+#include <array>
+#include <limits>
 #include <stdexcept>
 
 namespace cnet
 {
-    uri::uri(std::string url)
-    {
-        if (!validate_url(url))
-        {
-            throw std::invalid_argument("Invalid URL");
-        }
-        std::string temp = std::move(url);
-        if (temp.find("://") != std::string::npos)
+    // the characters RFC 3986 allows in each component, a percent-encoded octet is checked separately
+    static constexpr uint8_t scheme_char = 1;
+    static constexpr uint8_t host_char = 2; // reg-name: unreserved and sub-delims
+    static constexpr uint8_t userinfo_char = 4; // reg-name and :
+    static constexpr uint8_t path_char = 8; // pchar: userinfo, @ and /
+    static constexpr uint8_t query_char = 16; // path and ?, also the fragment
+    static constexpr uint8_t hex_char = 32;
+
+    static constexpr std::array<uint8_t, 256> make_char_classes()
+    {
+        std::array<uint8_t, 256> classes{};
+        for (int c = 0; c < 256; c++)
         {
-            scheme = temp.substr(0, temp.find("://"));
-            temp = temp.substr(temp.find("://") + 3);
-        }
-        if (temp.find(':') != std::string::npos)
-        {
-            host = temp.substr(0, temp.find(':'));
-            temp = temp.substr(temp.find(':') + 1);
-            port = std::stoi(temp.substr(0, temp.find('/')));
-            temp = temp.substr(temp.find('/') + 1);
-        } else
-        {
-            if (temp.find('/') != std::string::npos)
-                host = temp.substr(0, temp.find('/'));
-            else
-            {
-                host = temp;
-                temp = temp.substr(0, temp.find(host));
-            }
-            temp = temp.substr(temp.find('/') + 1);
+            const bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            const bool digit = c >= '0' && c <= '9';
+            const bool unreserved = alpha || digit || c == '-' || c == '.' || c == '_' || c == '~';
+            bool sub_delim = false;
+            for (const char d: "!$&'()*+,;=") sub_delim |= d != '\0' && c == d;
+            uint8_t kind = 0;
+            if (alpha || digit || c == '+' || c == '-' || c == '.') kind |= scheme_char;
+            if (unreserved || sub_delim) kind |= host_char | userinfo_char | path_char | query_char;
+            if (c == ':') kind |= userinfo_char | path_char | query_char;
+            if (c == '@' || c == '/') kind |= path_char | query_char;
+            if (c == '?') kind |= query_char;
+            if (digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) kind |= hex_char;
+            classes[c] = kind;
         }
+        return classes;
+    }
+
+    static constexpr std::array<uint8_t, 256> char_classes = make_char_classes();
+
+    static bool is(const char c, const uint8_t kind)
+    {
+        return (char_classes[static_cast<unsigned char>(c)] & kind) != 0;
+    }
+
+    static char to_lower(const char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
 
-        if (port == ~0)
+    /**
+     * @brief Checks the character at position, moving past a whole percent-encoded octet.
+     */
+    static bool accept(const std::string &text, size_t &position, const size_t end, const uint8_t kind)
+    {
+        if (text[position] != '%') return is(text[position], kind);
+        if (position + 2 >= end || !is(text[position + 1], hex_char) || !is(text[position + 2], hex_char)) return false;
+        position += 2;
+        return true;
+    }
+
+    bool uri::parse(std::string url)
+    {
+        if (url.size() > std::numeric_limits<uint32_t>::max()) return false;
+        text = std::move(url);
+        scheme = userinfo = host = authority = path = query = fragment = span();
+        parameters.clear();
+        explicit_port = false;
+        has_authority = false;
+
+        const size_t size = text.size();
+        const auto at = [](const size_t position) { return static_cast<uint32_t>(position); };
+        size_t i = 0;
+
+        // scheme ":"
+        if (size == 0 || to_lower(text[0]) < 'a' || to_lower(text[0]) > 'z') return false;
+        for (; i < size && is(text[i], scheme_char); i++) text[i] = to_lower(text[i]);
+        if (i == size || text[i] != ':') return false;
+        scheme = {0, at(i)};
+        i++;
+
+        // "//" [ userinfo "@" ] host [ ":" port ]
+        if (i + 1 < size && text[i] == '/' && text[i + 1] == '/')
         {
-            if (scheme == "https")
+            has_authority = true;
+            i += 2;
+            size_t end = i;
+            size_t separator = std::string::npos;
+            for (; end < size && text[end] != '/' && text[end] != '?' && text[end] != '#'; end++)
             {
-                port = HTTPS_PORT;
-            } else if (scheme == "ftp")
+                if (text[end] != '@') continue;
+                // @ is allowed neither in the userinfo nor in the host
+                if (separator != std::string::npos) return false;
+                separator = end;
+            }
+            if (separator != std::string::npos)
             {
-                port = FTP_PORT;
-            } else if (scheme == "ssh")
+                for (; i < separator; i++)
+                {
+                    if (!accept(text, i, separator, userinfo_char)) return false;
+                }
+                userinfo = {scheme.size + 3, at(separator - scheme.size - 3)};
+                i = separator + 1;
+            }
+
+            const size_t authority_start = i;
+            if (i < end && text[i] == '[')
             {
-                port = SSH_PORT;
-            } else if (scheme == "telnet")
+                // IP-literal: an IPv6 address or a future version, v1.xyz
+                const size_t literal_start = ++i;
+                const bool future = i < end && (text[i] == 'v' || text[i] == 'V');
+                bool colon = false;
+                for (; i < end && text[i] != ']'; i++)
+                {
+                    colon |= text[i] == ':';
+                    if (future ? !is(text[i], userinfo_char) || text[i] == '%' : !is(text[i], hex_char) && text[i] != ':' && text[i] != '.') return false;
+                    text[i] = to_lower(text[i]);
+                }
+                if (i == end || i == literal_start || (!future && !colon)) return false;
+                host = {at(literal_start), at(i - literal_start)};
+                i++;
+                if (i < end && text[i] != ':') return false;
+            } else
             {
-                port = TELNET_PORT;
-            } else if (scheme == "smtp")
+                for (; i < end && text[i] != ':'; i++)
+                {
+                    if (!accept(text, i, end, host_char)) return false;
+                    text[i] = to_lower(text[i]);
+                }
+                host = {at(authority_start), at(i - authority_start)};
+            }
+            size_t authority_end = i;
+
+            if (i < end)
             {
-                port = SMTP_PORT;
-            } else if (scheme == "dns")
+                // the port may be empty, which means the default of the scheme
+                unsigned int number = 0;
+                for (i++; i < end; i++)
+                {
+                    if (text[i] < '0' || text[i] > '9') return false;
+                    number = number * 10 + (text[i] - '0');
+                    if (number > MAX_PORT) return false;
+                }
+                if (end > authority_end + 1)
+                {
+                    port = number;
+                    explicit_port = true;
+                    authority_end = end;
+                }
+            }
+            authority = {at(authority_start), at(authority_end - authority_start)};
+        }
+
+        // path
+        path.offset = at(i);
+        for (; i < size && text[i] != '?' && text[i] != '#'; i++)
+        {
+            if (!accept(text, i, size, path_char)) return false;
+        }
+        path.size = at(i - path.offset);
+
+        // "?" query, split into its parameters as it is checked
+        if (i < size && text[i] == '?')
+        {
+            query.offset = at(++i);
+            size_t parameter = i;
+            size_t equals = std::string::npos;
+            const auto add = [&](const size_t end)
             {
-                port = DNS_PORT;
-            } else if (scheme == "dhcp")
+                if (end == parameter) return;
+                if (equals == std::string::npos) parameters.push_back({{at(parameter), at(end - parameter)}, {at(end), 0}});
+                else parameters.push_back({{at(parameter), at(equals - parameter)}, {at(equals + 1), at(end - equals - 1)}});
+            };
+            for (; i < size && text[i] != '#'; i++)
             {
-                port = DHCP_PORT;
-            } else
+                if (text[i] == '&')
+                {
+                    add(i);
+                    parameter = i + 1;
+                    equals = std::string::npos;
+                } else if (text[i] == '=' && equals == std::string::npos) equals = i;
+                else if (!accept(text, i, size, query_char)) return false;
+            }
+            add(i);
+            query.size = at(i - query.offset);
+        }
+
+        // "#" fragment
+        if (i < size && text[i] == '#')
+        {
+            fragment.offset = at(++i);
+            for (; i < size; i++)
             {
-                // "http" or default
-                port = HTTP_PORT;
+                if (!accept(text, i, size, query_char)) return false;
             }
-        } else if (port < MIN_PORT || port > MAX_PORT)
+            fragment.size = at(size - fragment.offset);
+        }
+
+        if (!explicit_port) port = get_default_port(view(scheme));
+        return true;
+    }
+
+    uri::uri(std::string url)
+    {
+        if (!parse(std::move(url)))
         {
-            throw std::invalid_argument("Invalid port number");
+            throw std::invalid_argument("Invalid URL");
         }
+    }
 
-        if (temp.find('?') != std::string::npos)
+    void uri::split_parameters()
+    {
+        parameters.clear();
+        const std::string_view all = view(query);
+        for (size_t start = 0; start < all.size();)
         {
-            path = temp.substr(0, temp.find('?'));
-            temp = temp.substr(temp.find('?') + 1);
-            while (temp.find('&') != std::string::npos)
+            size_t end = all.find('&', start);
+            if (end == std::string_view::npos) end = all.size();
+            if (end > start)
             {
-                std::string key = temp.substr(0, temp.find('='));
-                temp = temp.substr(temp.find('=') + 1);
-                std::string value = temp.substr(0, temp.find('&'));
+                const size_t equals = all.substr(start, end - start).find('=');
+                const auto offset = [this](const size_t position) { return static_cast<uint32_t>(query.offset + position); };
+                if (equals == std::string_view::npos) parameters.push_back({{offset(start), static_cast<uint32_t>(end - start)}, {offset(end), 0}});
+                else parameters.push_back({{offset(start), static_cast<uint32_t>(equals)}, {offset(start + equals + 1), static_cast<uint32_t>(end - start - equals - 1)}});
+            }
+            start = end + 1;
+        }
+    }
 
-                if (value.find('#') != std::string::npos) // remove fragment
-                    value = value.substr(0, value.find('#'));
+    void uri::assemble(const std::string_view new_scheme, const std::string_view new_userinfo, const std::string_view new_host, const std::string_view new_path, const std::string_view new_query, const std::string_view new_fragment)
+    {
+        has_authority = has_authority || !new_host.empty() || !new_userinfo.empty();
+        const bool literal = new_host.find(':') != std::string_view::npos;
+        const bool write_port = explicit_port && port != get_default_port(new_scheme);
+        const bool slash = has_authority && !new_path.empty() && new_path.front() != '/';
 
-                temp = temp.substr(temp.find('&') + 1);
-                parameters.insert(std::pair<std::string, std::string>(key, value));
+        std::string built;
+        built.reserve(new_scheme.size() + new_userinfo.size() + new_host.size() + new_path.size() + new_query.size() + new_fragment.size() + 16);
+        const auto at = [&built] { return static_cast<uint32_t>(built.size()); };
+        const auto append = [&built, &at](const std::string_view component, const bool lower = false)
+        {
+            const span written{at(), static_cast<uint32_t>(component.size())};
+            for (const char c: component) built += lower ? to_lower(c) : c;
+            return written;
+        };
+
+        scheme = append(new_scheme, true);
+        if (!new_scheme.empty()) built += ':';
+        userinfo = span();
+        authority = span{at(), 0};
+        if (has_authority)
+        {
+            built += "//";
+            if (!new_userinfo.empty())
+            {
+                userinfo = append(new_userinfo);
+                built += '@';
             }
-            std::string key = temp.substr(0, temp.find('='));
-            temp = temp.substr(temp.find('=') + 1);
-            std::string value = temp;
-            if (value.find('#') != std::string::npos) // remove fragment
-                value = value.substr(0, value.find('#'));
-            parameters.insert(std::pair(key, value));
-        } else
+            authority.offset = at();
+            if (literal) built += '[';
+            host = append(new_host, true);
+            if (literal) built += ']';
+            if (write_port) built += ':' + std::to_string(port);
+            authority.size = at() - authority.offset;
+        } else host = span{at(), 0};
+        if (slash) built += '/';
+        path = append(new_path);
+        if (slash) path = {path.offset - 1, path.size + 1};
+        query = span{at(), 0};
+        if (!new_query.empty())
         {
-            path = temp;
+            built += '?';
+            query = append(new_query);
         }
-        if (path.find('#') != std::string::npos)
+        fragment = span{at(), 0};
+        if (!new_fragment.empty())
         {
-            fragment = path.substr(path.find('#') + 1);
-            path = path.substr(0, path.find('#'));
+            built += '#';
+            fragment = append(new_fragment);
         }
+        text = std::move(built);
+        split_parameters();
+    }
 
-        if (path[0] != '/')
+    unsigned int uri::get_default_port(const std::string_view scheme)
+    {
+        if (scheme == "https")
+        {
+            return HTTPS_PORT;
+        }
+        if (scheme == "ftp")
+        {
+            return FTP_PORT;
+        }
+        if (scheme == "ssh")
+        {
+            return SSH_PORT;
+        }
+        if (scheme == "telnet")
+        {
+            return TELNET_PORT;
+        }
+        if (scheme == "smtp")
+        {
+            return SMTP_PORT;
+        }
+        if (scheme == "dns")
+        {
+            return DNS_PORT;
+        }
+        if (scheme == "dhcp")
         {
-            path = "/" + path;
+            return DHCP_PORT;
         }
+        // "http" or default
+        return HTTP_PORT;
     }
 
     uri::uri()
     {
-        host = "";
-        path = "";
-        scheme = "";
-        port = 80;
-        fragment = "";
+        port = HTTP_PORT;
     }
 
     void uri::add_parameter(const std::string &key, const std::string &value)
     {
-        if (value.find('#') != std::string::npos)
-        {
-            this->parameters.insert(std::pair(key, value.substr(0, value.find('#'))));
-        } else
-        {
-            this->parameters.insert(std::pair(key, value));
-        }
+        std::string appended(view(query));
+        if (!appended.empty()) appended += '&';
+        appended += key;
+        appended += '=';
+        appended.append(value, 0, value.find('#'));
+        assemble(view(scheme), view(userinfo), view(host), view(path), appended, view(fragment));
     }
 
     void uri::add_parameter(const std::string &key, const int value)
@@ -217,47 +423,69 @@ namespace cnet
             throw std::invalid_argument("Invalid port number");
         }
         this->port = port;
+        explicit_port = true;
+        assemble(view(scheme), view(userinfo), view(host), view(path), view(query), view(fragment));
+    }
+
+    void uri::set_scheme(const std::string_view scheme)
+    {
+        if (!explicit_port) port = get_default_port(scheme);
+        assemble(scheme, view(userinfo), view(host), view(path), view(query), view(fragment));
     }
 
-    void uri::set_scheme(std::string scheme)
+    void uri::set_host(const std::string_view host)
     {
-        this->scheme = std::move(scheme);
+        assemble(view(scheme), view(userinfo), host, view(path), view(query), view(fragment));
     }
 
-    void uri::set_host(std::string host)
+    void uri::set_path(const std::string_view path)
     {
-        this->host = std::move(host);
+        assemble(view(scheme), view(userinfo), view(host), path, view(query), view(fragment));
     }
 
-    void uri::set_path(std::string path)
+    void uri::set_fragment(const std::string_view fragment)
     {
-        this->path = std::move(path);
+        assemble(view(scheme), view(userinfo), view(host), view(path), view(query), fragment);
     }
 
-    void uri::set_fragment(std::string fragment)
+
+    void uri::set_parameters(const std::map<std::string, std::string> &parameters)
     {
-        this->fragment = std::move(fragment);
+        std::string joined;
+        for (const auto &[key, value]: parameters)
+        {
+            if (!joined.empty()) joined += '&';
+            joined += key;
+            joined += '=';
+            joined.append(value, 0, value.find('#'));
+        }
+        assemble(view(scheme), view(userinfo), view(host), view(path), joined, view(fragment));
     }
 
+    std::string_view uri::get_host() const
+    {
+        return view(host);
+    }
 
-    void uri::set_parameters(std::map<std::string, std::string> parameters)
+    std::string_view uri::get_authority() const
     {
-        this->parameters = std::move(parameters);
+        return view(authority);
     }
 
-    std::string uri::get_host()
+    std::string_view uri::get_userinfo() const
     {
-        return host;
+        return view(userinfo);
     }
 
-    std::string uri::get_path()
+    std::string_view uri::get_path() const
     {
-        return path;
+        if (path.size == 0 && has_authority) return "/";
+        return view(path);
     }
 
-    std::string uri::get_scheme()
+    std::string_view uri::get_scheme() const
     {
-        return scheme;
+        return view(scheme);
     }
 
     unsigned int uri::get_port() const
@@ -265,120 +493,62 @@ namespace cnet
         return port;
     }
 
-    std::string uri::get_fragment()
+    std::string_view uri::get_fragment() const
     {
-        return fragment;
+        return view(fragment);
     }
 
-    std::map<std::string, std::string> uri::get_parameters()
+    std::vector<std::pair<std::string_view, std::string_view>> uri::get_parameters() const
     {
-        return parameters;
+        std::vector<std::pair<std::string_view, std::string_view>> views;
+        views.reserve(parameters.size());
+        for (const auto &[key, value]: parameters)
+        {
+            views.emplace_back(view(key), view(value));
+        }
+        return views;
     }
 
-    std::string uri::get_parameter_query()
+    std::optional<std::string_view> uri::get_parameter(const std::string_view key) const
     {
-        if (!parameters.empty())
+        for (const auto &[name, value]: parameters)
         {
-            std::string query;
-            query += "?";
-            for (auto it = parameters.rbegin(); it != parameters.rend(); ++it) // reverse the order of the parameters.
-            {
-                query += it->first + "=";
-                query += it->second + "&";
-            }
-            query.pop_back();
-            return query;
+            if (view(name) == key) return view(value);
         }
-        return "";
+        return std::nullopt;
     }
 
-    void uri::clear_parameters()
+    std::string_view uri::get_parameter_query() const
     {
-        parameters.clear();
+        if (query.size == 0) return {};
+        // the ? is right before the query
+        return {text.data() + query.offset - 1, query.size + 1};
     }
 
-    std::string uri::to_string()
+    void uri::clear_parameters()
     {
-        std::string url = scheme + "://" + host;
-        if (port != 80 && port != 443)
-        {
-            url += ":" + std::to_string(port);
-        }
-        url += path;
-        url += get_parameter_query();
-        if (!fragment.empty())
-        {
-            url += "#" + fragment;
-        }
-
+        assemble(view(scheme), view(userinfo), view(host), view(path), {}, view(fragment));
+    }
 
-        return url;
+    const std::string &uri::to_string() const
+    {
+        return text;
     }
 
     bool uri::validate_url(const std::string &uri)
     {
-        const size_t colon_pos = uri.find(':');
-
-        // A valid URI should have a colon (to separate the scheme and the rest of the URI)
-        if (colon_pos == std::string::npos)
-        {
-            return false;
-        }
-
-        // Scheme must have at least one character before the colon
-        std::string scheme = uri.substr(0, colon_pos);
-        if (scheme.empty())
-        {
-            return false;
-        }
-
-        // check each character of scheme, it should contain only alphanumeric and + or - or .
-        for (const char &c: scheme)
-        {
-            if (!(isalnum(c) || c == '+' || c == '-' || c == '.'))
-            {
-                return false;
-            }
-        }
-
-        // The path (the sequence of characters from the colon to the first ? or # or the end of the string) must not be an empty string
-        if (const std::string path = uri.substr(colon_pos + 1); path.empty())
-        {
-            return false;
-        }
-
-        // check the port number
-        if (const size_t port_pos = uri.find(':', colon_pos + 1); port_pos != std::string::npos)
-        {
-            const std::string port = uri.substr(port_pos + 1);
-            if (port.empty())
-            {
-                return false;
-            }
-            for (const char &c: port)
-            {
-                if (!isdigit(c))
-                {
-                    return false;
-                }
-            }
-            if (const int port_number = std::stoi(uri.substr(port_pos + 1)); port_number < MIN_PORT || port_number > MAX_PORT)
-            {
-                return false;
-            }
-        }
-
-        // If there are valid scheme and path, then it's a valid URI
-        return true;
+        cnet::uri parsed;
+        return parsed.parse(uri);
     }
 
     bool uri::try_create(const std::string &url, uri &result)
     {
-        if (validate_url(url))
+        uri parsed;
+        if (!parsed.parse(url))
         {
-            result = uri(url);
-            return true;
+            return false;
         }
-        return false;
+        result = std::move(parsed);
+        return true;
     }
 }